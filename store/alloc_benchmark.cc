@@ -0,0 +1,86 @@
+// Measures the allocation throughput of the stores, with several OS threads.
+//
+// Each worker allocates list cells either directly in a SharedStore (one lock
+// per allocation), or through a private ThreadLocalStore carved out of the
+// same SharedStore.
+#include <chrono>
+#include <thread>
+#include <vector>
+using std::vector;
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "store/values.h"
+
+DEFINE_uint64(
+    allocs_per_worker,
+    1000 * 1000,
+    "Number of values allocated by each worker."
+);
+
+DEFINE_uint64(
+    max_workers,
+    8,
+    "Maximum number of workers; runs with 1, 2, 4, ... up to this many."
+);
+
+DEFINE_uint64(
+    tlab_size,
+    store::ThreadLocalStore::kDefaultBufferSize,
+    "Size of the thread-local allocation buffers, in bytes."
+);
+
+namespace store {
+
+// Allocates FLAGS_allocs_per_worker list cells in a store.
+void AllocateLists(Store* store) {
+  Value list = KAtomNil();
+  for (uint64 i = 0; i < FLAGS_allocs_per_worker; ++i)
+    list = List::New(store, Value::Integer(i), list);
+  CHECK(store->Contains(list.heap_value()));
+}
+
+// @param nworkers Number of concurrent workers.
+// @param use_tlab Whether each worker allocates through a ThreadLocalStore.
+// @returns The number of allocations per second, over all workers.
+double Measure(uint64 nworkers, bool use_tlab) {
+  SharedStore shared;
+  vector<std::thread> workers;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64 i = 0; i < nworkers; ++i) {
+    workers.push_back(std::thread([&shared, use_tlab]() {
+      if (use_tlab) {
+        ThreadLocalStore tlab(&shared, FLAGS_tlab_size);
+        AllocateLists(&tlab);
+      } else {
+        AllocateLists(&shared);
+      }
+    }));
+  }
+  for (uint64 i = 0; i < workers.size(); ++i)
+    workers[i].join();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return nworkers * FLAGS_allocs_per_worker / elapsed.count();
+}
+
+void RunBenchmark() {
+  printf("%8s %16s %16s %8s\n", "workers", "shared allocs/s", "tlab allocs/s",
+         "speedup");
+  for (uint64 nworkers = 1; nworkers <= FLAGS_max_workers; nworkers *= 2) {
+    const double shared = Measure(nworkers, false);
+    const double tlab = Measure(nworkers, true);
+    printf("%8lu %16.0f %16.0f %8.2f\n",
+           nworkers, shared, tlab, tlab / shared);
+  }
+}
+
+}  // namespace store
+
+int main(int argc, char** argv) {
+  ::google::ParseCommandLineFlags(&argc, &argv, true);
+  ::google::InitGoogleLogging(argv[0]);
+  store::RunBenchmark();
+  return EXIT_SUCCESS;
+}
@@ -67,7 +67,8 @@ Arity* Arity::GetFromSorted(const vector<Value>& sorted) {
 }
 
 Arity::Arity(const vector<Value>& literals, uint64 hash)
-    : hash_(hash),
+    : HeapValue(kType),
+      hash_(hash),
       features_(literals) {
   // for (uint i = 0; i < features_.size(); ++i)
   //   fmap_[features_[i]] = i;
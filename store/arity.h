@@ -102,11 +102,11 @@ class Arity : public HeapValue {
 
   // ---------------------------------------------------------------------------
   // Value API
-  virtual Value::ValueType type() const noexcept { return kType; }
+  virtual uint64 HeapSize() const { return sizeof(Arity); }
   virtual void ExploreValue(ReferenceMap* ref_map);
 
   // Arities are interned.
-  virtual Value Move(Store* store) { return this; }
+  virtual Value Move(MoveContext* context) { return this; }
 
   // ---------------------------------------------------------------------------
   // Implement serialization
@@ -125,6 +125,9 @@ class Arity : public HeapValue {
     return (val >= 1) && (static_cast<uint64>(val) <= features_.size());
   }
   virtual Value RecordGet(Value* feature) { throw NotImplemented(); }
+  virtual RecordSpan RecordItems() {
+    return RecordSpan(NULL, features_.data(), features_.size());
+  }
   virtual Value::ItemIterator* RecordIterItems() {
     return new ItemIterator(this);
   }
@@ -144,7 +147,8 @@ class Arity : public HeapValue {
   // Copy constructor needed by STL containers.
  public:  // really, this is private!!!
   Arity(const Arity& arity)
-      : hash_(arity.hash_),
+      : HeapValue(kType),
+        hash_(arity.hash_),
         // fmap_(arity.fmap_),
         features_(arity.features_) {
   }
@@ -17,7 +17,8 @@ ArityMap* ArityMap::New(const vector<Arity*>& arities) {
 }
 
 ArityMap::ArityMap(const vector<Arity*>& arities)
-    : arities_(arities) {
+    : HeapValue(kType),
+      arities_(arities) {
   sort(arities_.begin(), arities_.end(), ArityLessThan);
 }
 
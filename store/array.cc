@@ -23,6 +23,20 @@ Value Array::Optimize(OptimizeContext* context) {
   return this;
 }
 
+// virtual
+HeapValue* Array::MoveInternal(Store* store) {
+  Array* const moved = New(store, size_, Value());
+  for (uint64 i = 0; i < size_; ++i)
+    moved->values_[i] = values_[i];
+  return moved;
+}
+
+// virtual
+void Array::MoveReferences(MoveContext* context) {
+  for (uint64 i = 0; i < size_; ++i)
+    values_[i] = context->Move(values_[i]);
+}
+
 // virtual
 void Array::ToASCII(ToASCIIContext* context, string* repr) {
   CHECK_NOTNULL(context);
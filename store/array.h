@@ -24,7 +24,7 @@ class Array : public HeapValue {
   // ---------------------------------------------------------------------------
   // Factory methods
   static inline Array* New(Store* store, uint64 size, Value initial) {
-    void* block = store->Alloc(sizeof(Array) + size * sizeof(Value*));
+    void* block = store->AllocWithNestedArray<Array, Value>(size);
     return new(CHECK_NOTNULL(block)) Array(size, initial);
   }
 
@@ -47,16 +47,21 @@ class Array : public HeapValue {
 
   uint64 size() const { return size_; }
   const Value* values() const { return values_; }
+  Value* mutable_values() { return values_; }
 
   // ---------------------------------------------------------------------------
   // Value API
-  virtual ValueType type() const noexcept { return kType; }
+  virtual uint64 HeapSize() const {
+    return SizeOfWithNestedArray<Array, Value>(size_);
+  }
 
   virtual void ExploreValue(ReferenceMap* ref_map);
   virtual Value Optimize(OptimizeContext* context);
   virtual bool IsStateless(StatelessnessContext* context) {
     return false;
   }
+  virtual HeapValue* MoveInternal(Store* store);
+  virtual void MoveReferences(MoveContext* context);
 
   // ---------------------------------------------------------------------------
   // Serialization
@@ -66,7 +71,8 @@ class Array : public HeapValue {
  private:  // ------------------------------------------------------------------
 
   Array(uint64 size, Value initial)
-      : size_(size) {
+      : HeapValue(kType),
+        size_(size) {
     for (uint64 i = 0; i < size; ++i)
       values_[i] = initial;
   }
@@ -17,9 +17,15 @@ uint64 StringHashCode(const StringPiece& str) {
 }
 
 const Value::ValueType Atom::kType;
+const uint64 Atom::kCaps;
 const boost::regex Atom::kSimpleAtomRegexp("[a-z][A-Za-z0-9_]*");
 
-Atom::AtomMap Atom::atom_map_;
+Atom::Table::Table() {
+  const char* const kWellKnownAtoms[] = { "", "true", "false", "nil", "|", "#" };
+  for (uint64 i = 0; i < ArraySize(kWellKnownAtoms); ++i)
+    Add(this, kWellKnownAtoms[i], StringHashCode(kWellKnownAtoms[i]));
+  CHECK_EQ(kTupleIndex + 1UL, atoms.size());
+}
 
 // static
 string Atom::Escape(const StringPiece& raw_atom) {
@@ -40,17 +46,24 @@ string Atom::Unescape(const StringPiece& escaped_atom) {
 
 // static
 Atom* Atom::Get(const StringPiece& atom) {
+  Table* const table = GetTable();
   const uint64 hash = StringHashCode(atom);
   pair<AtomMap::iterator, AtomMap::iterator> range =
-      atom_map_.equal_range(hash);
+      table->map.equal_range(hash);
 
   AtomMap::iterator it;
   for (it = range.first; it != range.second; ++it) {
     if (it->second.value() == atom)
       return &it->second;
   }
-  Atom new_atom(atom, hash);
-  it = atom_map_.insert(AtomMap::value_type(hash, new_atom));
+  return Add(table, atom, hash);
+}
+
+// static
+Atom* Atom::Add(Table* table, const StringPiece& atom, uint64 hash) {
+  Atom new_atom(atom, hash, table->atoms.size());
+  AtomMap::iterator it = table->map.insert(AtomMap::value_type(hash, new_atom));
+  table->atoms.push_back(&it->second);
   return &it->second;
 }
 
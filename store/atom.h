@@ -5,9 +5,11 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 using std::pair;
 using std::string;
 using std::unordered_multimap;
+using std::vector;
 
 #include <boost/regex.hpp>
 
@@ -21,12 +23,40 @@ namespace store {
 // Atom
 //
 // Atoms are interned in a table.
+// Values reference atoms as immediate values, tagged with kAtomTag and holding
+// the index of the atom in the table: testing an atom type, capabilities or
+// identity does not touch the atom object.
 //
 class Atom : public HeapValue {
  public:
   static const Value::ValueType kType = Value::ATOM;
+  static const uint64 kCaps =
+      Value::CAP_RECORD | Value::CAP_TUPLE | Value::CAP_LITERAL;
   static const boost::regex kSimpleAtomRegexp;
 
+  // Indexes of the atoms registered first in the atom table.
+  enum WellKnownIndex {
+    kEmptyIndex = 0,  // ''
+    kTrueIndex,
+    kFalseIndex,
+    kNilIndex,
+    kListIndex,  // '|'
+    kTupleIndex,  // '#'
+  };
+
+  // @returns The immediate value of the atom with the given index.
+  static inline
+  Value Immediate(uint64 index) {
+    return Value((index << kTagBits) | kAtomTag);
+  }
+
+  // @returns The atom an immediate atom value refers to.
+  static inline
+  Atom* FromValue(Value value) {
+    DCHECK_EQ(kAtomTag, value.tag());
+    return GetTable()->atoms[value.bits() >> kTagBits];
+  }
+
   // Escapes a raw atom.
   static string Escape(const StringPiece& raw_atom);
   // Unescapes an escaped atom.
@@ -43,15 +73,18 @@ class Atom : public HeapValue {
   const string& value() const { return value_; }
   const uint64 hash() const { return hash_; }
 
+  // @returns The index of this atom in the atom table.
+  uint64 index() const { return index_; }
+
   // ---------------------------------------------------------------------------
   // Value API
-  virtual Value::ValueType type() const noexcept { return kType; }
-  virtual uint64 caps() const {
-    return Value::CAP_RECORD | Value::CAP_TUPLE | Value::CAP_LITERAL;
-  }
+  virtual uint64 HeapSize() const { return sizeof(Atom); }
 
-  // Atoms are interned.
-  virtual Value Move(Store* store) { return this; }
+  // Atoms are interned, and referenced as immediate values.
+  virtual Value Deref() { return this; }
+  virtual Value Optimize(OptimizeContext* context) { return this; }
+  virtual Value Move(MoveContext* context) { return this; }
+  virtual Value OpenRecordClose(Store* store) { return this; }
 
   // ---------------------------------------------------------------------------
   // Record interface
@@ -71,7 +104,7 @@ class Atom : public HeapValue {
   // ---------------------------------------------------------------------------
   // Literal interface
 
-  virtual uint64 LiteralHashCode() { return hash_; }
+  virtual uint64 LiteralHashCode() { return index_; }
   virtual bool LiteralEquals(Value other) {
     return Value(this) == other;  // atoms are interned.
   }
@@ -106,19 +139,41 @@ class Atom : public HeapValue {
   };
 
   // Allow copy and assign internally, for STL containers.
-  Atom() : hash_(0) {}
+  Atom() : HeapValue(kType, kCaps), hash_(0), index_(0) {}
  public:  // public for STL only, private otherwise!
   Atom(const Atom& atom)
-      : value_(atom.value_), hash_(atom.hash_) {
+      : HeapValue(kType, kCaps),
+        value_(atom.value_), hash_(atom.hash_), index_(atom.index_) {
   }
  private:
 
-  Atom(const StringPiece& value, uint64 hash)
-      : value_(value.as_string()), hash_(hash) {
+  Atom(const StringPiece& value, uint64 hash, uint64 index)
+      : HeapValue(kType, kCaps),
+        value_(value.as_string()), hash_(hash), index_(index) {
   }
 
   typedef unordered_multimap<uint64, Atom, UInt64Hash> AtomMap;
-  static AtomMap atom_map_;
+
+  struct Table {
+    // Registers the well-known atoms.
+    Table();
+
+    // Atoms by hash of their text.
+    AtomMap map;
+
+    // Atoms by index.
+    vector<Atom*> atoms;
+  };
+
+  // @returns The atom table, created on first use: atoms may be created while
+  //     initializing static variables.
+  static Table* GetTable() {
+    static Table* const table = new Table();
+    return table;
+  }
+
+  // Registers a new atom in the table.
+  static Atom* Add(Table* table, const StringPiece& atom, uint64 hash);
 
   // ---------------------------------------------------------------------------
   // Memory layout
@@ -128,6 +183,9 @@ class Atom : public HeapValue {
 
   const uint64 hash_;
 
+  // Index of the atom in the atom table.
+  const uint64 index_;
+
   // // for STL containers
   // friend class pair<const uint64, Atom>;
   // friend class std::__is_convertible_helper<Atom&, Atom, false>;
@@ -27,4 +27,30 @@ TEST(Atom, Basics) {
   EXPECT_EQ(coucou1, coucou2);
 }
 
+TEST(Atom, Immediate) {
+  Value hello = Atom::Get("hello");
+  EXPECT_TRUE(hello.IsAtom());
+  EXPECT_FALSE(hello.IsHeapValue());
+  EXPECT_EQ(Value::ATOM, hello.type());
+  EXPECT_TRUE(hello.caps() & Value::CAP_LITERAL);
+  EXPECT_EQ(Atom::Get("hello"), hello.as<Atom>());
+  EXPECT_EQ("hello", hello.ToString());
+
+  // The atom object maps back to the same immediate value.
+  EXPECT_TRUE(hello.as<Atom>()->Deref() == hello);
+  EXPECT_TRUE(hello.as<Atom>()->RecordLabel() == hello);
+  EXPECT_TRUE(hello.as<Atom>()->OpenRecordClose(NULL) == hello);
+  EXPECT_TRUE(hello.OpenRecordClose(NULL) == hello);
+  EXPECT_EQ(hello.as<Atom>()->LiteralHashCode(), hello.LiteralHashCode());
+
+  EXPECT_TRUE(KAtomTrue() == Value(Atom::Get("true")));
+  EXPECT_TRUE(KAtomNil() == Value(Atom::Get("nil")));
+  EXPECT_TRUE(KAtomTuple() == Value(Atom::Get("#")));
+
+  Value a = Atom::Get("a");
+  EXPECT_TRUE(a.LiteralLessThan(Atom::Get("b")));
+  EXPECT_FALSE(a.LiteralLessThan(a));
+  EXPECT_TRUE(a.LiteralEquals(Atom::Get("a")));
+}
+
 }  // namespace store
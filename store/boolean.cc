@@ -13,7 +13,8 @@ Boolean* const Boolean::True = new Boolean(true, "true");
 Boolean* const Boolean::False = new Boolean(false, "false");
 
 Boolean::Boolean(bool value, const string& name)
-    : value_(value), name_(name), atom_(NULL /*Atom::Get(name)*/) {
+    : HeapValue(kType),
+      value_(value), name_(name), atom_(NULL /*Atom::Get(name)*/) {
   // TODO: Fix static initialization!
 }
 
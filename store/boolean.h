@@ -43,7 +43,7 @@ class Boolean : public HeapValue {
 
   // ---------------------------------------------------------------------------
   // Value API
-  virtual ValueType type() const noexcept { return kType; }
+  virtual uint64 HeapSize() const { return sizeof(Boolean); }
 
   // ---------------------------------------------------------------------------
   // Implement serialization
@@ -1,3 +1,8 @@
+#include <algorithm>
+
+#include <boost/format.hpp>
+using boost::format;
+
 #include "base/macros.h"
 #include "store/values.h"
 
@@ -96,6 +101,23 @@ static const OpcodeSpec kOpcodeSpecTable[] = {
              Bytecode::NUMBER_INT_DIVIDE,
              "in", "int1", "int2"),
 
+  // Float operations:
+  OpcodeSpec("number_float_inverse",
+             Bytecode::NUMBER_FLOAT_INVERSE,
+             "in", "float"),
+  OpcodeSpec("number_float_add",
+             Bytecode::NUMBER_FLOAT_ADD,
+             "in", "float1", "float2"),
+  OpcodeSpec("number_float_subtract",
+             Bytecode::NUMBER_FLOAT_SUBTRACT,
+             "in", "float1", "float2"),
+  OpcodeSpec("number_float_multiply",
+             Bytecode::NUMBER_FLOAT_MULTIPLY,
+             "in", "float1", "float2"),
+  OpcodeSpec("number_float_divide",
+             Bytecode::NUMBER_FLOAT_DIVIDE,
+             "in", "float1", "float2"),
+
   OpcodeSpec("number_bool_negate",
              Bytecode::NUMBER_BOOL_NEGATE,
              "in", "bool"),
@@ -108,6 +130,15 @@ static const OpcodeSpec kOpcodeSpecTable[] = {
   OpcodeSpec("number_bool_xor",
              Bytecode::NUMBER_BOOL_XOR,
              "in", "bool1", "bool2"),
+
+  // Superinstructions:
+  OpcodeSpec("branch_if_less_than", Bytecode::BRANCH_IF_LESS_THAN,
+             "value1", "value2", "to"),
+  OpcodeSpec("branch_unless_equal", Bytecode::BRANCH_UNLESS_EQUAL,
+             "value1", "value2", "to"),
+  OpcodeSpec("call_args", Bytecode::CALL_ARGS, "proc", "nargs"),
+  OpcodeSpec("call_native_args", Bytecode::CALL_NATIVE_ARGS, "name", "nargs"),
+  OpcodeSpec("args", Bytecode::ARGUMENTS, "arg1", "arg2", "arg3"),
 };
 
 OpcodeSpecMap::OpcodeSpecMap() {
@@ -168,4 +199,115 @@ string Bytecode::ToString() const {
   return str;
 }
 
+// -----------------------------------------------------------------------------
+// Packed bytecode
+
+PackedCode::PackedCode(const vector<Bytecode>& bytecode) {
+  UnorderedMap<uint64, uint32> pool;
+  instructions_.reserve(bytecode.size());
+  for (auto it = bytecode.begin(); it != bytecode.end(); ++it) {
+    const Instruction operand1 = PackOperand(it->operand1, &pool);
+    const Instruction operand2 = PackOperand(it->operand2, &pool);
+    const Instruction operand3 = PackOperand(it->operand3, &pool);
+    instructions_.push_back(
+        Instruction(it->opcode)
+        | (operand1 << kOpcodeBits)
+        | (operand2 << (kOpcodeBits + kOperandBits))
+        | (operand3 << (kOpcodeBits + 2 * kOperandBits)));
+  }
+  CountRegisters();
+  AllocateInlineCaches();
+}
+
+PackedCode::PackedCode(const Instruction* instructions,
+                       uint64 size,
+                       uint64 nconstants)
+    : instructions_(instructions, instructions + size),
+      constants_(nconstants) {
+  CountRegisters();
+  AllocateInlineCaches();
+}
+
+void PackedCode::CountRegisters() {
+  std::fill(nregisters_, nregisters_ + Register::ARRAY + 1, 0);
+  for (auto it = instructions_.begin(); it != instructions_.end(); ++it) {
+    for (int n = 1; n <= 3; ++n) {
+      const uint32 operand = GetOperand(*it, n);
+      const uint32 kind = GetOperandKind(operand);
+      if (kind > Register::ARRAY) continue;
+      nregisters_[kind] =
+          std::max(nregisters_[kind], GetOperandIndex(operand) + 1);
+    }
+  }
+}
+
+void PackedCode::AllocateInlineCaches() {
+  for (auto it = instructions_.begin(); it != instructions_.end(); ++it) {
+    switch (GetOpcode(*it)) {
+      case Bytecode::UNIFY_RECORD_FIELD:
+      case Bytecode::BRANCH_SWITCH_LITERAL:
+      case Bytecode::ACCESS_RECORD:
+        caches_.resize(instructions_.size());
+        return;
+      default:
+        break;
+    }
+  }
+}
+
+uint32 PackedCode::PackOperand(const Operand& operand,
+                               UnorderedMap<uint64, uint32>* pool) {
+  switch (operand.type) {
+    case Operand::INVALID:
+      return INVALID << kOperandIndexBits;
+    case Operand::REGISTER: {
+      CHECK_GE(operand.reg.type, 0);
+      CHECK_GE(operand.reg.index, 0);
+      if (uint64(operand.reg.index) > kMaxOperandIndex)
+        throw CodeTooLarge(
+            (format("Register index too large: %s")
+             % DebugString(operand.reg)).str());
+      return (uint32(operand.reg.type) << kOperandIndexBits)
+          | uint32(operand.reg.index);
+    }
+    case Operand::IMMEDIATE: {
+      auto found = pool->find(operand.value.bits());
+      if (found != pool->end())
+        return (uint32(CONSTANT) << kOperandIndexBits) | found->second;
+      if (uint64(constants_.size()) > kMaxOperandIndex)
+        throw CodeTooLarge(
+            (format("Constant pool too large: more than %d immediate values")
+             % (kMaxOperandIndex + 1)).str());
+      const uint32 index = constants_.size();
+      pool->insert(std::make_pair(operand.value.bits(), index));
+      constants_.push_back(operand.value);
+      return (uint32(CONSTANT) << kOperandIndexBits) | index;
+    }
+  }
+  LOG(FATAL) << "Unknown operand type: " << operand.type;
+}
+
+Operand PackedCode::UnpackOperand(uint32 operand) const {
+  const uint32 kind = GetOperandKind(operand);
+  const uint32 index = GetOperandIndex(operand);
+  if (kind == CONSTANT) {
+    CHECK_LT(index, constants_.size());
+    return Operand(constants_[index]);
+  }
+  if (kind == INVALID) return Operand();
+  CHECK_LT(kind, uint32(Register::REGISTER_TYPE_COUNT));
+  return Operand(Register(Register::RegisterType(kind), index));
+}
+
+Bytecode PackedCode::Unpack(uint64 index) const {
+  CHECK_LT(index, instructions_.size());
+  const Instruction instruction = instructions_[index];
+  Bytecode bytecode;
+  bytecode.opcode = GetOpcode(instruction);
+  bytecode.operand1 = UnpackOperand(GetOperand(instruction, 1));
+  bytecode.operand2 = UnpackOperand(GetOperand(instruction, 2));
+  bytecode.operand3 = UnpackOperand(GetOperand(instruction, 3));
+  return bytecode;
+}
+
 }  // namespace store
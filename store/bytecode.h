@@ -87,11 +87,27 @@ struct Bytecode {
     NUMBER_INT_MULTIPLY,
     NUMBER_INT_DIVIDE,
 
+    NUMBER_FLOAT_INVERSE,
+    NUMBER_FLOAT_ADD,
+    NUMBER_FLOAT_SUBTRACT,
+    NUMBER_FLOAT_MULTIPLY,
+    NUMBER_FLOAT_DIVIDE,
+
     NUMBER_BOOL_NEGATE,
     NUMBER_BOOL_AND_THEN,  // lazy
     NUMBER_BOOL_OR_ELSE,  // lazy
     NUMBER_BOOL_XOR,
 
+    // Superinstructions, produced by FuseSuperinstructions():
+    BRANCH_IF_LESS_THAN,  // test_less_than + branch_if
+    BRANCH_UNLESS_EQUAL,  // test_equality + branch_unless
+
+    // Calls with inline arguments: the instruction is followed by
+    // ceil(nargs / 3) ARGUMENTS instructions listing the parameters.
+    CALL_ARGS,
+    CALL_NATIVE_ARGS,
+    ARGUMENTS,  // Operands of the preceding instruction, never executed.
+
     OPCODE_TYPE_COUNT,
   };
 
@@ -135,6 +151,155 @@ struct Bytecode {
   Operand operand3;
 };
 
+// -----------------------------------------------------------------------------
+// Packed bytecode
+
+// Raised when a bytecode segment addresses more registers or immediate values
+// than the packed format can encode.
+class CodeTooLarge : public std::exception {
+ public:
+  CodeTooLarge(const string& message) : message_(message) {}
+  virtual ~CodeTooLarge() noexcept {}
+  virtual const char* what() const noexcept {
+    return message_.c_str();
+  }
+
+ private:
+  const string message_;
+};
+
+// Bytecode segment in the compact format threads execute.
+//
+// Each instruction is packed into one 64 bits word: the opcode in the low
+// 8 bits, followed by three 18 bits operand descriptors. A descriptor has a
+// 4 bits kind above a 14 bits index:
+//  - a register operand has its Register::RegisterType as kind, and the
+//    register index as index;
+//  - an immediate operand lives in the constant pool of the segment, and has
+//    its position in the pool as index.
+//
+// Instructions have a fixed size, hence code pointers and branch targets are
+// still instruction indexes.
+class PackedCode {
+ public:
+  typedef uint64 Instruction;
+
+  // Operand kinds, beside register types.
+  enum OperandKind {
+    CONSTANT = Register::REGISTER_TYPE_COUNT,
+    INVALID = 15,
+  };
+
+  // Monomorphic inline cache of the feature lookups of a record access
+  // instruction: the position of a feature in the arity it was last looked
+  // up in. Arities are interned, hence identified by their address.
+  struct InlineCache {
+    InlineCache() : arity(NULL), feature(0), index(0) {}
+
+    const Arity* arity;
+
+    // Bits of the feature: only atoms and small integers, whose bits do not
+    // change when the store is collected, are cached.
+    uint64 feature;
+
+    // Position of the feature in the arity.
+    uint64 index;
+  };
+
+  static const int kOpcodeBits = 8;
+  static const int kOperandBits = 18;
+  static const int kOperandIndexBits = 14;
+  static const uint32 kMaxOperandIndex = (1 << kOperandIndexBits) - 1;
+
+  // Packs a bytecode segment.
+  // Identical immediate values share their constant pool entry.
+  // @throws CodeTooLarge if a register index or the number of distinct
+  //     immediate values exceeds kMaxOperandIndex.
+  explicit PackedCode(const vector<Bytecode>& bytecode);
+
+  // Creates a segment from packed instructions.
+  // @param instructions The packed instructions.
+  // @param size The number of instructions.
+  // @param nconstants The size of the constant pool, initially undefined.
+  PackedCode(const Instruction* instructions, uint64 size, uint64 nconstants);
+
+  uint64 size() const { return instructions_.size(); }
+  const Instruction* instructions() const { return instructions_.data(); }
+
+  uint64 nconstants() const { return constants_.size(); }
+  const Value* constants() const { return constants_.data(); }
+  Value* mutable_constants() { return constants_.data(); }
+
+  // @param type An indexed register type: LOCAL, PARAM, ENVMT or ARRAY.
+  // @returns How many registers of the given type the instructions address,
+  //     ie. one more than the highest index used.
+  uint32 nregisters(Register::RegisterType type) const {
+    CHECK_GE(type, Register::LOCAL);
+    CHECK_LE(type, Register::ARRAY);
+    return nregisters_[type];
+  }
+
+  // @returns The inline caches of the instructions, by instruction index.
+  //     NULL if no instruction looks record features up.
+  InlineCache* inline_caches() const {
+    return caches_.empty() ? NULL : caches_.data();
+  }
+
+  // @returns The instruction at the given index, unpacked.
+  //     For debugging and serialization.
+  Bytecode Unpack(uint64 index) const;
+
+  static Bytecode::OpcodeType GetOpcode(Instruction instruction) {
+    return Bytecode::OpcodeType(instruction & ((1 << kOpcodeBits) - 1));
+  }
+
+  // @param n The operand number, from 1 to 3.
+  // @returns The descriptor of the specified operand of an instruction.
+  static uint32 GetOperand(Instruction instruction, int n) {
+    return (instruction >> (kOpcodeBits + (n - 1) * kOperandBits))
+        & ((1 << kOperandBits) - 1);
+  }
+
+  static uint32 GetOperandKind(uint32 operand) {
+    return operand >> kOperandIndexBits;
+  }
+
+  static uint32 GetOperandIndex(uint32 operand) {
+    return operand & kMaxOperandIndex;
+  }
+
+ private:
+  // @returns The descriptor of an operand.
+  // @param operand The operand to pack.
+  // @param pool Maps the immediate values to their constant pool entry.
+  // @throws CodeTooLarge if the operand index does not fit in a descriptor.
+  uint32 PackOperand(const Operand& operand,
+                     UnorderedMap<uint64, uint32>* pool);
+
+  // @returns The operand for a descriptor.
+  Operand UnpackOperand(uint32 operand) const;
+
+  // Computes nregisters_ from the instructions.
+  void CountRegisters();
+
+  // Allocates the inline caches, if some instruction looks features up.
+  void AllocateInlineCaches();
+
+  vector<Instruction> instructions_;
+
+  // Immediate values referenced by the instructions.
+  vector<Value> constants_;
+
+  // Number of registers addressed, for each indexed register type.
+  uint32 nregisters_[Register::ARRAY + 1];
+
+  // Inline caches, indexed like instructions_. Updated by the threads
+  // running the code, hence mutable.
+  mutable vector<InlineCache> caches_;
+};
+
+// -----------------------------------------------------------------------------
+
 // Specification of the opcode mnemonics.
 struct OpcodeSpec {
   OpcodeSpec() {}
@@ -40,13 +40,17 @@ class Cell : public HeapValue {
   // ---------------------------------------------------------------------------
   // Value API
 
-  virtual ValueType type() const noexcept { return kType; }
+  virtual uint64 HeapSize() const { return sizeof(Cell); }
 
   virtual void ExploreValue(ReferenceMap* ref_map);
   virtual Value Optimize(OptimizeContext* context);
   virtual bool IsStateless(StatelessnessContext* context) {
     return false;
   }
+  virtual HeapValue* MoveInternal(Store* store) { return New(store, ref_); }
+  virtual void MoveReferences(MoveContext* context) {
+    ref_ = context->Move(ref_);
+  }
 
   // ---------------------------------------------------------------------------
   // Serialization
@@ -56,7 +60,7 @@ class Cell : public HeapValue {
 
  private:  // ------------------------------------------------------------------
 
-  explicit Cell(Value initial) : ref_(initial) {}
+  explicit Cell(Value initial) : HeapValue(kType), ref_(initial) {}
   virtual ~Cell() {}
 
   // ---------------------------------------------------------------------------
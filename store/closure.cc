@@ -15,22 +15,43 @@ const Value::ValueType Closure::kType;
 
 Closure::Closure(const shared_ptr<vector<Bytecode> >& bytecode,
                  int nparams, int nlocals, int nclosures)
-    : bytecode_(bytecode),
+    : HeapValue(kType),
+      code_(new PackedCode(*CHECK_NOTNULL(bytecode.get()))),
       nparams_(nparams),
       nlocals_(nlocals),
       nclosures_(nclosures),
       environment_(NULL) {
-  CHECK_NOTNULL(bytecode.get());
+}
+
+Closure::Closure(const shared_ptr<PackedCode>& code,
+                 int nparams, int nlocals, int nclosures)
+    : HeapValue(kType),
+      code_(code),
+      nparams_(nparams),
+      nlocals_(nlocals),
+      nclosures_(nclosures),
+      environment_(NULL) {
+  CHECK_NOTNULL(code.get());
 }
 
 Closure::Closure(const Closure* closure, Array* environment)
-    : bytecode_(CHECK_NOTNULL(closure)->bytecode_),
+    : HeapValue(kType),
+      code_(CHECK_NOTNULL(closure)->code_),
       nparams_(closure->nparams_),
       nlocals_(closure->nlocals_),
       nclosures_(CHECK_NOTNULL(environment)->size()),
       environment_(environment) {
   CHECK(closure->environment_ == NULL);
-  CHECK_NOTNULL(bytecode_.get());
+  CHECK_NOTNULL(code_.get());
+}
+
+Closure::Closure(const Closure* closure)
+    : HeapValue(kType),
+      code_(CHECK_NOTNULL(closure)->code_),
+      nparams_(closure->nparams_),
+      nlocals_(closure->nlocals_),
+      nclosures_(closure->nclosures_),
+      environment_(closure->environment_) {
 }
 
 Closure::~Closure() {
@@ -41,34 +62,38 @@ void Closure::ExploreValue(ReferenceMap* ref_map) {
   CHECK_NOTNULL(ref_map);
   if (environment_ != NULL)
     Value(environment_).Explore(ref_map);
-  for (uint64 i = 0; i < bytecode_->size(); ++i) {
-    ExploreOperand(bytecode_->at(i).operand1, ref_map);
-    ExploreOperand(bytecode_->at(i).operand2, ref_map);
-    ExploreOperand(bytecode_->at(i).operand3, ref_map);
-  }
-}
-
-void Closure::ExploreOperand(const Operand& op, ReferenceMap* ref_map) {
-  if (op.type != Operand::IMMEDIATE) return;
-  op.value.Explore(ref_map);
+  Value* const constants = code_->mutable_constants();
+  for (uint64 i = 0; i < code_->nconstants(); ++i)
+    constants[i].Explore(ref_map);
 }
 
 // virtual
 Value Closure::Optimize(OptimizeContext* context) {
-  for (uint64 i = 0; i < bytecode_->size(); ++i) {
-    OptimizeOperand(&bytecode_->at(i).operand1, context);
-    OptimizeOperand(&bytecode_->at(i).operand2, context);
-    OptimizeOperand(&bytecode_->at(i).operand3, context);
-  }
+  Value* const constants = code_->mutable_constants();
+  for (uint64 i = 0; i < code_->nconstants(); ++i)
+    constants[i] = context->Optimize(constants[i]);
   // TODO: Clarify environment_ being NULL-able or not
   if (environment_ != NULL)
     CHECK(context->Optimize(environment_) == environment_);
   return this;
 }
 
-void Closure::OptimizeOperand(Operand* op, OptimizeContext* context) {
-  if (op->type != Operand::IMMEDIATE) return;
-  op->value = context->Optimize(op->value);
+// virtual
+HeapValue* Closure::MoveInternal(Store* store) {
+  Closure* const moved =
+      new(CHECK_NOTNULL(store->Alloc<Closure>())) Closure(this);
+  store->AddFinalizable(moved);
+  return moved;
+}
+
+// virtual
+void Closure::MoveReferences(MoveContext* context) {
+  environment_ = context->MoveRef(environment_);
+  // The bytecode may be shared with other closures: moving a constant twice
+  // is harmless, as its new location does not belong to a from-space.
+  Value* const constants = code_->mutable_constants();
+  for (uint64 i = 0; i < code_->nconstants(); ++i)
+    constants[i] = context->Move(constants[i]);
 }
 
 void Closure::ToASCII(ToASCIIContext* context, string* repr) {
@@ -87,9 +112,9 @@ void Closure::ToASCII(ToASCIIContext* context, string* repr) {
     repr->append(")");
   }
   repr->append(" bytecode:segment(\n");
-  for (uint64 i = 0; i < bytecode_->size(); ++i) {
+  for (uint64 i = 0; i < code_->size(); ++i) {
     repr->append((format("%d:") % i).str());
-    bytecode_->at(i).ToASCII(context, repr);
+    code_->Unpack(i).ToASCII(context, repr);
     repr->append("\n");
   }
   repr->append(")");
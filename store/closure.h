@@ -19,7 +19,7 @@ namespace store {
 // Closures - High-level bytecode
 
 class Bytecode;
-struct Operand;
+class PackedCode;
 
 class Closure : public HeapValue {
  public:
@@ -30,31 +30,47 @@ class Closure : public HeapValue {
   static inline Closure* New(Store* store,
                              const shared_ptr<vector<Bytecode> >& bytecode,
                              int nparams, int nlocals, int nclosures) {
-    return new(CHECK_NOTNULL(store->Alloc<Closure>()))
+    Closure* const closure = new(CHECK_NOTNULL(store->Alloc<Closure>()))
         Closure(bytecode, nparams, nlocals, nclosures);
+    store->AddFinalizable(closure);  // Holds a reference to its code.
+    return closure;
+  }
+
+  static inline Closure* New(Store* store,
+                             const shared_ptr<PackedCode>& code,
+                             int nparams, int nlocals, int nclosures) {
+    Closure* const closure = new(CHECK_NOTNULL(store->Alloc<Closure>()))
+        Closure(code, nparams, nlocals, nclosures);
+    store->AddFinalizable(closure);  // Holds a reference to its code.
+    return closure;
   }
 
   static inline Closure* New(Store* store,
                              const Closure* closure, Array* environment) {
-    return new(CHECK_NOTNULL(store->Alloc<Closure>()))
+    Closure* const bound = new(CHECK_NOTNULL(store->Alloc<Closure>()))
         Closure(closure, environment);
+    store->AddFinalizable(bound);  // Holds a reference to its code.
+    return bound;
   }
 
   // ---------------------------------------------------------------------------
   // Closure specific interface
 
-  const vector<Bytecode>& bytecode() const { return *bytecode_; }
+  const PackedCode& code() const { return *code_; }
   Array* environment() const { return environment_; }
+  uint64 nparams() const { return nparams_; }
   uint64 nlocals() const { return nlocals_; }
   uint64 nclosures() const { return nclosures_; }
 
   // ---------------------------------------------------------------------------
   // Value API
 
-  virtual ValueType type() const noexcept { return kType; }
+  virtual uint64 HeapSize() const { return sizeof(Closure); }
 
   virtual void ExploreValue(ReferenceMap* ref_map);
   virtual Value Optimize(OptimizeContext* context);
+  virtual HeapValue* MoveInternal(Store* store);
+  virtual void MoveReferences(MoveContext* context);
 
   // ---------------------------------------------------------------------------
   // Serialization
@@ -63,31 +79,37 @@ class Closure : public HeapValue {
   virtual void ToProtoBuf(oz_pb::Value* pb);
 
  private:  // ------------------------------------------------------------------
+  // Fixes references up when reading snapshots.
+  friend class SnapshotDecoder;
 
   // Builds an abstract procedure or a procedure without closure.
-  // @param bytecode The bytecode for the procedure.
+  // @param bytecode The bytecode for the procedure, packed by the closure.
   // @param nparams How many parameters this procedure takes.
   // @param nlocals How many local registers this procedure requires.
   Closure(const shared_ptr<vector<Bytecode> >& bytecode,
           int nparams, int nlocals, int nclosures);
 
+  // Builds an abstract procedure or a procedure without closure.
+  // @param code The packed bytecode for the procedure.
+  Closure(const shared_ptr<PackedCode>& code,
+          int nparams, int nlocals, int nclosures);
+
   // Builds a closure from an abstract procedure and the given environment.
   // @param closure The abstract procedure to build the closure from.
   // @param environment The closure environment.
   Closure(const Closure* closure, Array* environment);
 
-  virtual ~Closure();
+  // Builds a copy of the given closure, sharing its bytecode.
+  // Used by MoveInternal().
+  explicit Closure(const Closure* closure);
 
-  // Used by ExploreValue() to explore values referenced by bytecode operands.
-  void ExploreOperand(const Operand& op, ReferenceMap* ref_map);
-
-  // Used by Optimize() to optimize bytecode operands.
-  void OptimizeOperand(Operand* op, OptimizeContext* context);
+  virtual ~Closure();
 
   // ---------------------------------------------------------------------------
   // Memory layout
 
-  const shared_ptr<vector<Bytecode> > bytecode_;
+  // Packed bytecode, possibly shared with other closures.
+  const shared_ptr<PackedCode> code_;
 
   // Number of parameters.
   const int nparams_;
@@ -100,7 +122,7 @@ class Closure : public HeapValue {
 
   // The closure. NULL for an abstract procedure, or a procedure which does
   // not have closure.
-  Array* const environment_;
+  Array* environment_;
 };
 
 }  // namespace store
@@ -9,6 +9,7 @@
 // #include "combinators/bytecode_parser.h"
 #include "store/engine.h"
 #include "store/environment.h"
+#include "store/snapshot.h"
 
 
 DEFINE_string(
@@ -17,25 +18,97 @@ DEFINE_string(
     "Path to the .ozc file to compile."
 );
 
-namespace store {
+DEFINE_uint64(
+    nursery_size,
+    1024 * 1024,
+    "Size of the nursery, in bytes."
+);
 
-const uint64 kStoreSize = 1024 * 1024;
+DEFINE_uint64(
+    old_generation_size,
+    4 * 1024 * 1024,
+    "Size of the old generation before the first major collection, in bytes."
+);
 
-void CompileRun() {
+DEFINE_uint64(
+    soft_memory_limit,
+    0,
+    "Memory use past which the store runs a major collection, in bytes. "
+    "0 means no limit."
+);
+
+DEFINE_uint64(
+    hard_memory_limit,
+    0,
+    "Memory use past which allocations raise out_of_memory, in bytes. "
+    "0 means no limit."
+);
+
+DEFINE_uint64(
+    store_stats_period_ms,
+    0,
+    "How often to log the store statistics, in milli-seconds. 0 disables."
+);
+
+DEFINE_string(
+    heap_profile_prefix,
+    "",
+    "When set, writes heap profiles to <prefix>.<n> along with the periodic "
+    "store statistics (see --store_stats_period_ms)."
+);
+
+DEFINE_string(
+    read_snapshot,
+    "",
+    "When set, runs the compiled program from this snapshot image, "
+    "instead of compiling --oz_code_path."
+);
+
+DEFINE_string(
+    write_snapshot,
+    "",
+    "When set, writes the compiled program to this snapshot image."
+);
+
+namespace store {
+
+// @param store The store to move the compiled program into.
+// @param region The region for the parser and compiler temporaries.
+// @returns The compiled top-level procedure of the program.
+Closure* Compile(Store* store, RegionStore* region) {
   CHECK(!FLAGS_oz_code_path.empty()) << "Specify --oz_code_path.";
 
-  StaticStore store(kStoreSize);
+  ScopedRegion scope(region);
   const string ascii_desc =
       util::ReadFileToString(FLAGS_oz_code_path);
-  Value code_desc = combinators::oz::ParseEval(ascii_desc, &store);
+  Value code_desc = combinators::oz::ParseEval(ascii_desc, region);
   LOG(INFO) << code_desc.ToString();
-  Compiler compiler(&store, NULL);
+  Compiler compiler(region, NULL);
   vector<string> env;
-  Closure* const closure = compiler.CompileProcedure(code_desc, &env);
+  Closure* closure = compiler.CompileProcedure(code_desc, &env);
   CHECK(env.empty());
+  closure = region->Export(closure, store).as<Closure>();
   LOG(INFO) << "Generated closure:\n" << Value(closure).ToString();
+  return closure;
+}
+
+void CompileRun() {
+  GenerationalStore store(FLAGS_nursery_size, FLAGS_old_generation_size);
+  RegionStore region;
+  Closure* const closure = FLAGS_read_snapshot.empty()
+      ? Compile(&store, &region)
+      : Snapshot::ReadFromFile(FLAGS_read_snapshot, &store).as<Closure>();
+  if (!FLAGS_write_snapshot.empty())
+    CHECK(Snapshot::WriteToFile(closure, FLAGS_write_snapshot))
+        << "Cannot write snapshot " << FLAGS_write_snapshot;
 
-  Engine engine;
+  Engine engine(&store);
+  StoreQuota quota;
+  quota.soft_limit = FLAGS_soft_memory_limit;
+  quota.hard_limit = FLAGS_hard_memory_limit;
+  engine.set_quota(quota);
+  engine.set_stats_period_usec(FLAGS_store_stats_period_ms * 1000);
+  engine.set_heap_profile_prefix(FLAGS_heap_profile_prefix);
   // Value thread1 =
   New::Thread(&store, &engine, closure, Array::EmptyArray, &store);
 
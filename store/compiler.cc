@@ -7,7 +7,9 @@ using std::unique_ptr;
 #include <glog/logging.h>
 
 #include "store/values.h"
+#include "store/bytecode.h"
 #include "store/ozvalue.h"
+#include "store/peephole.h"
 
 namespace store {
 
@@ -36,13 +38,22 @@ Closure* Compiler::CompileProcedure(OzValue desc, vector<string>* env) {
 
   CompileExpression(desc["code"], NULL);
 
+  // Falling off the end of the code returns to the caller.
+  segment_->push_back(Bytecode(Bytecode::RETURN));
+
+  FuseSuperinstructions(segment_.get());
+
+  // Packs the code before allocating the closure: a procedure too large for
+  // the packed format throws CodeTooLarge without leaving a partially built
+  // closure in the store.
+  const shared_ptr<PackedCode> code(new PackedCode(*segment_));
+
   // Generate the Closure with the number of registers from the environment.
   const uint64 nparams = environment_->nparams();
   const uint64 nlocals = environment_->nlocals();
   const uint64 nclosures = environment_->nclosures();
   Closure* const closure =
-      New::Closure(store_, segment_, nparams, nlocals, nclosures)
-      .as<Closure>();
+      Closure::New(store_, code, nparams, nlocals, nclosures);
 
   // Fills in the environment linking table.
   const vector<string>&  names = environment_->closure_symbol_names();
@@ -226,11 +237,10 @@ void Compiler::CompilePattern(const Operand& match_value,
       }
       {
         // Recursively tests the record feature value patterns
-        unique_ptr<Value::ItemIterator> it_deleter(
-            pattern_desc.value().RecordIterItems());
-        for (Value::ItemIterator& it = *it_deleter; !it.at_end(); ++it) {
-          OzValue label = (*it).first;
-          OzValue sub_pattern = (*it).second;
+        const RecordSpan items = pattern_desc.value().RecordItems();
+        for (uint64 i = 0; i < items.size(); ++i) {
+          OzValue label = items.feature(i);
+          OzValue sub_pattern = items.value(i);
           ScopedTemp feature_temp(environment_, "FeatureTemp");
           segment_->push_back(Bytecode(Bytecode::ACCESS_RECORD,
                                        feature_temp.GetOperand(),
@@ -655,12 +665,11 @@ void Compiler::CompileNewRecord(OzValue desc, ExpressionResult* result) {
   if (desc.HasFeature("features")) {
     // Set record values
     OzValue features = desc["features"];
-    unique_ptr<Value::ItemIterator> it_deleter(
-        features.value().RecordIterItems());
-    for (Value::ItemIterator& it = *it_deleter; !it.at_end(); ++it) {
-      Operand feature_label((*it).first);
+    const RecordSpan items = features.value().RecordItems();
+    for (uint64 i = 0; i < items.size(); ++i) {
+      Operand feature_label(items.feature(i));
       ExpressionResult value_er(environment_);
-      CompileExpression((*it).second, &value_er);
+      CompileExpression(items.value(i), &value_er);
       segment_->push_back(Bytecode(Bytecode::UNIFY_RECORD_FIELD,
                                    result->value(),
                                    feature_label,
@@ -711,6 +720,10 @@ void Compiler::CompileExpressionEx(OzValue desc, ExpressionResult* result) {
   } else if (label == "raise") {
     CompileRaise(desc);
 
+  } else if (label == "unify") {
+    CHECK(result == NULL);
+    CompileUnify(desc);
+
   } else if (label == "call") {  // Statements or expressions
     CompileCall(desc, result);
 
@@ -773,11 +786,11 @@ void Compiler::CompileValueConstructor(OzValue desc, ExpressionResult* result) {
                                  Operand(desc.arity()),
                                  Operand(desc.label().value())));
 
-    unique_ptr<Value::ItemIterator> it_deleter(desc.value().RecordIterItems());
-    for (Value::ItemIterator& it = *it_deleter; !it.at_end(); ++it) {
-      Operand feature_label((*it).first);
+    const RecordSpan items = desc.value().RecordItems();
+    for (uint64 i = 0; i < items.size(); ++i) {
+      Operand feature_label(items.feature(i));
       ExpressionResult value_er(environment_);
-      CompileExpression((*it).second, &value_er);
+      CompileExpression(items.value(i), &value_er);
       segment_->push_back(Bytecode(Bytecode::UNIFY_RECORD_FIELD,
                                    result->value(),
                                    feature_label,
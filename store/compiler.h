@@ -113,6 +113,8 @@ class Compiler {
   // @param desc The procedure description
   // @param env Returns the names of the environment symbols.
   // @returns The closure value.
+  // @throws CodeTooLarge if the procedure uses more registers or immediate
+  //     values than the packed bytecode format can address.
   Closure* CompileProcedure(OzValue desc, vector<string>* env);
 
   // Compiles an expression.
@@ -0,0 +1,254 @@
+// Measures the cost of the value dispatch.
+//
+// The first benchmark times Value::Deref(), Value::IsDetermined() and
+// Value::type() over a mix of heap values. They read the type header of heap
+// values, and only make a virtual call on indirect values. Before the type
+// header, each of them was a virtual call: the vtable dispatch is measured by
+// building this loop, which only uses the Value API, against such a tree.
+//
+// The program benchmarks run the recursive factorial program, an empty
+// counted loop and a record pattern matching loop, compiled from their code
+// descriptions, and report the time spent in the engine, the bytecode
+// instructions executed per second and the inline cache hit rate.
+#include <chrono>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include <boost/format.hpp>
+using boost::format;
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "combinators/oznode_eval_visitor.h"
+#include "store/compiler.h"
+#include "store/engine.h"
+#include "store/values.h"
+
+DEFINE_uint64(
+    nvalues,
+    1000 * 1000,
+    "Number of heap values in the dispatch benchmark."
+);
+
+DEFINE_uint64(
+    nrounds,
+    20,
+    "Number of passes over the values in the dispatch benchmark."
+);
+
+DEFINE_uint64(
+    ncalls,
+    20 * 1000,
+    "Number of factorial computations in the program benchmark."
+);
+
+DEFINE_uint64(
+    factorial_of,
+    15,
+    "Integer whose factorial the program benchmark computes."
+);
+
+DEFINE_uint64(
+    nloop_iterations,
+    10 * 1000 * 1000,
+    "Number of iterations of the loop program benchmark."
+);
+
+namespace store {
+
+namespace {
+
+// Natives with an explicit output parameter, as the last parameter.
+class IsZero : public NativeInterface {
+ public:
+  virtual void Execute(Array* parameters) {
+    CHECK(Unify(parameters->Access(1),
+                Boolean::Get(IntValue(parameters->Access(0)) == 0)));
+  }
+};
+
+class Decrement : public NativeInterface {
+ public:
+  virtual void Execute(Array* parameters) {
+    CHECK(Unify(parameters->Access(1),
+                Value::Integer(IntValue(parameters->Access(0)) - 1)));
+  }
+};
+
+class Multiply : public NativeInterface {
+ public:
+  virtual void Execute(Array* parameters) {
+    const int64 mul =
+        IntValue(parameters->Access(0)) * IntValue(parameters->Access(1));
+    CHECK(Unify(parameters->Access(2), Value::Integer(mul)));
+  }
+};
+
+// Recursive factorial, computed FLAGS_ncalls times.
+const char* const kFactorialProgram =
+    "'proc'("
+    "  code: 'local'("
+    "    locals: l(fact)"
+    "    'in': sequence("
+    "      unify(var(fact) 'proc'("
+    "        params: p(n r)"
+    "        code: conditional("
+    "          cases: c('if'("
+    "              cond: call(native:fact_is_zero params:p(var(n) returned))"
+    "              'then': unify(var(r) 1)))"
+    "          'else': 'local'("
+    "            locals: l("
+    "              m(call(native:fact_decrement params:p(var(n) returned)))"
+    "              f(call('proc':var(fact) params:p(var(m) returned))))"
+    "            'in': call(native:fact_multiply"
+    "                       params:p(var(n) var(f) var(r)))))))"
+    "      loop("
+    "        range: range(var:i 'from':1 to:%d)"
+    "        body: 'local'("
+    "          locals: l(x(call('proc':var(fact) params:p(%d returned))))"
+    "          'in': 'skip'))"
+    "    )"
+    "  )"
+    ")";
+
+// Empty counted loop: exercises the instruction dispatch only.
+const char* const kLoopProgram =
+    "'proc'("
+    "  code: loop("
+    "    range: range(var:i 'from':1 to:%d)"
+    "    body: 'skip'"
+    "  )"
+    ")";
+
+// Counted loop building a record and matching it against a record pattern:
+// exercises the record feature lookups.
+const char* const kRecordMatchProgram =
+    "'proc'("
+    "  code: loop("
+    "    range: range(var:i 'from':1 to:%d)"
+    "    body: conditional("
+    "      cases: cases("
+    "        match(value:point(x:var(i) y:2 z:3)"
+    "          cases:t("
+    "            with(pattern:point(x:decl_var(a) y:_ z:3)"
+    "                 'then':'skip')))))"
+    "  )"
+    ")";
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// @param store The store to create the values into.
+// @param values Returns a mix of heap values, a few of them bound variables.
+void MakeValues(Store* store, vector<Value>* values) {
+  for (uint64 i = 0; i < FLAGS_nvalues; ++i) {
+    const Value integer = Value::Integer(i);
+    const mpz_class big = mpz_class(i + 1) << 64;
+    Value value;
+    switch (i % 8) {
+      case 0: value = List::New(store, integer, KAtomNil()); break;
+      case 1: value = Tuple::New(store, KAtomTuple(), 3); break;
+      case 2: value = Float::New(store, 1e300 * i); break;  // Not small.
+      case 3: value = Name::New(store); break;
+      case 4: value = Cell::New(store, integer); break;
+      case 5: value = Integer::New(store, big); break;
+      case 6: value = Array::New(store, 1, integer); break;
+      case 7:
+        value = Variable::New(store);
+        CHECK(Unify(value, integer));
+        break;
+    }
+    values->push_back(value);
+  }
+}
+
+void RunDispatchBenchmark() {
+  StaticStore store(FLAGS_nvalues * 64);
+  vector<Value> values;
+  MakeValues(&store, &values);
+
+  uint64 count = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64 round = 0; round < FLAGS_nrounds; ++round) {
+    for (auto it = values.begin(); it != values.end(); ++it) {
+      Value value = *it;
+      count += value.IsDetermined() + value.Deref().type();
+    }
+  }
+  const double elapsed = Seconds(start);
+  // Keeps the loop from being optimized out.
+  CHECK_GT(count, 0UL);
+
+  const double ncalls = FLAGS_nrounds * values.size();
+  printf("%-24s %12s\n", "dispatch", "ns/value");
+  printf("%-24s %12.2f\n", "deref+type", elapsed * 1e9 / ncalls);
+}
+
+// Compiles and runs a program.
+// @param name Name of the program, in the report.
+// @param program Code description of the program.
+// @param ncalls Number of iterations of the program, in the report.
+void RunProgram(const string& name, const string& program, uint64 ncalls) {
+  GenerationalStore store(1024 * 1024, 4 * 1024 * 1024);
+  Closure* closure = NULL;
+  {
+    RegionStore region;
+    ScopedRegion scope(&region);
+    const Value code_desc = combinators::oz::ParseEval(program, &region);
+    Compiler compiler(&region, NULL);
+    vector<string> env;
+    closure = compiler.CompileProcedure(code_desc, &env);
+    CHECK(env.empty());
+    closure = region.Export(closure, &store).as<Closure>();
+  }
+
+  Engine engine(&store);
+  engine.RegisterNative("fact_is_zero", new IsZero);
+  engine.RegisterNative("fact_decrement", new Decrement);
+  engine.RegisterNative("fact_multiply", new Multiply);
+  New::Thread(&store, &engine, closure, Array::EmptyArray, &store);
+
+  const auto start = std::chrono::steady_clock::now();
+  engine.Run();
+  const double elapsed = Seconds(start);
+  printf("%-24s %12.3f %12.2f %12.1f\n",
+         name.c_str(),
+         elapsed * 1e6 / ncalls,
+         engine.nsteps() / elapsed / 1e6,
+         engine.inline_cache_stats().hit_rate() * 100);
+}
+
+void RunProgramBenchmark() {
+  printf("%-24s %12s %12s %12s\n",
+         "program", "us/iteration", "Minstr/s", "IC hits %");
+  RunProgram(
+      (format("factorial(%d)") % FLAGS_factorial_of).str(),
+      (format(kFactorialProgram) % FLAGS_ncalls % FLAGS_factorial_of).str(),
+      FLAGS_ncalls);
+  RunProgram(
+      "loop",
+      (format(kLoopProgram) % FLAGS_nloop_iterations).str(),
+      FLAGS_nloop_iterations);
+  RunProgram(
+      "record_match",
+      (format(kRecordMatchProgram) % FLAGS_nloop_iterations).str(),
+      FLAGS_nloop_iterations);
+}
+
+}  // anonymous namespace
+
+}  // namespace store
+
+int main(int argc, char** argv) {
+  ::google::ParseCommandLineFlags(&argc, &argv, true);
+  ::google::InitGoogleLogging(argv[0]);
+  store::RunDispatchBenchmark();
+  store::RunProgramBenchmark();
+  return EXIT_SUCCESS;
+}
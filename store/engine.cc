@@ -1,8 +1,8 @@
 #include "store/engine.h"
 
-#include <list>
-using std::list;
+#include <boost/format.hpp>
 
+#include "store/heap_profile.h"
 #include "store/values.h"
 
 namespace store {
@@ -62,7 +62,23 @@ class GetLabel: public NativeInterface {
 
 }  // namespace native
 
-Engine::Engine() {
+Engine::Engine()
+    : store_(NULL),
+      stats_period_usec_(0),
+      nheap_profiles_(0),
+      nsteps_(0) {
+  RegisterNatives();
+}
+
+Engine::Engine(GenerationalStore* store)
+    : store_(CHECK_NOTNULL(store)),
+      stats_period_usec_(0),
+      nheap_profiles_(0),
+      nsteps_(0) {
+  RegisterNatives();
+}
+
+void Engine::RegisterNatives() {
   RegisterNative("println", new native::PrintLine);
   RegisterNative("print", new native::Print);
   RegisterNative("decrement", new native::Decrement);
@@ -73,10 +89,23 @@ Engine::Engine() {
 
 void Engine::Run() {
   const int kStepsCount = 1000;  // Execute at most 1k instructions at a time.
+  const bool log_stats = (store_ != NULL) && (stats_period_usec_ > 0);
+  uint64 last_stats_usec = NowUsec();
 
   while (!runnable_.empty()) {
-    Thread* thread = runnable_.front();
-    runnable_.pop_front();
+    // Between time slices, all the live values are reachable from the threads.
+    if ((store_ != NULL) && store_->NeedsCollection())
+      store_->Collect(this);
+
+    if (log_stats) {
+      const uint64 now_usec = NowUsec();
+      if (now_usec - last_stats_usec >= stats_period_usec_) {
+        LogStats();
+        last_stats_usec = now_usec;
+      }
+    }
+
+    Thread* thread = runnable_.pop_front();
     // The thread scheduling is determined by how woken up suspensions are added
     // to the runnable_ list.
     const Thread::ThreadState thread_state =
@@ -88,12 +117,70 @@ void Engine::Run() {
       case Thread::WAITING:
         break;
       case Thread::TERMINATED:
-        // Nothing to do.
+        thread_map_.erase(thread->id());
         break;
       default:
         LOG(FATAL) << "Unexpected thread state: " << thread_state;
     }
   }
+
+  if (store_ != NULL) LogStats();
+}
+
+void Engine::set_quota(const StoreQuota& quota) {
+  CHECK_NOTNULL(store_)->set_quota(quota);
+}
+
+QuotaUsage Engine::quota_usage() const {
+  return CHECK_NOTNULL(store_)->quota_usage();
+}
+
+void Engine::LogStats() {
+  CHECK_NOTNULL(store_);
+  const CollectionStats& stats = store_->stats();
+  LOG(INFO) << "Allocations: " << store_->alloc_stats().ToString()
+            << "Collections: minor=" << stats.nminor
+            << " major=" << stats.nmajor
+            << " promoted=" << stats.promoted_bytes << "B"
+            << " max_pause=" << stats.max_pause_usec << "us"
+            << " total_pause=" << stats.total_pause_usec << "us";
+  LOG(INFO) << "Inline caches: hits=" << inline_cache_stats_.nhits
+            << " misses=" << inline_cache_stats_.nmisses
+            << " hit_rate="
+            << (boost::format("%.1f%%")
+                % (inline_cache_stats_.hit_rate() * 100)).str();
+  const QuotaUsage usage = store_->quota_usage();
+  if ((usage.quota.soft_limit > 0) || (usage.quota.hard_limit > 0))
+    LOG(INFO) << "Quota: used=" << usage.used << "B"
+              << " soft_limit=" << usage.quota.soft_limit << "B"
+              << " hard_limit=" << usage.quota.hard_limit << "B"
+              << " soft_collections=" << usage.nsoft_collections
+              << " refused=" << usage.nrefused;
+
+  if (!heap_profile_prefix_.empty() && !thread_map_.empty()) {
+    const string path =
+        (boost::format("%s.%d") % heap_profile_prefix_ % nheap_profiles_).str();
+    nheap_profiles_++;
+    HeapProfile profile(this);
+    if (profile.WriteToFile(path))
+      LOG(INFO) << "Heap profile written to " << path;
+    else
+      LOG(ERROR) << "Cannot write heap profile to " << path;
+  }
+}
+
+// virtual
+void Engine::MoveRoots(MoveContext* context) {
+  // All the live threads are registered in the thread map.
+  for (auto it = thread_map_.begin(); it != thread_map_.end(); ++it)
+    it->second = context->MoveRef(it->second);
+  runnable_.MoveReferences(context);
+}
+
+// virtual
+void Engine::GetRoots(vector<Value>* roots) {
+  for (auto it = thread_map_.begin(); it != thread_map_.end(); ++it)
+    roots->push_back(it->second);
 }
 
 void Engine::AddThread(Thread* thread) {
@@ -1,15 +1,14 @@
 #ifndef STORE_ENGINE_H_
 #define STORE_ENGINE_H_
 
-#include <list>
 #include <map>
 #include <string>
 
-using std::list;
 using std::map;
 using std::string;
 
 #include "base/basictypes.h"
+#include "store/store.h"
 
 namespace store {
 
@@ -23,23 +22,104 @@ class NativeInterface {
   virtual void Execute(Array* parameters) = 0;
 };
 
+// Statistics about the inline caches of the record feature lookups.
+struct InlineCacheStats {
+  InlineCacheStats() : nhits(0), nmisses(0) {}
+
+  // @returns The ratio of lookups answered by the caches, in [0, 1].
+  double hit_rate() const {
+    const uint64 nlookups = nhits + nmisses;
+    return (nlookups == 0) ? 0.0 : double(nhits) / nlookups;
+  }
+
+  // Number of lookups answered by the caches.
+  uint64 nhits;
+
+  // Number of lookups that searched the arity.
+  uint64 nmisses;
+};
+
 // The engine runs a collection of threads.
-class Engine {
+class Engine : public RootSet {
  public:
   Engine();
 
+  // Creates an engine collecting the given store between thread time slices.
+  // @param store The store the threads of this engine allocate values into.
+  explicit Engine(GenerationalStore* store);
+
   // Runs as long as there are live threads.
   void Run();
 
+  // Sets how often Run() logs the store statistics.
+  // @param period_usec The logging period, in micro-seconds. 0 disables the
+  //     periodic logging; the statistics are still logged when Run() ends.
+  void set_stats_period_usec(uint64 period_usec) {
+    stats_period_usec_ = period_usec;
+  }
+
+  // Makes Run() write a heap profile along with the periodic statistics.
+  // Profiles are written to <path_prefix>.<sequence number>.
+  // @param path_prefix Prefix of the profile files. Empty disables profiles.
+  void set_heap_profile_prefix(const string& path_prefix) {
+    heap_profile_prefix_ = path_prefix;
+  }
+
+  // Sets the memory quota of this engine, enforced by its store.
+  // Crossing the soft limit triggers a major collection; allocations beyond
+  // the hard limit raise out_of_memory in the allocating thread.
+  void set_quota(const StoreQuota& quota);
+
+  // @returns The memory usage of this engine against its quota.
+  QuotaUsage quota_usage() const;
+
+  // @returns The number of bytecode instructions executed by the threads.
+  uint64 nsteps() const { return nsteps_; }
+
+  // @returns The hit counts of the record feature lookup caches.
+  const InlineCacheStats& inline_cache_stats() const {
+    return inline_cache_stats_;
+  }
+
+  // Moves the threads of this engine: they are the roots of the value graph.
+  virtual void MoveRoots(MoveContext* context);
+
+  // Lists the live threads of this engine.
+  virtual void GetRoots(vector<Value>* roots);
+
   // Registers a native procedure.
   // Override any pre-existing native with the specified name.
   void RegisterNative(string name, NativeInterface* native);
 
  private:
+  // Registers the native procedures.
+  void RegisterNatives();
+
   void AddThread(Thread* thread);
 
+  // Logs the allocation and collection statistics of the store.
+  void LogStats();
+
+  // The store collected by this engine. May be NULL.
+  GenerationalStore* const store_;
+
+  // How often to log the store statistics, in micro-seconds. 0 means never.
+  uint64 stats_period_usec_;
+
+  // Prefix of the heap profile files. Empty means no heap profile.
+  string heap_profile_prefix_;
+
+  // Number of heap profiles written so far.
+  uint64 nheap_profiles_;
+
+  // Number of bytecode instructions executed so far.
+  uint64 nsteps_;
+
+  // Record feature lookups through the inline caches so far.
+  InlineCacheStats inline_cache_stats_;
+
   map<uint64, Thread*> thread_map_;
-  list<Thread*> runnable_;
+  SuspensionList runnable_;
 
   map<string, NativeInterface*> native_map_;
 
@@ -14,12 +14,12 @@ const Value::ValueType Float::kType;
 bool Float::UnifyWith(UnificationContext* context, Value value) {
   CHECK_NOTNULL(context);
   return (value.type() == Value::FLOAT)
-      && (value_ == value.as<Float>()->value_);
+      && (value_ == FloatValue(value));
 }
 
 // virtual
 bool Float::Equals(EqualityContext* context, Value value) {
-  return value_ == value.as<Float>()->value_;
+  return value_ == FloatValue(value);
 }
 
 // virtual
@@ -8,6 +8,7 @@ using std::string;
 
 #include "store/store.h"
 #include "store/value.h"
+#include "store/small_float.h"
 
 namespace store {
 
@@ -15,6 +16,8 @@ namespace store {
 // Float
 //
 // A floating-point number. Current precision: 64 bits.
+// Only floats that cannot be encoded as a SmallFloat live in the heap: use
+// New::Float() to create floats.
 //
 class Float : public HeapValue {
  public:
@@ -23,14 +26,18 @@ class Float : public HeapValue {
   // ---------------------------------------------------------------------------
   // Factory methods
   static inline Float* New(Store* store, double value) {
+    CHECK(!SmallFloat::IsSmallFloat(value));
     return new(CHECK_NOTNULL(store->Alloc<Float>())) Float(value);
   }
 
+  double value() const { return value_; }
+
   // ---------------------------------------------------------------------------
   // Value API
-  virtual ValueType type() const noexcept { return kType; }
+  virtual uint64 HeapSize() const { return sizeof(Float); }
   virtual bool UnifyWith(UnificationContext* context, Value value);
   virtual bool Equals(EqualityContext* context, Value value);
+  virtual HeapValue* MoveInternal(Store* store) { return New(store, value_); }
 
   // ---------------------------------------------------------------------------
   // Serialization
@@ -39,7 +46,7 @@ class Float : public HeapValue {
 
  private:  // ------------------------------------------------------------------
 
-  explicit Float(double value) : value_(value) {}
+  explicit Float(double value) : HeapValue(kType), value_(value) {}
   virtual ~Float() {}
 
   // ---------------------------------------------------------------------------
@@ -0,0 +1,251 @@
+#include "store/heap_profile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <boost/format.hpp>
+using boost::format;
+
+#include "store/values.h"
+
+namespace store {
+
+namespace {
+
+const uint64 kNoNode = static_cast<uint64>(-1);
+
+// Reference graph of the reachable heap values.
+// Node 0 is a virtual root referencing all the roots.
+struct ReferenceGraph {
+  // The value of each node. Undefined for the virtual root.
+  vector<Value> values;
+
+  // References from each node.
+  vector<vector<uint64> > successors;
+};
+
+// Builds the reference graph of the values reachable from the given roots.
+void BuildGraph(const vector<Value>& roots, ReferenceGraph* graph) {
+  vector<ValuePair> edges;
+  ReferenceMap ref_map;
+  ref_map.edges = &edges;
+  for (uint64 i = 0; i < roots.size(); ++i)
+    if (roots[i].IsDefined())
+      roots[i].Explore(&ref_map);
+
+  UnorderedMap<Value, uint64> index;
+  graph->values.push_back(Value());
+  graph->successors.resize(1);
+  for (auto it = edges.begin(); it != edges.end(); ++it) {
+    if (index.find(it->second) == index.end()) {
+      index[it->second] = graph->values.size();
+      graph->values.push_back(it->second);
+      graph->successors.push_back(vector<uint64>());
+    }
+  }
+  for (auto it = edges.begin(); it != edges.end(); ++it) {
+    const uint64 from = it->first.IsDefined() ? index[it->first] : 0;
+    graph->successors[from].push_back(index[it->second]);
+  }
+}
+
+// Computes the immediate dominators of the nodes of the reference graph.
+// Uses the iterative algorithm from Cooper, Harvey and Kennedy,
+// "A Simple, Fast Dominance Algorithm".
+// @param graph The reference graph.
+// @param idoms Returns the immediate dominator of each node.
+// @param rpo Returns the nodes in reverse post-order.
+void ComputeDominators(const ReferenceGraph& graph,
+                       vector<uint64>* idoms,
+                       vector<uint64>* rpo) {
+  const uint64 nnodes = graph.values.size();
+
+  // Post-order numbering, with an explicit stack: value graphs may be deep.
+  vector<uint64> postorder(nnodes, kNoNode);
+  vector<bool> visited(nnodes, false);
+  vector<std::pair<uint64, uint64> > stack;  // (node, next successor)
+  stack.push_back(std::make_pair(0, 0));
+  visited[0] = true;
+  uint64 counter = 0;
+  while (!stack.empty()) {
+    const uint64 node = stack.back().first;
+    const uint64 isucc = stack.back().second;
+    if (isucc < graph.successors[node].size()) {
+      stack.back().second++;
+      const uint64 succ = graph.successors[node][isucc];
+      if (!visited[succ]) {
+        visited[succ] = true;
+        stack.push_back(std::make_pair(succ, 0));
+      }
+    } else {
+      postorder[node] = counter++;
+      rpo->push_back(node);
+      stack.pop_back();
+    }
+  }
+  std::reverse(rpo->begin(), rpo->end());
+
+  vector<vector<uint64> > predecessors(nnodes);
+  for (uint64 node = 0; node < nnodes; ++node)
+    for (auto it = graph.successors[node].begin();
+         it != graph.successors[node].end(); ++it)
+      predecessors[*it].push_back(node);
+
+  idoms->assign(nnodes, kNoNode);
+  (*idoms)[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto it = rpo->begin() + 1; it != rpo->end(); ++it) {
+      const uint64 node = *it;
+      uint64 new_idom = kNoNode;
+      for (auto ip = predecessors[node].begin();
+           ip != predecessors[node].end(); ++ip) {
+        uint64 pred = *ip;
+        if ((*idoms)[pred] == kNoNode) continue;
+        if (new_idom == kNoNode) {
+          new_idom = pred;
+          continue;
+        }
+        // Intersects the dominator paths of pred and new_idom.
+        while (pred != new_idom) {
+          while (postorder[pred] < postorder[new_idom])
+            pred = (*idoms)[pred];
+          while (postorder[new_idom] < postorder[pred])
+            new_idom = (*idoms)[new_idom];
+        }
+      }
+      if ((*idoms)[node] != new_idom) {
+        (*idoms)[node] = new_idom;
+        changed = true;
+      }
+    }
+  }
+}
+
+// Numbers the nodes of the reference graph in breadth-first order from the
+// virtual root, which is numbered 0.
+// @param graph The reference graph.
+// @param ordinals Returns the breadth-first ordinal of each node.
+void ComputeOrdinals(const ReferenceGraph& graph, vector<uint64>* ordinals) {
+  ordinals->assign(graph.values.size(), kNoNode);
+  vector<uint64> queue;
+  queue.push_back(0);
+  (*ordinals)[0] = 0;
+  for (uint64 i = 0; i < queue.size(); ++i) {
+    const vector<uint64>& successors = graph.successors[queue[i]];
+    for (auto it = successors.begin(); it != successors.end(); ++it) {
+      if ((*ordinals)[*it] != kNoNode) continue;
+      (*ordinals)[*it] = queue.size();
+      queue.push_back(*it);
+    }
+  }
+}
+
+}  // anonymous namespace
+
+// -----------------------------------------------------------------------------
+
+const uint64 HeapProfile::kDefaultNumRetainers;
+
+HeapProfile::HeapProfile(RootSet* roots, uint64 nretainers)
+    : nvalues_(0),
+      bytes_(0) {
+  vector<Value> root_values;
+  CHECK_NOTNULL(roots)->GetRoots(&root_values);
+  Build(root_values, nretainers);
+}
+
+HeapProfile::HeapProfile(const vector<Value>& roots, uint64 nretainers)
+    : nvalues_(0),
+      bytes_(0) {
+  Build(roots, nretainers);
+}
+
+void HeapProfile::Build(const vector<Value>& roots, uint64 nretainers) {
+  ReferenceGraph graph;
+  BuildGraph(roots, &graph);
+  const uint64 nnodes = graph.values.size();
+
+  vector<uint64> sizes(nnodes, 0);
+  for (uint64 node = 1; node < nnodes; ++node) {
+    HeapValue* const value = graph.values[node].heap_value();
+    sizes[node] = value->HeapSize();
+    const Value::ValueType type = value->type();
+    TypeStats* const stats = &type_stats_[(type > 0) ? type : 0];
+    stats->nvalues++;
+    stats->bytes += sizes[node];
+    nvalues_++;
+    bytes_ += sizes[node];
+  }
+
+  vector<uint64> idoms;
+  vector<uint64> rpo;
+  ComputeDominators(graph, &idoms, &rpo);
+
+  // Dominators come first in reverse post-order: accumulate backwards.
+  vector<uint64> retained(sizes);
+  for (auto it = rpo.rbegin(); it != rpo.rend(); ++it)
+    if (*it != 0)
+      retained[idoms[*it]] += retained[*it];
+
+  vector<uint64> ordinals;
+  ComputeOrdinals(graph, &ordinals);
+
+  // Ties are broken by ordinal, for the ranking to be stable too.
+  vector<uint64> nodes;
+  for (uint64 node = 1; node < nnodes; ++node)
+    nodes.push_back(node);
+  const uint64 ntop = std::min<uint64>(nretainers, nodes.size());
+  std::partial_sort(nodes.begin(), nodes.begin() + ntop, nodes.end(),
+                    [&retained, &ordinals](uint64 a, uint64 b) {
+                      if (retained[a] != retained[b])
+                        return retained[a] > retained[b];
+                      return ordinals[a] < ordinals[b];
+                    });
+  for (uint64 i = 0; i < ntop; ++i) {
+    Retainer retainer;
+    retainer.value = graph.values[nodes[i]];
+    retainer.ordinal = ordinals[nodes[i]];
+    retainer.bytes = sizes[nodes[i]];
+    retainer.retained_bytes = retained[nodes[i]];
+    retainers_.push_back(retainer);
+  }
+}
+
+void HeapProfile::Write(std::ostream* out) const {
+  *out << format("total\t%d\t%d\n") % nvalues_ % bytes_;
+  for (uint64 i = 0; i < ArraySize(type_stats_); ++i) {
+    if (type_stats_[i].nvalues == 0) continue;
+    const Value::ValueType type = (i == 0)
+        ? Value::INVALID
+        : static_cast<Value::ValueType>(i);
+    *out << format("type\t%s\t%d\t%d\n")
+        % ValueTypeName(type) % type_stats_[i].nvalues % type_stats_[i].bytes;
+  }
+  for (uint64 i = 0; i < retainers_.size(); ++i) {
+    const Retainer& retainer = retainers_[i];
+    *out << format("retainer\t%d\t%s\t%d\t%d\t%d\n")
+        % (i + 1)
+        % ValueTypeName(retainer.value.type())
+        % retainer.ordinal
+        % retainer.bytes
+        % retainer.retained_bytes;
+  }
+}
+
+bool HeapProfile::WriteToFile(const string& path) const {
+  std::ofstream out(path.c_str());
+  if (!out) return false;
+  Write(&out);
+  return out.good();
+}
+
+string HeapProfile::ToString() const {
+  std::ostringstream out;
+  Write(&out);
+  return out.str();
+}
+
+}  // namespace store
@@ -0,0 +1,106 @@
+// Heap profiles of live value graphs.
+#ifndef STORE_HEAP_PROFILE_H_
+#define STORE_HEAP_PROFILE_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include "base/macros.h"
+#include "store/store.h"
+
+namespace store {
+
+// A heap profile of the values reachable from a root set.
+//
+// Reports the number of values and bytes per value type, and the values
+// retaining the most memory. The size retained by a value is the total size
+// of the values that are only reachable through it, i.e. that it dominates
+// in the reference graph.
+//
+// Profiles may be written in a line-based, tab-separated format, meant to be
+// diffed between snapshots:
+//   total    <nvalues> <bytes>
+//   type     <type-name> <nvalues> <bytes>
+//   retainer <rank> <type-name> <ordinal> <bytes> <retained-bytes>
+// Retainers are identified by their ordinal rather than by their address, so
+// that profiles of the same value graph are identical.
+class HeapProfile {
+ public:
+  // Default number of top retainers to report.
+  static const uint64 kDefaultNumRetainers = 20;
+
+  struct TypeStats {
+    TypeStats() : nvalues(0), bytes(0) {}
+
+    uint64 nvalues;
+    uint64 bytes;
+  };
+
+  struct Retainer {
+    Value value;
+
+    // Position of the value in the breadth-first traversal of the reference
+    // graph from the roots, starting at 1. Stable across runs and collections.
+    uint64 ordinal;
+
+    // Size of the value itself, in bytes.
+    uint64 bytes;
+
+    // Size of the value and of all the values it dominates, in bytes.
+    uint64 retained_bytes;
+  };
+
+  // Profiles the values reachable from the given roots.
+  // Must run at a safe point: the value graph must not change meanwhile.
+  // @param roots The root set to profile.
+  // @param nretainers How many top retainers to report.
+  explicit HeapProfile(RootSet* roots,
+                       uint64 nretainers = kDefaultNumRetainers);
+
+  // Profiles the values reachable from the given values.
+  HeapProfile(const vector<Value>& roots,
+              uint64 nretainers = kDefaultNumRetainers);
+
+  // @returns The number of reachable heap values.
+  uint64 nvalues() const { return nvalues_; }
+
+  // @returns The size of the reachable heap values, in bytes.
+  uint64 bytes() const { return bytes_; }
+
+  // @returns The statistics for the values of the given type.
+  const TypeStats& type_stats(Value::ValueType type) const {
+    return type_stats_[(type > 0) ? type : 0];
+  }
+
+  // @returns The top retainers, by decreasing retained size.
+  const vector<Retainer>& retainers() const { return retainers_; }
+
+  // Writes this profile in its tab-separated format.
+  void Write(std::ostream* out) const;
+
+  // Writes this profile to a file, in its tab-separated format.
+  // @returns True if successful, false if an error occured.
+  bool WriteToFile(const string& path) const;
+
+  string ToString() const;
+
+ private:  // ------------------------------------------------------------------
+  void Build(const vector<Value>& roots, uint64 nretainers);
+
+  uint64 nvalues_;
+  uint64 bytes_;
+
+  // Indexed by value type. Values with no valid type are accounted in slot 0.
+  TypeStats type_stats_[Value::VALUE_TYPE_COUNT];
+
+  vector<Retainer> retainers_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeapProfile);
+};
+
+}  // namespace store
+
+#endif  // STORE_HEAP_PROFILE_H_
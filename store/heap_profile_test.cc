@@ -0,0 +1,109 @@
+// Tests for heap profiles.
+#include "store/heap_profile.h"
+
+#include <gtest/gtest.h>
+
+#include "store/values.h"
+
+namespace store {
+
+const uint64 kStoreSize = 1024 * 1024;
+
+class HeapProfileTest : public testing::Test {
+ protected:
+  HeapProfileTest()
+      : store_(kStoreSize) {
+  }
+
+  // @returns The list [first ... last | tail].
+  Value MakeList(int first, int last, Value tail) {
+    Value list = tail;
+    for (int i = last; i >= first; --i)
+      list = List::New(&store_, Value::Integer(i), list);
+    return list;
+  }
+
+  // @returns The retainer entry of a value in a profile, or NULL.
+  static const HeapProfile::Retainer* FindRetainer(const HeapProfile& profile,
+                                                   Value value) {
+    for (auto it = profile.retainers().begin();
+         it != profile.retainers().end(); ++it)
+      if (it->value == value) return &*it;
+    return NULL;
+  }
+
+  StaticStore store_;
+};
+
+TEST_F(HeapProfileTest, RetainedSize) {
+  // Root = f(A B), where A and B share the tail of their lists.
+  const Value common = MakeList(1, 3, KAtomNil());
+  const Value a = MakeList(4, 5, common);
+  const Value b = MakeList(6, 6, common);
+  Value values[] = { a, b };
+  const Value root = Tuple::New(&store_, Atom::Get("f"), 2, values);
+
+  vector<Value> roots;
+  roots.push_back(root);
+  HeapProfile profile(roots, 100);
+
+  EXPECT_EQ(6UL, profile.type_stats(Value::LIST).nvalues);
+  EXPECT_EQ(6 * sizeof(List), profile.type_stats(Value::LIST).bytes);
+  EXPECT_EQ(1UL, profile.type_stats(Value::TUPLE).nvalues);
+  // Atoms are immediate values.
+  EXPECT_EQ(0UL, profile.type_stats(Value::ATOM).nvalues);
+  EXPECT_EQ(7UL, profile.nvalues());
+
+  // The root retains everything.
+  ASSERT_EQ(7UL, profile.retainers().size());
+  EXPECT_TRUE(profile.retainers()[0].value == root);
+  EXPECT_EQ(1UL, profile.retainers()[0].ordinal);
+  EXPECT_EQ(profile.bytes(), profile.retainers()[0].retained_bytes);
+
+  // The shared tail is not retained by A nor B.
+  const HeapProfile::Retainer* const retainer_a = FindRetainer(profile, a);
+  ASSERT_TRUE(retainer_a != NULL);
+  EXPECT_EQ(2 * sizeof(List), retainer_a->retained_bytes);
+  const HeapProfile::Retainer* const retainer_b = FindRetainer(profile, b);
+  ASSERT_TRUE(retainer_b != NULL);
+  EXPECT_EQ(sizeof(List), retainer_b->retained_bytes);
+  const HeapProfile::Retainer* const retainer_common =
+      FindRetainer(profile, common);
+  ASSERT_TRUE(retainer_common != NULL);
+  EXPECT_EQ(3 * sizeof(List), retainer_common->retained_bytes);
+}
+
+TEST_F(HeapProfileTest, CyclicValue) {
+  // X = f(X)
+  Value x = Tuple::New(&store_, Atom::Get("f"), 1);
+  EXPECT_TRUE(Unify(x.TupleGet(0), x));
+
+  vector<Value> roots;
+  roots.push_back(x);
+  HeapProfile profile(roots, 1);
+  EXPECT_EQ(1UL, profile.type_stats(Value::VARIABLE).nvalues);
+  ASSERT_EQ(1UL, profile.retainers().size());
+  EXPECT_TRUE(profile.retainers()[0].value == x);
+  EXPECT_EQ(profile.bytes(), profile.retainers()[0].retained_bytes);
+
+  const string dump = profile.ToString();
+  EXPECT_EQ(0UL, dump.find("total\t2\t"));
+  EXPECT_NE(string::npos, dump.find("type\ttuple\t1\t"));
+  EXPECT_NE(string::npos, dump.find("retainer\t1\ttuple\t"));
+}
+
+TEST_F(HeapProfileTest, StableDump) {
+  // The same value graph, built twice at different addresses.
+  string dumps[2];
+  for (int i = 0; i < 2; ++i) {
+    const Value common = MakeList(1, 3, KAtomNil());
+    Value values[] = { MakeList(4, 5, common), MakeList(6, 6, common) };
+    vector<Value> roots;
+    roots.push_back(Tuple::New(&store_, Atom::Get("f"), 2, values));
+    dumps[i] = HeapProfile(roots, 100).ToString();
+  }
+  EXPECT_EQ(dumps[0], dumps[1]);
+  EXPECT_NE(string::npos, dumps[0].find("retainer\t1\ttuple\t1\t"));
+}
+
+}  // namespace store
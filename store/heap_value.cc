@@ -59,6 +59,11 @@ Value HeapValue::RecordGet(Value feature) {
   throw NotImplemented();
 }
 
+// virtual
+RecordSpan HeapValue::RecordItems() {
+  throw NotImplemented();
+}
+
 // virtual
 Value::ItemIterator* HeapValue::RecordIterItems() {
   throw NotImplemented();
@@ -95,11 +100,13 @@ Value::LiteralClass HeapValue::LiteralGetClass() {
 }
 
 // virtual
-Value HeapValue::Move(Store* store) {
-  HeapValue* const new_location = MoveInternal(store);
+Value HeapValue::Move(MoveContext* context) {
+  HeapValue* const new_location = MoveInternal(context->store());
+  DCHECK_GE(HeapSize(), sizeof(MovedValue));
   // Do not free this value memory block, it should belong to a Store.
   this->~HeapValue();
   CHECK_EQ(this, MovedValue::New(this, new_location));
+  context->AddMoved(new_location);
   return new_location;
 }
 
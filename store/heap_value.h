@@ -14,27 +14,58 @@ namespace store {
 
 // -----------------------------------------------------------------------------
 // Abstract base class for all values represented with objects in the heap.
+//
+// Each heap value starts with a header word recording its type and its
+// capabilities, so that the most frequent queries (type, capabilities,
+// dereferencing of determined values) are inline loads rather than virtual
+// calls. Values whose Deref() or IsDetermined() depend on their state
+// (variables, open records) are flagged as indirect in the header.
 
 class HeapValue {
  protected:
-  HeapValue() {}
+  // @param type The type of the value.
+  // @param caps The capabilities of the value.
+  // @param indirect Whether Deref() and IsDetermined() must be dispatched.
+  explicit HeapValue(ValueType type,
+                     uint64 caps = Value::CAP_NONE,
+                     bool indirect = false)
+      : type_(type),
+        caps_(caps),
+        indirect_(indirect),
+        canonical_store_(0) {
+    DCHECK_EQ(caps, caps_);
+  }
 
  public:
   virtual ~HeapValue() {}
 
   // @returns the type of the value.
-  virtual ValueType type() const noexcept { return Value::INVALID; }
+  inline ValueType type() const noexcept {
+    return static_cast<ValueType>(type_);
+  }
 
   template <class C>
   bool IsA() const noexcept { return type() == C::kType; }
 
+  // @returns Whether Deref() and IsDetermined() depend on the value state.
+  inline bool indirect() const noexcept { return indirect_; }
+
+  // @returns The identifier of the InterningStore this value is a canonical
+  //     value of, or 0 if the value is not canonical.
+  inline uint32 canonical_store() const noexcept { return canonical_store_; }
+
   // Dereferences this value.
+  // Only indirect values override this.
   // @returns The dereferenced value.
   virtual Value Deref() { return this; }
 
   // @returns Whether this value is determined or not.
+  // Only indirect values override this.
   virtual bool IsDetermined() { return true; }
 
+  // @returns The size of the memory block holding this value, in bytes.
+  virtual uint64 HeapSize() const { return sizeof(HeapValue); }
+
   // ---------------------------------------------------------------------------
   // Value graph exploration
 
@@ -123,27 +154,35 @@ class HeapValue {
   // ---------------------------------------------------------------------------
   // Support for Stop&Copy collection
 
-  // Moves this value into another store, as well as all referenced values.
+  // Moves this value into another store.
   // Prefer the term move over copy: for stateful values, there should be only
   // one instance, the previous instance will be destroyed!
   //
   // The default behavior is to overwrite this value with a MovedValue
   // after creating a copy of this value in the new store and "finalizing"
-  // this value.
+  // this value. The copy is then registered in the context, for its
+  // references to be moved later on.
   //
-  // @param store The store to move this value into.
+  // @param context The collection context.
   // @return The new value location.
-  virtual Value Move(Store* store);
+  virtual Value Move(MoveContext* context);
 
-  // Copies this value into the given store, and moves its referenced values.
+  // Copies this value into the given store.
+  // The references of the copy still point to the former locations.
   // Meant to be invoked through Move().
   virtual HeapValue* MoveInternal(Store* store) { throw NotImplemented(); }
 
+  // Moves the values referenced by this value, through the given context,
+  // and updates the references to the new locations.
+  // The default implementation is "do nothing", for values without references.
+  // @param context The collection context.
+  virtual void MoveReferences(MoveContext* context) {}
+
   // ---------------------------------------------------------------------------
   // Capacities
 
   // @returns The capabilities of the value as a set of enabled/disabled bits.
-  virtual uint64 caps() const { return Value::CAP_NONE; }
+  inline uint64 caps() const { return caps_; }
 
   // ---------------------------------------------------------------------------
   // OpenRecord interface
@@ -161,6 +200,10 @@ class HeapValue {
   virtual bool RecordHas(Value feature);
   virtual Value RecordGet(Value feature);
 
+  // @returns A view on the record items, in order.
+  // Value::RecordItems() handles records, tuples, lists and atoms inline.
+  virtual RecordSpan RecordItems();
+
   // @returns A new iterator on the record items, in order.
   // Caller must take ownership.
   virtual Value::ItemIterator* RecordIterItems();
@@ -185,6 +228,23 @@ class HeapValue {
   virtual Value::LiteralClass LiteralGetClass();
 
  private:
+  // ---------------------------------------------------------------------------
+  // Header
+
+  // Value::ValueType of the value.
+  const int16 type_;
+
+  // Value::CAP_* bits of the value.
+  const uint8 caps_;
+
+  // Whether Deref() and IsDetermined() must be dispatched.
+  const bool indirect_;
+
+  // Identifier of the InterningStore this value is canonical in, or 0.
+  // Fits in the padding of the header.
+  uint32 canonical_store_;
+
+  friend class InterningStore;
   DISALLOW_COPY_AND_ASSIGN(HeapValue);
 };
 
@@ -1,5 +1,8 @@
 #include "store/values.h"
 
+#include <vector>
+using std::vector;
+
 #include <boost/format.hpp>
 using boost::format;
 
@@ -10,28 +13,176 @@ namespace store {
 
 const Value::ValueType Integer::kType;
 
+namespace {
+
+// Number of limbs of the scratch buffers allocated on the stack: enough for
+// the products of 256 bits integers.
+const mp_size_t kScratchLimbs = 9;
+
+// Scratch limbs, on the stack unless too large.
+class ScratchLimbs {
+ public:
+  explicit ScratchLimbs(mp_size_t size) {
+    if (size > kScratchLimbs) heap_.resize(size);
+    limbs_ = heap_.empty() ? stack_ : heap_.data();
+  }
+
+  mp_limb_t* limbs() { return limbs_; }
+
+ private:
+  mp_limb_t stack_[kScratchLimbs];
+  vector<mp_limb_t> heap_;
+  mp_limb_t* limbs_;
+};
+
+// View on the limbs of a small or big integer operand.
+struct IntegerLimbs {
+  // The single limb of a small integer.
+  mp_limb_t small;
+  const mp_limb_t* limbs;
+  mp_size_t nlimbs;
+  bool negative;
+
+  // @returns Whether the value is an integer.
+  bool Set(Value value) {
+    value = value.Deref();
+    switch (value.type()) {
+      case Value::SMALL_INTEGER: {
+        const int64 ivalue = SmallInteger(value).value();
+        negative = (ivalue < 0);
+        small = negative ? -static_cast<mp_limb_t>(ivalue) : ivalue;
+        limbs = &small;
+        nlimbs = (ivalue != 0);
+        return true;
+      }
+      case Value::INTEGER: {
+        const Integer* const integer = value.as<Integer>();
+        limbs = integer->limbs();
+        nlimbs = integer->nlimbs();
+        negative = (integer->sign() < 0);
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+};
+
+// @returns The comparison of the magnitudes of two operands.
+int CompareMagnitudes(const IntegerLimbs& op1, const IntegerLimbs& op2) {
+  if (op1.nlimbs != op2.nlimbs) return (op1.nlimbs < op2.nlimbs) ? -1 : 1;
+  return mpn_cmp(op1.limbs, op2.limbs, op1.nlimbs);
+}
+
+}  // anonymous namespace
+
+// static
+Value Integer::FromLimbs(Store* store, const mp_limb_t* limbs,
+                         mp_size_t nlimbs, bool negative) {
+  while ((nlimbs > 0) && (limbs[nlimbs - 1] == 0)) --nlimbs;
+  if (nlimbs == 0) return Value::Integer(0);
+  if ((nlimbs == 1) && (limbs[0] <= static_cast<mp_limb_t>(kint64max))) {
+    const int64 magnitude = limbs[0];
+    const int64 ivalue = negative ? -magnitude : magnitude;
+    if (SmallInteger::IsSmallInt(ivalue)) return SmallInteger(ivalue).Encode();
+  }
+  return Allocate(store, limbs, negative ? -nlimbs : nlimbs);
+}
+
+// static
+Value Integer::Compute(Store* store, Operation op, Value int1, Value int2) {
+  IntegerLimbs op1, op2;
+  if (!op1.Set(int1) || !op2.Set(int2)) return Value();
+
+  switch (op) {
+    case SUBTRACT:
+      op2.negative = !op2.negative;
+      // Fall through
+    case ADD: {
+      // Orders the operands by decreasing magnitude.
+      const int cmp = CompareMagnitudes(op1, op2);
+      const IntegerLimbs& large = (cmp >= 0) ? op1 : op2;
+      const IntegerLimbs& small = (cmp >= 0) ? op2 : op1;
+      ScratchLimbs result(large.nlimbs + 1);
+      mp_limb_t* const r = result.limbs();
+      if (large.negative == small.negative) {
+        r[large.nlimbs] = mpn_add(r, large.limbs, large.nlimbs,
+                                  small.limbs, small.nlimbs);
+        return FromLimbs(store, r, large.nlimbs + 1, large.negative);
+      }
+      if (cmp == 0) return Value::Integer(0);
+      mpn_sub(r, large.limbs, large.nlimbs, small.limbs, small.nlimbs);
+      return FromLimbs(store, r, large.nlimbs, large.negative);
+    }
+    case MULTIPLY: {
+      if ((op1.nlimbs == 0) || (op2.nlimbs == 0)) return Value::Integer(0);
+      const bool swap = (op1.nlimbs < op2.nlimbs);
+      const IntegerLimbs& large = swap ? op2 : op1;
+      const IntegerLimbs& small = swap ? op1 : op2;
+      ScratchLimbs result(large.nlimbs + small.nlimbs);
+      mp_limb_t* const r = result.limbs();
+      mpn_mul(r, large.limbs, large.nlimbs, small.limbs, small.nlimbs);
+      return FromLimbs(store, r, large.nlimbs + small.nlimbs,
+                       op1.negative != op2.negative);
+    }
+    case DIVIDE: {
+      if (op2.nlimbs == 0) return Value();
+      if (op1.nlimbs < op2.nlimbs) return Value::Integer(0);
+      // Divides the magnitudes, which truncates towards zero, as int64
+      // divisions.
+      const mp_size_t qsize = op1.nlimbs - op2.nlimbs + 1;
+      ScratchLimbs quotient(qsize);
+      ScratchLimbs remainder(op2.nlimbs);
+      mpn_tdiv_qr(quotient.limbs(), remainder.limbs(), 0,
+                  op1.limbs, op1.nlimbs, op2.limbs, op2.nlimbs);
+      return FromLimbs(store, quotient.limbs(), qsize,
+                       op1.negative != op2.negative);
+    }
+  }
+  LOG(FATAL) << "Invalid operation: " << op;
+}
+
+mpz_class Integer::mpz() const {
+  mpz_t view;
+  return mpz_class(mpz_roinit_n(view, limbs(), size_));
+}
+
+int Integer::Compare(const Integer* other) const {
+  if (size_ != other->size_) return (size_ < other->size_) ? -1 : 1;
+  const int cmp = mpn_cmp(limbs(), other->limbs(), nlimbs());
+  return (size_ < 0) ? -cmp : cmp;
+}
+
+int Integer::Compare(int64 other) const {
+  // Big integers have at least one limb, and are never equal to a small one.
+  if ((size_ > 1) || (size_ < -1)) return (size_ < 0) ? -1 : 1;
+  mpz_t view;
+  const int cmp = mpz_cmp_si(mpz_roinit_n(view, limbs(), size_), other);
+  return (cmp > 0) - (cmp < 0);
+}
+
 // virtual
 bool Integer::UnifyWith(UnificationContext* context, Value ovalue) {
   CHECK_NOTNULL(context);
   if (ovalue.type() != Value::INTEGER) return false;
-  return value_ == ovalue.as<Integer>()->value_;
+  return Compare(ovalue.as<Integer>()) == 0;
 }
 
 // virtual
 bool Integer::Equals(EqualityContext* context, Value value) {
-  return value_ == value.as<Integer>()->value_;
+  return Compare(value.as<Integer>()) == 0;
 }
 
 // virtual
 HeapValue* Integer::MoveInternal(Store* store) {
-  return Integer::New(store, value_);
+  return Allocate(store, limbs_, size_);
 }
 
 // virtual
 void Integer::ToASCII(ToASCIIContext* context, string* repr) {
   CHECK_NOTNULL(repr);
-  string istr = value_.get_str(10);
-  if (sgn(value_) < 0)
+  string istr = mpz().get_str(10);
+  if (size_ < 0)
     istr[0] = '~';
   repr->append(istr);
 }
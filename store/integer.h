@@ -13,6 +13,11 @@ namespace store {
 // -----------------------------------------------------------------------------
 // Arbitrary precision integers
 //
+// The limbs of the magnitude are nested in the value, which is sized for them.
+// Big integers therefore never allocate GMP memory, and are reclaimed with
+// their store. Arithmetic runs on the limbs, with GMP's low-level mpn
+// functions.
+//
 class Integer : public HeapValue {
  public:
   static const Value::ValueType kType = Value::INTEGER;
@@ -24,13 +29,49 @@ class Integer : public HeapValue {
 
   // ---------------------------------------------------------------------------
   // Integer specific interface
-  int64 value() const { return value_.get_si(); }
-  const mpz_class& mpz() const { return value_; }
+
+  // @returns The least significant bits of the integer, with its sign, as
+  //     mpz_get_si().
+  inline int64 value() const;
+
+  // @returns A GMP copy of the integer. Allocates from the GMP heap.
+  mpz_class mpz() const;
+
+  // @returns -1, 0 or 1 according to the sign of the integer.
+  int sign() const { return (size_ > 0) - (size_ < 0); }
+
+  // @returns The number of limbs of the magnitude.
+  mp_size_t nlimbs() const { return (size_ < 0) ? -size_ : size_; }
+
+  // @returns The limbs of the magnitude, least significant first.
+  const mp_limb_t* limbs() const { return limbs_; }
+
+  // @returns -1, 0 or 1 if this integer is less than, equal or greater than
+  //     the other integer.
+  int Compare(const Integer* other) const;
+  int Compare(int64 other) const;
+
+  // ---------------------------------------------------------------------------
+  // Arithmetic on small or big integers
+  //
+  // Operations on small integers run inline, and only fall back to big
+  // integers when the result does not fit in a small integer. Results are
+  // small integers whenever they fit.
+  //
+  // @param store The store to allocate big integer results into.
+  // @returns The result, or an undefined value if an operand is not an
+  //     integer, or on a division by zero.
+  static inline Value Add(Store* store, Value int1, Value int2);
+  static inline Value Subtract(Store* store, Value int1, Value int2);
+  static inline Value Multiply(Store* store, Value int1, Value int2);
+  static inline Value Divide(Store* store, Value int1, Value int2);
+  static inline Value Inverse(Store* store, Value int1);
 
   // ---------------------------------------------------------------------------
   // Value API
-  virtual Value::ValueType type() const noexcept { return kType; }
-  virtual uint64 caps() const { return Value::CAP_LITERAL; }
+  virtual uint64 HeapSize() const {
+    return SizeOfWithNestedArray<Integer, mp_limb_t>(nlimbs());
+  }
   virtual bool UnifyWith(UnificationContext* context, Value value);
   virtual bool Equals(EqualityContext* context, Value value);
   virtual HeapValue* MoveInternal(Store* store);
@@ -41,13 +82,13 @@ class Integer : public HeapValue {
   virtual uint64 LiteralHashCode()  { return value(); }
   virtual bool LiteralEquals(Value other) {
     return (other.type() == Value::INTEGER)
-        && (value_ == other.as<Integer>()->value_);
+        && (Compare(other.as<Integer>()) == 0);
   }
   virtual bool LiteralLessThan(Value other) {
     const Value::LiteralClass tclass = LiteralGetClass();
     const Value::LiteralClass oclass = other.LiteralGetClass();
     return (oclass == LiteralGetClass())
-        ? (value_ < other.as<Integer>()->value_)
+        ? (Compare(other.as<Integer>()) < 0)
         : (tclass < oclass);
   }
   virtual Value::LiteralClass LiteralGetClass() {
@@ -61,18 +102,43 @@ class Integer : public HeapValue {
 
  private:  // ------------------------------------------------------------------
 
-  explicit Integer(int64 value)
-      : value_(value) {
-  }
-  explicit Integer(const mpz_class& value)
-      : value_(value) {
-  }
-  virtual ~Integer() {
-  }
+  enum Operation {
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+  };
+
+  // Slow path of the arithmetic operations, on big integers.
+  static Value Compute(Store* store, Operation op, Value int1, Value int2);
+
+  // @param store The store to allocate the integer into.
+  // @param limbs The limbs of the magnitude, least significant first.
+  //     High zero limbs are ignored.
+  // @param nlimbs The number of limbs.
+  // @param negative Whether the integer is negative.
+  // @returns The integer, as a small integer if it fits.
+  static Value FromLimbs(Store* store, const mp_limb_t* limbs,
+                         mp_size_t nlimbs, bool negative);
+
+  // @param store The store to allocate the integer into.
+  // @param limbs The normalized limbs of the magnitude.
+  // @param size The number of limbs, negated for a negative integer.
+  // @returns A new big integer with a copy of the limbs.
+  static Integer* Allocate(Store* store, const mp_limb_t* limbs,
+                           mp_size_t size);
+
+  // Copies the limbs into the nested array of the integer.
+  Integer(const mp_limb_t* limbs, mp_size_t size);
 
   // ---------------------------------------------------------------------------
   // Memory layout
-  mpz_class value_;
+
+  // Number of limbs, negated for negative integers, as in GMP.
+  const int32 size_;
+
+  // The limbs of the magnitude, least significant first.
+  mp_limb_t limbs_[];
 };
 
 }  // namespace store
@@ -7,14 +7,101 @@ namespace store {
 inline
 Integer* Integer::New(Store* store, int64 value) {
   CHECK(!SmallInteger::IsSmallInt(value));
-  return new(CHECK_NOTNULL(store->Alloc<Integer>())) Integer(value);
+  // Negating as unsigned avoids overflowing on the minimum int64.
+  const mp_limb_t magnitude =
+      (value < 0) ? -static_cast<mp_limb_t>(value) : value;
+  return Allocate(store, &magnitude, (value < 0) ? -1 : 1);
 }
 
 // static
 inline
 Integer* Integer::New(Store* store, const mpz_class& value) {
   CHECK(!SmallInteger::IsSmallInt(value));
-  return new(CHECK_NOTNULL(store->Alloc<Integer>())) Integer(value);
+  mpz_srcptr const mpz = value.get_mpz_t();
+  return Allocate(store, mpz_limbs_read(mpz), mpz->_mp_size);
+}
+
+// static
+inline
+Integer* Integer::Allocate(Store* store, const mp_limb_t* limbs,
+                           mp_size_t size) {
+  const mp_size_t nlimbs = (size < 0) ? -size : size;
+  void* block = store->AllocWithNestedArray<Integer, mp_limb_t>(nlimbs);
+  return new(CHECK_NOTNULL(block)) Integer(limbs, size);
+}
+
+inline
+Integer::Integer(const mp_limb_t* limbs, mp_size_t size)
+    : HeapValue(kType, Value::CAP_LITERAL),
+      size_(size) {
+  DCHECK_GT(nlimbs(), 0);
+  DCHECK_NE(0UL, limbs[nlimbs() - 1]);
+  mpn_copyi(limbs_, limbs, nlimbs());
+}
+
+inline
+int64 Integer::value() const {
+  if (size_ == 0) return 0;
+  const mp_limb_t low = limbs()[0];
+  return (size_ > 0)
+      ? static_cast<int64>(low & kint64max)
+      : -1 - static_cast<int64>((low - 1) & kint64max);
+}
+
+// static
+inline
+Value Integer::Add(Store* store, Value int1, Value int2) {
+  if (int1.IsSmallInt() && int2.IsSmallInt()) {
+    // Sums of small integers cannot overflow int64.
+    const int64 sum = SmallInteger(int1).value() + SmallInteger(int2).value();
+    if (SmallInteger::IsSmallInt(sum)) return SmallInteger(sum).Encode();
+  }
+  return Compute(store, ADD, int1, int2);
+}
+
+// static
+inline
+Value Integer::Subtract(Store* store, Value int1, Value int2) {
+  if (int1.IsSmallInt() && int2.IsSmallInt()) {
+    const int64 diff = SmallInteger(int1).value() - SmallInteger(int2).value();
+    if (SmallInteger::IsSmallInt(diff)) return SmallInteger(diff).Encode();
+  }
+  return Compute(store, SUBTRACT, int1, int2);
+}
+
+// static
+inline
+Value Integer::Multiply(Store* store, Value int1, Value int2) {
+  if (int1.IsSmallInt() && int2.IsSmallInt()) {
+    int64 product;
+    if (!__builtin_mul_overflow(SmallInteger(int1).value(),
+                                SmallInteger(int2).value(),
+                                &product)
+        && SmallInteger::IsSmallInt(product))
+      return SmallInteger(product).Encode();
+  }
+  return Compute(store, MULTIPLY, int1, int2);
+}
+
+// static
+inline
+Value Integer::Divide(Store* store, Value int1, Value int2) {
+  if (int1.IsSmallInt() && int2.IsSmallInt()) {
+    const int64 divisor = SmallInteger(int2).value();
+    if (divisor != 0) {
+      // Only the negation of the smallest small integer overflows.
+      const int64 quotient = SmallInteger(int1).value() / divisor;
+      if (SmallInteger::IsSmallInt(quotient))
+        return SmallInteger(quotient).Encode();
+    }
+  }
+  return Compute(store, DIVIDE, int1, int2);
+}
+
+// static
+inline
+Value Integer::Inverse(Store* store, Value int1) {
+  return Subtract(store, Value::Integer(0), int1);
 }
 
 }  // namespace store
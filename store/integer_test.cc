@@ -40,4 +40,81 @@ TEST_F(BigIntegerTest, String_2) {
   EXPECT_EQ("~123456789012345678901234567890", i.ToString());
 }
 
+TEST_F(BigIntegerTest, Arithmetic) {
+  const Value one = Value::Integer(1);
+  const Value max = Value::Integer(kSmallIntMax - 1);
+
+  // Promotion on overflow.
+  const Value sum = Integer::Add(&store_, max, one);
+  ASSERT_TRUE(sum.IsA<Integer>());
+  EXPECT_TRUE(sum.as<Integer>()->mpz() == mpz_class(kSmallIntMax));
+  const Value product = Integer::Multiply(&store_, max, max);
+  ASSERT_TRUE(product.IsA<Integer>());
+  EXPECT_TRUE(product.as<Integer>()->mpz()
+              == mpz_class(kSmallIntMax - 1) * (kSmallIntMax - 1));
+  EXPECT_TRUE(Integer::Multiply(&store_, Value::Integer(1L << 40),
+                                Value::Integer(1L << 40)).IsA<Integer>());
+
+  // Demotion when the result fits.
+  EXPECT_TRUE(Integer::Subtract(&store_, sum, one) == max);
+  EXPECT_TRUE(Integer::Divide(&store_, product, max) == max);
+  EXPECT_TRUE(Integer::Inverse(&store_, Integer::Inverse(&store_, sum))
+              .IsA<Integer>());
+
+  // Small integers.
+  EXPECT_TRUE(Integer::Add(&store_, one, one) == Value::Integer(2));
+  EXPECT_TRUE(Integer::Multiply(&store_, Value::Integer(-3), Value::Integer(4))
+              == Value::Integer(-12));
+  EXPECT_TRUE(Integer::Divide(&store_, Value::Integer(-7), Value::Integer(2))
+              == Value::Integer(-3));
+  EXPECT_TRUE(Integer::Inverse(&store_, one) == Value::Integer(-1));
+
+  // Promotion of the quotient at the small integer boundary.
+  const Value min = Value::Integer(kSmallIntMin + 1);
+  const Value quotient = Integer::Divide(&store_, min, Value::Integer(-1));
+  ASSERT_TRUE(quotient.IsA<Integer>());
+  EXPECT_TRUE(quotient.as<Integer>()->mpz() == mpz_class(kSmallIntMax));
+  EXPECT_TRUE(Integer::Divide(&store_, min, Value::Integer(1)) == min);
+
+  // Invalid operations.
+  EXPECT_FALSE(Integer::Divide(&store_, one, Value::Integer(0)).IsDefined());
+  EXPECT_FALSE(Integer::Divide(&store_, sum, Value::Integer(0)).IsDefined());
+  EXPECT_FALSE(Integer::Add(&store_, one, KAtomNil()).IsDefined());
+}
+
+TEST_F(BigIntegerTest, Limbs) {
+  // 2^64 + 1 has 2 limbs, 2^512 + 1 has 9 limbs.
+  const mpz_class small = (mpz_class(1) << 64) + 1;
+  const mpz_class large = (mpz_class(1) << 512) + 1;
+  Integer* const small_int = Integer::New(&store_, small);
+  Integer* const large_int = Integer::New(&store_, -large);
+  EXPECT_EQ(2, small_int->nlimbs());
+  EXPECT_EQ(sizeof(Integer) + 2 * sizeof(mp_limb_t), small_int->HeapSize());
+  EXPECT_EQ(9, large_int->nlimbs());
+  EXPECT_EQ(sizeof(Integer) + 9 * sizeof(mp_limb_t), large_int->HeapSize());
+  EXPECT_TRUE(small_int->mpz() == small);
+  EXPECT_TRUE(large_int->mpz() == -large);
+  EXPECT_EQ(1, small_int->value());
+  EXPECT_EQ(-1, large_int->value());
+  EXPECT_EQ(1, small_int->Compare(large_int));
+  EXPECT_EQ(-1, large_int->Compare(kSmallIntMin));
+
+  // Arithmetic on big integers of different sizes.
+  const Value sum = Integer::Add(&store_, Value(large_int),
+                                 Integer::Multiply(&store_, Value(large_int),
+                                                   Value::Integer(-2)));
+  EXPECT_TRUE(sum.as<Integer>()->mpz() == large);
+  const Value quotient = Integer::Divide(&store_, sum, Value(small_int));
+  EXPECT_TRUE(quotient.as<Integer>()->mpz() == large / small);
+
+  // Moving the value copies its limbs into the new store.
+  const mp_limb_t* const limbs = large_int->limbs();
+  StaticStore other(kStoreSize);
+  MoveContext context(&other);
+  context.AddFromSpace(&store_);
+  const Value moved = context.Move(Value(large_int));
+  EXPECT_TRUE(moved.as<Integer>()->mpz() == -large);
+  EXPECT_NE(limbs, moved.as<Integer>()->limbs());
+}
+
 }  // namespace store
@@ -64,7 +64,13 @@ bool List::Equals(EqualityContext* context, Value value) {
 
 // virtual
 HeapValue* List::MoveInternal(Store* store) {
-  return New(store, head_.Move(store), tail_.Move(store));
+  return New(store, head_, tail_);
+}
+
+// virtual
+void List::MoveReferences(MoveContext* context) {
+  head_ = context->Move(head_);
+  tail_ = context->Move(tail_);
 }
 
 // virtual
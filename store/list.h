@@ -28,6 +28,9 @@ class List : public HeapValue {
   Value head() const { return head_; }
   Value tail() const { return tail_; }
 
+  // @returns The head and tail, as an array of 2 values.
+  const Value* values() const { return &head_; }
+
   List* Next() const { return tail_.Deref().as<List>(); }
 
   // Counts the number of values in the list.
@@ -52,8 +55,7 @@ class List : public HeapValue {
   // ---------------------------------------------------------------------------
   // Value API
 
-  virtual Value::ValueType type() const noexcept { return kType; }
-  virtual uint64 caps() const { return Value::CAP_RECORD | Value::CAP_TUPLE; }
+  virtual uint64 HeapSize() const { return sizeof(List); }
 
   virtual void ExploreValue(ReferenceMap* ref_map);
   virtual Value Optimize(OptimizeContext* context);
@@ -61,6 +63,7 @@ class List : public HeapValue {
   virtual bool UnifyWith(UnificationContext* context, Value value);
   virtual bool Equals(EqualityContext* context, Value value);
   virtual HeapValue* MoveInternal(Store* store);
+  virtual void MoveReferences(MoveContext* context);
   virtual bool IsStateless(StatelessnessContext* context);
 
   // ---------------------------------------------------------------------------
@@ -92,8 +95,12 @@ class List : public HeapValue {
   virtual void ToProtoBuf(oz_pb::Value* pb);
 
  private:  // ------------------------------------------------------------------
+  // Fixes references up when reading snapshots.
+  friend class SnapshotDecoder;
 
-  List(Value head, Value tail) : head_(head), tail_(tail) {
+  List(Value head, Value tail)
+      : HeapValue(kType, Value::CAP_RECORD | Value::CAP_TUPLE),
+        head_(head), tail_(tail) {
   }
 
   virtual ~List() {
@@ -113,8 +120,6 @@ class List : public HeapValue {
   //   };
   // };
 
-  inline const Value* values() const { return &head_; }
-
   // ---------------------------------------------------------------------------
   class ItemIterator : public Value::ItemIterator {
    public:
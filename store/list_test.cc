@@ -61,7 +61,7 @@ TEST_F(ListTest, Basic) {
 TEST_F(ListTest, Finite) {
   Atom* atom1 = Atom::Get("atom1");
   Atom* atom2 = Atom::Get("atom2");
-  Atom* nil = KAtomNil();
+  Value nil = KAtomNil();
   List* l = List::New(&store_, atom1, List::New(&store_, atom2, nil));
 
   ReferenceMap rmap;
@@ -21,12 +21,15 @@ class MovedValue : public HeapValue {
     return new(CHECK_NOTNULL(former_location)) MovedValue(new_location);
   }
 
+  // @returns The new location of the moved value.
+  HeapValue* new_location() const { return new_location_; }
+
   // ---------------------------------------------------------------------------
   // Variable interface
 
   // ---------------------------------------------------------------------------
   // Value API
-  virtual Value::ValueType type() const noexcept { return kType; }
+  virtual uint64 HeapSize() const { return sizeof(MovedValue); }
 
   // This is not really a value.
   virtual Value Deref() { throw NotImplemented(); }
@@ -37,8 +40,8 @@ class MovedValue : public HeapValue {
 
   // This value is just a placeholder for an already moved value.
   // We simply return the new value location.
-  virtual Value Move(Store* store) {
-    CHECK_NOTNULL(store);
+  virtual Value Move(MoveContext* context) {
+    CHECK_NOTNULL(context);
     return CHECK_NOTNULL(new_location_);
   }
 
@@ -46,7 +49,8 @@ class MovedValue : public HeapValue {
 
   // Initializes a new free variable.
   MovedValue(HeapValue* new_location)
-      : new_location_(CHECK_NOTNULL(new_location)) {
+      : HeapValue(kType, Value::CAP_NONE, true),
+        new_location_(CHECK_NOTNULL(new_location)) {
   }
 
   virtual ~MovedValue() {}
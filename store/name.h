@@ -26,8 +26,7 @@ class Name : public HeapValue {
 
   // ---------------------------------------------------------------------------
   // Value API
-  virtual Value::ValueType type() const noexcept { return kType; }
-  virtual uint64 caps() const { return Value::CAP_RECORD; }
+  virtual uint64 HeapSize() const { return sizeof(Name); }
 
   virtual HeapValue* MoveInternal(Store* store);
 
@@ -39,6 +38,8 @@ class Name : public HeapValue {
   virtual bool RecordHas(Value feature) { return false; }
   virtual Value RecordGet(Value feature);
 
+  virtual RecordSpan RecordItems() { return RecordSpan(); }
+
   // @returns A new iterator. The caller must take ownership.
   virtual Value::ItemIterator* RecordIterItems() {
     return new EmptyItemIterator();
@@ -76,11 +77,11 @@ class Name : public HeapValue {
   static uint64 next_id_;
   static uint64 GetNextId();
 
-  Name() : id_(GetNextId()) {
+  Name() : HeapValue(kType, Value::CAP_RECORD), id_(GetNextId()) {
   }
 
   // To copy an existing name into another store.
-  Name(uint64 id) : id_(id) {
+  Name(uint64 id) : HeapValue(kType, Value::CAP_RECORD), id_(id) {
   }
 
   virtual ~Name() {
@@ -1,8 +1,5 @@
 #include "store/values.h"
 
-#include <memory>
-using std::unique_ptr;
-
 namespace store {
 
 // -----------------------------------------------------------------------------
@@ -11,29 +8,37 @@ namespace store {
 const Value::ValueType OpenRecord::kType;
 
 OpenRecord::OpenRecord(Store* store, Value label)
-    : ref_(Variable::New(store)),
+    : HeapValue(kType, Value::CAP_RECORD, true),
+      ref_(Variable::New(store)),
       label_(label) {
   CHECK(label.caps() & Value::CAP_LITERAL);
 }
 
 Value OpenRecord::Get(Value feature) const {
-  FeatureMap::const_iterator it = features_.find(feature);
-  if (it == features_.end())
-    return NULL;
+  const uint64 index = LowerBound(feature);
+  if ((index < features_.size()) && Literal::Equals(features_[index], feature))
+    return values_[index];
   else
-    return it->second;
+    return NULL;
 }
 
 bool OpenRecord::Set(Value label, Value value) {
-  FeatureMap::iterator it =
-      features_.insert(features_.begin(), std::make_pair(label, value));
-  return it->second == value;
+  // Features are mostly added in order: check for an append first.
+  const uint64 index =
+      (features_.empty() || Literal::LessThan(features_.back(), label))
+      ? features_.size()
+      : LowerBound(label);
+  if ((index < features_.size()) && Literal::Equals(features_[index], label))
+    return values_[index] == value;
+  features_.insert(features_.begin() + index, label);
+  values_.insert(values_.begin() + index, value);
+  return true;
 }
 
 bool OpenRecord::IsTuple() const {
   const int64 nfeatures = features_.size();
   if (nfeatures == 0) return true;
-  Value last = features_.rbegin()->first;
+  Value last = features_.back();
   return (last.tag() == kSmallIntTag)
       && (SmallInteger(last).value() == nfeatures);
 }
@@ -41,21 +46,15 @@ bool OpenRecord::IsTuple() const {
 // TODO: account for references to the arity in the specified store
 Arity* OpenRecord::GetArity(Store* store) const {
   if (IsTuple()) return Arity::GetTuple(size());
-  vector<Value> features(size());
-  int i = 0;
-  for (auto it = features_.begin(); it != features_.end(); ++it, ++i)
-    features[i] = it->first;
-  return Arity::GetFromSorted(features);
+  return Arity::GetFromSorted(features_);
 }
 
 Value OpenRecord::GetRecord(Store* store) const {
   const uint64 nvalues = size();
   if (nvalues == 0)
     return label_;
-  Value values[nvalues];
-  int i = 0;
-  for (auto it = features_.begin(); it != features_.end(); ++it, ++i)
-    values[i] = it->second;
+  // The values are copied into the new record.
+  Value* const values = const_cast<Value*>(values_.data());
   if (IsTuple()) {
     if ((nvalues == 2) && (label_ == KAtomList())) {
       return List::New(store, values[0], values[1]);
@@ -71,9 +70,9 @@ Value OpenRecord::GetRecord(Store* store) const {
 void OpenRecord::ExploreValue(ReferenceMap* ref_map) {
   CHECK_NOTNULL(ref_map);
   label_.Explore(ref_map);
-  for (auto it = features_.begin(); it != features_.end(); ++it) {
-    const_cast<Value&>(it->first).Explore(ref_map);
-    it->second.Explore(ref_map);
+  for (uint64 i = 0; i < features_.size(); ++i) {
+    features_[i].Explore(ref_map);
+    values_[i].Explore(ref_map);
   }
 }
 
@@ -85,10 +84,9 @@ Value OpenRecord::Deref() {
 // virtual
 Value OpenRecord::Optimize(OptimizeContext* context) {
   if (!ref_->IsFree()) return context->Optimize(ref_);
-  for (auto it = features_.begin(); it != features_.end(); ++it) {
-    // We shouldn't need to optimize the feature value.
-    it->second = context->Optimize(it->second);
-  }
+  // We shouldn't need to optimize the feature value.
+  for (uint64 i = 0; i < values_.size(); ++i)
+    values_[i] = context->Optimize(values_[i]);
   return this;
 }
 
@@ -99,17 +97,26 @@ bool OpenRecord::IsDetermined() {
 
 // virtual
 HeapValue* OpenRecord::MoveInternal(Store* store) {
-  OpenRecord* const moved = New(store, label_.Move(store));
-  for (auto it = features_.begin(), insert_after = moved->features_.begin();
-       it != features_.end(); ++it) {
-    insert_after = moved->features_.insert(
-        insert_after,
-        std::make_pair(const_cast<Value&>(it->first).Move(store),
-                       it->second.Move(store)));
-  }
+  OpenRecord* const moved =
+      new(CHECK_NOTNULL(store->Alloc<OpenRecord>())) OpenRecord(ref_, label_);
+  store->AddFinalizable(moved);
+  // This open-record is destroyed right after being moved.
+  moved->features_.swap(features_);
+  moved->values_.swap(values_);
   return moved;
 }
 
+// virtual
+void OpenRecord::MoveReferences(MoveContext* context) {
+  ref_ = context->MoveRef(ref_);
+  label_ = context->Move(label_);
+  // Moving features does not alter their ordering.
+  for (uint64 i = 0; i < features_.size(); ++i) {
+    features_[i] = context->Move(features_[i]);
+    values_[i] = context->Move(values_[i]);
+  }
+}
+
 // virtual
 bool OpenRecord::UnifyWith(UnificationContext* context, Value ovalue) {
   CHECK_NOTNULL(context);
@@ -117,49 +124,64 @@ bool OpenRecord::UnifyWith(UnificationContext* context, Value ovalue) {
     OpenRecord* orecord = ovalue.as<OpenRecord>();
     if (!Value::Unify(context, label_, orecord->label_)) return false;
 
-    FeatureMap merged;
-    FeatureMap::iterator insert_after = merged.begin();
+    const vector<Value>& features2 = orecord->features_;
+    const vector<Value>& values2 = orecord->values_;
+    const uint64 size1 = features_.size();
+    const uint64 size2 = features2.size();
+    vector<Value> merged_features;
+    vector<Value> merged_values;
+    merged_features.reserve(size1 + size2);
+    merged_values.reserve(size1 + size2);
 
     // First check if we can merge the common values
-    FeatureMap::iterator it1 = features_.begin();
-    FeatureMap::iterator it2 = orecord->features_.begin();
-    while ((it1 != features_.end()) && (it2 != orecord->features_.end())) {
-      if (const_cast<Value&>(it1->first).LiteralLessThan(it2->first)) {
-        insert_after = merged.insert(insert_after, *it1);
-        ++it1;
-      } else if (const_cast<Value&>(it2->first).LiteralLessThan(it1->first)) {
-        insert_after = merged.insert(insert_after, *it2);
-        ++it2;
+    uint64 i1 = 0;
+    uint64 i2 = 0;
+    while ((i1 < size1) && (i2 < size2)) {
+      if (Literal::LessThan(features_[i1], features2[i2])) {
+        merged_features.push_back(features_[i1]);
+        merged_values.push_back(values_[i1]);
+        ++i1;
+      } else if (Literal::LessThan(features2[i2], features_[i1])) {
+        merged_features.push_back(features2[i2]);
+        merged_values.push_back(values2[i2]);
+        ++i2;
       } else {  // Common feature
-        if (!Value::Unify(context, it1->second, it2->second)) return false;
-        insert_after = merged.insert(insert_after, *it1);
-        ++it1;
-        ++it2;
+        if (!Value::Unify(context, values_[i1], values2[i2])) return false;
+        merged_features.push_back(features_[i1]);
+        merged_values.push_back(values_[i1]);
+        ++i1;
+        ++i2;
       }
     }
-    merged.insert(it1, features_.end());
-    merged.insert(it2, orecord->features_.end());
+    merged_features.insert(merged_features.end(),
+                           features_.begin() + i1, features_.end());
+    merged_values.insert(merged_values.end(),
+                         values_.begin() + i1, values_.end());
+    merged_features.insert(merged_features.end(),
+                           features2.begin() + i2, features2.end());
+    merged_values.insert(merged_values.end(),
+                         values2.begin() + i2, values2.end());
 
     // TODO: This is bogus: won't be reversed if unification aborts.
-    features_.swap(merged);
+    features_.swap(merged_features);
+    values_.swap(merged_values);
     orecord->ref_->UnifyWith(context, this);
     return true;
 
   } else if (ovalue.caps() & Value::CAP_RECORD) {
     if (!Value::Unify(context, label_, ovalue.RecordLabel())) return false;
 
-    FeatureMap::iterator it1 = features_.begin();
-    unique_ptr<Value::ItemIterator> it2_deleter(ovalue.RecordIterItems());
-    Value::ItemIterator& it2 = *it2_deleter;
-
-    while (it1 != features_.end()) {
-      while (!it2.at_end() && (*it2).first.LiteralLessThan(it1->first))
-        ++it2;
-      if (it2.at_end()) return false;
-      if (!(*it2).first.LiteralEquals(it1->first)) return false;
-      if (!Value::Unify(context, it1->first, (*it2).first)) return false;
-      ++it1;
-      ++it2;
+    const RecordSpan items = ovalue.RecordItems();
+    uint64 i2 = 0;
+
+    for (uint64 i1 = 0; i1 < features_.size(); ++i1) {
+      while ((i2 < items.size())
+             && items.feature(i2).LiteralLessThan(features_[i1]))
+        ++i2;
+      if (i2 >= items.size()) return false;
+      if (!items.feature(i2).LiteralEquals(features_[i1])) return false;
+      if (!Value::Unify(context, values_[i1], items.value(i2))) return false;
+      ++i2;
     }
     ref_->UnifyWith(context, ovalue);
     return true;
@@ -185,10 +207,10 @@ void OpenRecord::ToASCII(ToASCIIContext* context, string* repr) {
   if (ref_->IsFree()) {
     context->Encode(label_, repr);
     repr->push_back('(');
-    for (auto it = features_.begin(); it != features_.end(); ++it) {
-      context->Encode(it->first, repr);
+    for (uint64 i = 0; i < features_.size(); ++i) {
+      context->Encode(features_[i], repr);
       repr->push_back(':');
-      context->Encode(it->second, repr);
+      context->Encode(values_[i], repr);
       repr->push_back(' ');
     }
     repr->append("...)");
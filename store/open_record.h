@@ -1,10 +1,13 @@
 #ifndef STORE_OPEN_RECORD_H_
 #define STORE_OPEN_RECORD_H_
 
+#include <algorithm>
 #include <list>
 #include <string>
+#include <vector>
 using std::list;
 using std::string;
+using std::vector;
 
 #include "base/stl-util.h"
 #include "base/string_piece.h"
@@ -20,6 +23,10 @@ namespace store {
 // The arity of an open-record may only grow: existing features may not be
 // modified or removed.
 //
+// Features and their values are kept in two parallel vectors, sorted by
+// feature like in Arity: lookups are binary searches, and closing the
+// open-record reuses both vectors without sorting.
+//
 // TODO: An OpenRecord may turn into a regular immutable record.
 // -> An open-record would include a variable which will be set
 // once the open-record gets finalized.
@@ -31,8 +38,10 @@ class OpenRecord : public HeapValue {
   // ---------------------------------------------------------------------------
   // Factory methods
   static inline OpenRecord* New(Store* store, Value label) {
-    return new(CHECK_NOTNULL(store->Alloc<OpenRecord>()))
+    OpenRecord* const record = new(CHECK_NOTNULL(store->Alloc<OpenRecord>()))
         OpenRecord(store, label);
+    store->AddFinalizable(record);  // Owns the feature vectors.
+    return record;
   }
 
   // ---------------------------------------------------------------------------
@@ -44,7 +53,8 @@ class OpenRecord : public HeapValue {
   int64 size() const { return features_.size(); }
 
   bool Has(Value feature) const {
-    return features_.contains(feature);
+    return std::binary_search(features_.begin(), features_.end(),
+                              feature, Literal::Compare());
   }
   inline bool Has(int64 feature) const {
     return Has(Value::Integer(feature));
@@ -78,7 +88,6 @@ class OpenRecord : public HeapValue {
   bool IsTuple() const;
 
   // @returns The arity matching the current state of this open-record.
-  //     This is an expensive operation.
   Arity* GetArity(Store* store) const;
 
   // @returns A record matching the current state of this open-record.
@@ -87,8 +96,7 @@ class OpenRecord : public HeapValue {
   // ---------------------------------------------------------------------------
   // Value API
 
-  virtual ValueType type() const noexcept { return kType; }
-  virtual uint64 caps() const { return Value::CAP_RECORD; }
+  virtual uint64 HeapSize() const { return sizeof(OpenRecord); }
 
   virtual void ExploreValue(ReferenceMap* ref_map);
   virtual Value Deref();
@@ -96,6 +104,7 @@ class OpenRecord : public HeapValue {
   virtual bool IsDetermined();
   virtual bool UnifyWith(UnificationContext* context, Value other);
   virtual HeapValue* MoveInternal(Store* store);
+  virtual void MoveReferences(MoveContext* context);
   virtual bool IsStateless(StatelessnessContext* context);
 
   // ---------------------------------------------------------------------------
@@ -119,6 +128,7 @@ class OpenRecord : public HeapValue {
   virtual bool RecordHas(Value feature);
   virtual Value RecordGet(Value feature);
 
+  virtual RecordSpan RecordItems();
   virtual Value::ItemIterator* RecordIterItems();
   virtual Value::ValueIterator* RecordIterValues();
 
@@ -131,6 +141,11 @@ class OpenRecord : public HeapValue {
 
   // Creates a new empty open-record.
   explicit OpenRecord(Store* store, Value label);
+
+  // Creates an open-record bound to an existing variable, with no feature.
+  OpenRecord(Variable* ref, Value label)
+      : HeapValue(kType, Value::CAP_RECORD, true), ref_(ref), label_(label) {
+  }
   virtual ~OpenRecord() {}
 
   // ---------------------------------------------------------------------------
@@ -142,36 +157,45 @@ class OpenRecord : public HeapValue {
   Variable* ref_;
 
   Value label_;
-  typedef Map<Value, Value, Literal::Compare> FeatureMap;
-  FeatureMap features_;
+
+  // Sorted features, and their values in the same order.
+  vector<Value> features_;
+  vector<Value> values_;
+
+  // @returns The index of the first feature not less than the given feature.
+  inline uint64 LowerBound(Value feature) const {
+    return std::lower_bound(features_.begin(), features_.end(),
+                            feature, Literal::Compare()) - features_.begin();
+  }
 
   // ---------------------------------------------------------------------------
   class ItemIterator : public Value::ItemIterator {
    public:
     ItemIterator(OpenRecord* record)
         : record_(CHECK_NOTNULL(record)),
-          it_(record_->features_.begin()) {
+          index_(0) {
     }
 
     virtual ~ItemIterator() {}
 
     virtual ValuePair operator*() {
       CHECK(!at_end());
-      return std::make_pair(it_->first, it_->second);
+      return std::make_pair(record_->features_[index_],
+                            record_->values_[index_]);
     }
 
     virtual ItemIterator& operator++() {
-      ++it_;
+      ++index_;
       return *this;
     }
 
     virtual bool at_end() {
-      return it_ == record_->features_.end();
+      return index_ >= record_->features_.size();
     }
 
    private:
     OpenRecord* const record_;
-    FeatureMap::const_iterator it_;
+    uint64 index_;
   };
 
   // ---------------------------------------------------------------------------
@@ -179,28 +203,28 @@ class OpenRecord : public HeapValue {
    public:
     ValueIterator(OpenRecord* record)
         : record_(CHECK_NOTNULL(record)),
-          it_(record_->features_.begin()) {
+          index_(0) {
     }
 
     virtual ~ValueIterator() {}
 
     virtual Value operator*() {
       CHECK(!at_end());
-      return it_->second;
+      return record_->values_[index_];
     }
 
     virtual ValueIterator& operator++() {
-      ++it_;
+      ++index_;
       return *this;
     }
 
     virtual bool at_end() {
-      return it_ == record_->features_.end();
+      return index_ >= record_->values_.size();
     }
 
    private:
     OpenRecord* const record_;
-    FeatureMap::const_iterator it_;
+    uint64 index_;
   };
 
 };
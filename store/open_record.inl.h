@@ -74,6 +74,12 @@ Value OpenRecord::RecordGet(Value feature) {
   throw SuspendThread(ref_->suspensions());
 }
 
+// virtual
+inline
+RecordSpan OpenRecord::RecordItems() {
+  throw SuspendThread(ref_->suspensions());
+}
+
 // virtual
 inline
 Value::ItemIterator* OpenRecord::RecordIterItems() {
@@ -140,4 +140,25 @@ TEST_F(OpenRecordTest, API) {
                      New::Arity(&store_, x, y)));
 }
 
+TEST_F(OpenRecordTest, UnorderedSet) {
+  Atom* label = Atom::Get("label");
+  OpenRecord* orecord = OpenRecord::New(&store_, label);
+
+  // Features are kept sorted regardless of the insertion order.
+  EXPECT_TRUE(orecord->Set(3, Atom::Get("z")));
+  EXPECT_TRUE(orecord->Set(1, Atom::Get("x")));
+  EXPECT_TRUE(orecord->Set(2, Atom::Get("y")));
+  EXPECT_FALSE(orecord->Set(2, Atom::Get("w")));
+  EXPECT_EQ(3, orecord->size());
+  EXPECT_TRUE(orecord->Get(2) == Atom::Get("y"));
+  EXPECT_FALSE(orecord->Has(4));
+  EXPECT_TRUE(orecord->IsTuple());
+
+  Tuple* tuple = orecord->GetRecord(&store_).as<Tuple>();
+  EXPECT_EQ(3UL, tuple->size());
+  EXPECT_TRUE(tuple->values()[0] == Atom::Get("x"));
+  EXPECT_TRUE(tuple->values()[1] == Atom::Get("y"));
+  EXPECT_TRUE(tuple->values()[2] == Atom::Get("z"));
+}
+
 }  // namespace store
@@ -27,8 +27,7 @@ namespace store {
 //     boolean: static_cast<bool>(x)
 class OzValue {
  public:
-  // FIXME: Get rid of kHeapStore!
-  static OzValue Parse(const string& code, Store* store = kHeapStore) {
+  static OzValue Parse(const string& code, Store* store) {
     return OzValue(combinators::oz::ParseEval(code, store));
   }
 
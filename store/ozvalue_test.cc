@@ -37,7 +37,7 @@ TEST_F(OzValueTest, Basic) {
 
   OzValue x(int1);
   OzValue y = x;
-  OzValue z = OzValue::Parse("arecord(a b c)");
+  OzValue z = OzValue::Parse("arecord(a b c)", &store_);
   y = x;
   CHECK_EQ(1, x.int_val());
   CHECK_EQ(1, y.int_val());
@@ -0,0 +1,166 @@
+#include "store/values.h"
+
+#include <vector>
+using std::vector;
+
+#include <gtest/gtest.h>
+
+#include "combinators/oznode_eval_visitor.h"
+#include "store/bytecode.h"
+#include "store/compiler.h"
+#include "store/engine.h"
+
+namespace store {
+
+TEST(PackedCodeTest, RoundTrip) {
+  const Value atom = Atom::Get("atom");
+  vector<Bytecode> bytecode;
+  bytecode.push_back(
+      Bytecode(Bytecode::LOAD,
+               Operand(Register(Register::LOCAL, 3)),
+               Operand(atom)));
+  bytecode.push_back(
+      Bytecode(Bytecode::UNIFY,
+               Operand(Register(Register::PARAM, 1)),
+               Operand(Value::Integer(7))));
+  bytecode.push_back(
+      Bytecode(Bytecode::BRANCH_IF,
+               Operand(Register(Register::ENVMT, 2)),
+               Operand(Value::Integer(0))));
+  bytecode.push_back(
+      Bytecode(Bytecode::LOAD,
+               Operand(Register(Register::EXN)),
+               Operand(atom)));
+  bytecode.push_back(Bytecode(Bytecode::RETURN));
+
+  const PackedCode code(bytecode);
+  ASSERT_EQ(bytecode.size(), code.size());
+  // The atom appears twice but is pooled once.
+  EXPECT_EQ(3UL, code.nconstants());
+  for (uint64 i = 0; i < bytecode.size(); ++i) {
+    const Bytecode unpacked = code.Unpack(i);
+    EXPECT_EQ(bytecode[i].opcode, unpacked.opcode);
+    EXPECT_TRUE(bytecode[i].operand1 == unpacked.operand1);
+    EXPECT_TRUE(bytecode[i].operand2 == unpacked.operand2);
+    EXPECT_TRUE(bytecode[i].operand3 == unpacked.operand3);
+  }
+  EXPECT_EQ(4U, code.nregisters(Register::LOCAL));
+  EXPECT_EQ(2U, code.nregisters(Register::PARAM));
+  EXPECT_EQ(3U, code.nregisters(Register::ENVMT));
+  EXPECT_EQ(0U, code.nregisters(Register::ARRAY));
+  EXPECT_EQ(Bytecode::LOAD, PackedCode::GetOpcode(code.instructions()[0]));
+  EXPECT_EQ(uint32(PackedCode::CONSTANT),
+            PackedCode::GetOperandKind(
+                PackedCode::GetOperand(code.instructions()[0], 2)));
+}
+
+TEST(PackedCodeTest, OperandLimits) {
+  const int kMaxIndex = PackedCode::kMaxOperandIndex;
+  vector<Bytecode> bytecode;
+  bytecode.push_back(
+      Bytecode(Bytecode::LOAD,
+               Operand(Register(Register::LOCAL, kMaxIndex)),
+               Operand(Register(Register::PARAM, 0))));
+  EXPECT_EQ(uint32(kMaxIndex) + 1,
+            PackedCode(bytecode).nregisters(Register::LOCAL));
+
+  bytecode[0].operand1 = Operand(Register(Register::LOCAL, kMaxIndex + 1));
+  EXPECT_THROW(PackedCode code(bytecode), CodeTooLarge);
+
+  // As many distinct immediate values as the constant pool can index.
+  bytecode.clear();
+  for (int i = 0; i <= kMaxIndex; ++i)
+    bytecode.push_back(
+        Bytecode(Bytecode::LOAD,
+                 Operand(Register(Register::LOCAL, 0)),
+                 Operand(Value::Integer(i))));
+  EXPECT_EQ(uint64(kMaxIndex) + 1, PackedCode(bytecode).nconstants());
+
+  // One more distinct immediate value overflows the constant pool, while
+  // a value already pooled does not.
+  bytecode.push_back(
+      Bytecode(Bytecode::LOAD,
+               Operand(Register(Register::LOCAL, 0)),
+               Operand(Value::Integer(0))));
+  EXPECT_EQ(uint64(kMaxIndex) + 1, PackedCode(bytecode).nconstants());
+  bytecode.push_back(
+      Bytecode(Bytecode::LOAD,
+               Operand(Register(Register::LOCAL, 0)),
+               Operand(Value::Integer(kMaxIndex + 1))));
+  EXPECT_THROW(PackedCode code(bytecode), CodeTooLarge);
+}
+
+TEST(PackedCodeTest, UndersizedRegisterArrays) {
+  StaticStore store(1024 * 1024);
+
+  // The array register is first set to an array smaller than its highest
+  // index, and a branch skips a local register past the locals array.
+  const Operand array(Register(Register::ARRAY_ARRAY));
+  const Operand a1(Register(Register::ARRAY, 1));
+  const Operand p0(Register(Register::PARAM, 0));
+  const Operand l5(Register(Register::LOCAL, 5));
+  shared_ptr<vector<Bytecode> > code(new vector<Bytecode>);
+  code->push_back(Bytecode(Bytecode::NEW_ARRAY, array,
+                           Operand(Value::Integer(1)), Operand(KAtomNil())));
+  code->push_back(Bytecode(Bytecode::NEW_ARRAY, array,
+                           Operand(Value::Integer(2)), Operand(KAtomNil())));
+  code->push_back(Bytecode(Bytecode::LOAD, a1, Operand(Value::Integer(5))));
+  code->push_back(Bytecode(Bytecode::UNIFY, p0, a1));
+  code->push_back(Bytecode(Bytecode::BRANCH, Operand(Value::Integer(6))));
+  code->push_back(Bytecode(Bytecode::LOAD, l5, Operand(Value::Integer(0))));
+  code->push_back(Bytecode(Bytecode::RETURN));
+  Closure* const closure = Closure::New(&store, code, 1, 1, 0);
+
+  Array* const params = Array::New(&store, 1, Value());
+  params->Assign(0, New::Free(&store));
+
+  Engine engine;
+  Thread::New(&store, &engine, closure, params, &store);
+  engine.Run();
+
+  EXPECT_TRUE(params->Access(0).Deref() == Value::Integer(5));
+}
+
+TEST(PackedCodeTest, InlineCaches) {
+  vector<Bytecode> bytecode;
+  bytecode.push_back(Bytecode(Bytecode::RETURN));
+  EXPECT_TRUE(PackedCode(bytecode).inline_caches() == NULL);
+
+  bytecode.insert(
+      bytecode.begin(),
+      Bytecode(Bytecode::ACCESS_RECORD,
+               Operand(Register(Register::LOCAL, 0)),
+               Operand(Register(Register::PARAM, 0)),
+               Operand(Atom::Get("x"))));
+  const PackedCode code(bytecode);
+  ASSERT_TRUE(code.inline_caches() != NULL);
+  EXPECT_TRUE(code.inline_caches()[0].arity == NULL);
+}
+
+TEST(PackedCodeTest, InlineCacheHits) {
+  StaticStore store(1024 * 1024);
+  const Value code_desc = combinators::oz::ParseEval(
+      "'proc'(code: loop("
+      "    range: range(var:i 'from':1 to:10)"
+      "    body: conditional(cases: cases("
+      "        match(value:point(x:var(i) y:2)"
+      "              cases:t(with(pattern:point(x:decl_var(a) y:2)"
+      "                           'then':'skip')))))))",
+      &store);
+  Compiler compiler(&store, NULL);
+  vector<string> env;
+  Closure* const closure = compiler.CompileProcedure(code_desc, &env);
+
+  Engine engine;
+  New::Thread(&store, &engine, closure, Array::EmptyArray, &store);
+  engine.Run();
+
+  // Building and matching the record looks 2 features up twice per
+  // iteration, through 4 instructions that only miss the first time.
+  const InlineCacheStats& stats = engine.inline_cache_stats();
+  EXPECT_EQ(4UL, stats.nmisses);
+  EXPECT_EQ(36UL, stats.nhits);
+  EXPECT_DOUBLE_EQ(0.9, stats.hit_rate());
+}
+
+}  // namespace store
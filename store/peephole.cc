@@ -0,0 +1,371 @@
+#include "store/peephole.h"
+
+#include <vector>
+using std::vector;
+
+#include <glog/logging.h>
+
+#include "store/values.h"
+
+namespace store {
+
+namespace {
+
+const int64 kNoInstruction = -1;
+
+// @returns True if the operand is the specified register.
+bool IsRegister(const Operand& operand, const Register& reg) {
+  return (operand.type == Operand::REGISTER) && (operand.reg == reg);
+}
+
+// @returns True if the operand is a local register.
+bool IsLocal(const Operand& operand) {
+  return (operand.type == Operand::REGISTER)
+      && (operand.reg.type == Register::LOCAL);
+}
+
+// @returns True if the operand is the immediate small integer value.
+bool IsSmallInteger(const Operand& operand, int64 value) {
+  if (operand.type != Operand::IMMEDIATE) return false;
+  Value immediate = operand.value;
+  immediate = immediate.Deref();
+  return HasType(immediate, Value::SMALL_INTEGER)
+      && (SmallInteger(immediate).value() == value);
+}
+
+// @returns True if the instruction writes its first operand, and reads the
+//     other ones.
+bool WritesOperand1(Bytecode::OpcodeType opcode) {
+  switch (opcode) {
+    case Bytecode::LOAD:
+    case Bytecode::EXN_RESET:
+    case Bytecode::NEW_VARIABLE:
+    case Bytecode::NEW_NAME:
+    case Bytecode::NEW_CELL:
+    case Bytecode::NEW_ARRAY:
+    case Bytecode::NEW_ARITY:
+    case Bytecode::NEW_LIST:
+    case Bytecode::NEW_TUPLE:
+    case Bytecode::NEW_RECORD:
+    case Bytecode::NEW_PROC:
+    case Bytecode::NEW_THREAD:
+    case Bytecode::GET_VALUE_TYPE:
+    case Bytecode::ACCESS_CELL:
+    case Bytecode::ACCESS_ARRAY:
+    case Bytecode::ACCESS_RECORD:
+    case Bytecode::ACCESS_RECORD_LABEL:
+    case Bytecode::ACCESS_RECORD_ARITY:
+    case Bytecode::ACCESS_OPEN_RECORD_ARITY:
+    case Bytecode::TEST_IS_DET:
+    case Bytecode::TEST_IS_RECORD:
+    case Bytecode::TEST_EQUALITY:
+    case Bytecode::TEST_LESS_THAN:
+    case Bytecode::TEST_LESS_OR_EQUAL:
+    case Bytecode::TEST_ARITY_EXTENDS:
+    case Bytecode::NUMBER_INT_INVERSE:
+    case Bytecode::NUMBER_INT_ADD:
+    case Bytecode::NUMBER_INT_SUBTRACT:
+    case Bytecode::NUMBER_INT_MULTIPLY:
+    case Bytecode::NUMBER_INT_DIVIDE:
+    case Bytecode::NUMBER_FLOAT_INVERSE:
+    case Bytecode::NUMBER_FLOAT_ADD:
+    case Bytecode::NUMBER_FLOAT_SUBTRACT:
+    case Bytecode::NUMBER_FLOAT_MULTIPLY:
+    case Bytecode::NUMBER_FLOAT_DIVIDE:
+    case Bytecode::NUMBER_BOOL_NEGATE:
+    case Bytecode::NUMBER_BOOL_AND_THEN:
+    case Bytecode::NUMBER_BOOL_OR_ELSE:
+    case Bytecode::NUMBER_BOOL_XOR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// @returns The operand holding the code pointer an instruction may branch
+//     to, or NULL.
+Operand* GetBranchTarget(Bytecode* bytecode) {
+  switch (bytecode->opcode) {
+    case Bytecode::BRANCH:
+    case Bytecode::EXN_PUSH_CATCH:
+    case Bytecode::EXN_PUSH_FINALLY:
+      return &bytecode->operand1;
+    case Bytecode::BRANCH_IF:
+    case Bytecode::BRANCH_UNLESS:
+      return &bytecode->operand2;
+    case Bytecode::BRANCH_IF_LESS_THAN:
+    case Bytecode::BRANCH_UNLESS_EQUAL:
+      return &bytecode->operand3;
+    default:
+      return NULL;
+  }
+}
+
+// @returns The code pointer a branch target operand refers to,
+//     or kNoInstruction if it is not an immediate small integer.
+int64 GetCodePointer(const Operand& target) {
+  if (target.type != Operand::IMMEDIATE) return kNoInstruction;
+  Value value = target.value;
+  value = value.Deref();
+  if (!HasType(value, Value::SMALL_INTEGER)) return kNoInstruction;
+  return SmallInteger(value).value();
+}
+
+// -----------------------------------------------------------------------------
+
+// Control-flow and register usage of a bytecode segment.
+class SegmentAnalysis {
+ public:
+  explicit SegmentAnalysis(const vector<Bytecode>& segment)
+      : segment_(segment),
+        supported_(true),
+        branch_target_(segment.size() + 1, false) {
+    for (uint64 ip = 0; ip < segment_.size(); ++ip) {
+      Bytecode bytecode = segment_[ip];
+      if (bytecode.opcode == Bytecode::BRANCH_SWITCH_LITERAL) {
+        supported_ = false;
+        return;
+      }
+      const Operand* const target = GetBranchTarget(&bytecode);
+      if (target == NULL) continue;
+      const int64 code_pointer = GetCodePointer(*target);
+      if ((code_pointer < 0) || (code_pointer > int64(segment_.size()))) {
+        supported_ = false;
+        return;
+      }
+      branch_target_[code_pointer] = true;
+      if ((bytecode.opcode == Bytecode::EXN_PUSH_CATCH)
+          || (bytecode.opcode == Bytecode::EXN_PUSH_FINALLY))
+        handlers_.push_back(code_pointer);
+    }
+  }
+
+  // @returns Whether the segment control-flow can be analyzed.
+  bool supported() const { return supported_; }
+
+  // @returns Whether some instruction may branch to the given code pointer.
+  bool IsBranchTarget(uint64 ip) const { return branch_target_[ip]; }
+
+  // @returns True if no instruction executed after the one at the given
+  //     code pointer reads the register before writing it.
+  // Exception handlers are assumed reachable from any instruction.
+  bool IsDeadAfter(const Register& reg, uint64 ip) const {
+    vector<bool> visited(segment_.size(), false);
+    vector<uint64> pending(handlers_);
+    AddSuccessors(ip, &pending);
+    while (!pending.empty()) {
+      const uint64 next = pending.back();
+      pending.pop_back();
+      if ((next >= segment_.size()) || visited[next]) continue;
+      visited[next] = true;
+      if (Reads(segment_[next], reg)) return false;
+      if (WritesOperand1(segment_[next].opcode)
+          && IsRegister(segment_[next].operand1, reg))
+        continue;
+      AddSuccessors(next, &pending);
+    }
+    return true;
+  }
+
+ private:
+  // @returns True if the instruction may read the register.
+  static bool Reads(const Bytecode& bytecode, const Register& reg) {
+    // Tail calls run the callee on the current local registers.
+    if (bytecode.opcode == Bytecode::CALL_TAIL) return true;
+    const Operand* const operands[] = {
+      &bytecode.operand1, &bytecode.operand2, &bytecode.operand3
+    };
+    const bool writes_operand1 = WritesOperand1(bytecode.opcode);
+    for (int i = 0; i < 3; ++i) {
+      const Operand& operand = *operands[i];
+      if (operand.type != Operand::REGISTER) continue;
+      // Accessing the whole array of local registers may read any of them.
+      if ((reg.type == Register::LOCAL)
+          && (operand.reg.type == Register::LOCAL_ARRAY))
+        return true;
+      if ((i == 0) && writes_operand1) continue;
+      if ((i == 2) && (bytecode.opcode == Bytecode::TRY_UNIFY)) continue;
+      if (operand.reg == reg) return true;
+    }
+    return false;
+  }
+
+  // Lists the code pointers an instruction may continue with.
+  // Exception handlers are not listed.
+  void AddSuccessors(uint64 ip, vector<uint64>* successors) const {
+    Bytecode bytecode = segment_[ip];
+    switch (bytecode.opcode) {
+      case Bytecode::RETURN:
+      case Bytecode::EXN_RAISE:
+      case Bytecode::CALL_TAIL:
+        return;
+      case Bytecode::BRANCH:
+        successors->push_back(GetCodePointer(bytecode.operand1));
+        return;
+      case Bytecode::EXN_PUSH_CATCH:
+      case Bytecode::EXN_PUSH_FINALLY:
+        break;
+      default: {
+        // Conditional branches.
+        const Operand* const target = GetBranchTarget(&bytecode);
+        if (target != NULL) successors->push_back(GetCodePointer(*target));
+        break;
+      }
+    }
+    successors->push_back(ip + 1);
+  }
+
+  const vector<Bytecode>& segment_;
+
+  // Whether the control-flow of the segment is known.
+  bool supported_;
+
+  // Whether some instruction branches to each code pointer.
+  vector<bool> branch_target_;
+
+  // Code pointers of the exception handlers.
+  vector<uint64> handlers_;
+};
+
+// -----------------------------------------------------------------------------
+// Fusion patterns.
+// Each pattern matches the segment at a given code pointer, and appends the
+// fused instructions to the output segment.
+// @returns The code pointer following the fused instructions, or 0 if the
+//     pattern does not match.
+
+// test_less_than + branch_if, test_equality + branch_unless.
+uint64 FuseCompareAndBranch(const vector<Bytecode>& segment,
+                            const SegmentAnalysis& analysis,
+                            uint64 ip,
+                            vector<Bytecode>* fused) {
+  if (ip + 1 >= segment.size()) return 0;
+  const Bytecode& test = segment[ip];
+  const Bytecode& branch = segment[ip + 1];
+
+  Bytecode::OpcodeType opcode;
+  if ((test.opcode == Bytecode::TEST_LESS_THAN)
+      && (branch.opcode == Bytecode::BRANCH_IF))
+    opcode = Bytecode::BRANCH_IF_LESS_THAN;
+  else if ((test.opcode == Bytecode::TEST_EQUALITY)
+           && (branch.opcode == Bytecode::BRANCH_UNLESS))
+    opcode = Bytecode::BRANCH_UNLESS_EQUAL;
+  else
+    return 0;
+
+  if (!IsLocal(test.operand1)) return 0;
+  const Register cond = test.operand1.reg;
+  if (!IsRegister(branch.operand1, cond)) return 0;
+  if (analysis.IsBranchTarget(ip + 1)) return 0;
+  if (!analysis.IsDeadAfter(cond, ip + 1)) return 0;
+
+  fused->push_back(
+      Bytecode(opcode, test.operand2, test.operand3, branch.operand2));
+  return ip + 2;
+}
+
+// array + assign_array * N + call or call_native.
+uint64 FuseCall(const vector<Bytecode>& segment,
+                const SegmentAnalysis& analysis,
+                uint64 ip,
+                vector<Bytecode>* fused) {
+  const Bytecode& new_array = segment[ip];
+  if (new_array.opcode != Bytecode::NEW_ARRAY) return 0;
+  if (!IsLocal(new_array.operand1)) return 0;
+  const Register array = new_array.operand1.reg;
+
+  // Instructions creating the variables for returned values.
+  vector<Bytecode> new_variables;
+  vector<Operand> args;
+  uint64 next = ip + 1;
+  for (; next < segment.size(); ++next) {
+    if (analysis.IsBranchTarget(next)) return 0;
+    const Bytecode& bytecode = segment[next];
+    if (bytecode.opcode == Bytecode::ASSIGN_ARRAY) {
+      if (!IsRegister(bytecode.operand1, array)) return 0;
+      if (!IsSmallInteger(bytecode.operand2, args.size())) return 0;
+      if (IsRegister(bytecode.operand3, array)) return 0;
+      args.push_back(bytecode.operand3);
+
+    } else if (bytecode.opcode == Bytecode::NEW_VARIABLE) {
+      // Moved before the array: must not be an earlier argument.
+      const Operand& variable = bytecode.operand1;
+      if (variable.type != Operand::REGISTER) return 0;
+      if (IsRegister(variable, array)) return 0;
+      if (new_array.operand2 == variable) return 0;
+      if (new_array.operand3 == variable) return 0;
+      for (auto it = args.begin(); it != args.end(); ++it)
+        if (*it == variable) return 0;
+      new_variables.push_back(bytecode);
+
+    } else {
+      break;
+    }
+  }
+  if (args.empty() || !IsSmallInteger(new_array.operand2, args.size()))
+    return 0;
+
+  if (next >= segment.size()) return 0;
+  const Bytecode& call = segment[next];
+  Bytecode::OpcodeType opcode;
+  if (call.opcode == Bytecode::CALL)
+    opcode = Bytecode::CALL_ARGS;
+  else if (call.opcode == Bytecode::CALL_NATIVE)
+    opcode = Bytecode::CALL_NATIVE_ARGS;
+  else
+    return 0;
+  if (!IsRegister(call.operand2, array)) return 0;
+  if (IsRegister(call.operand1, array)) return 0;
+  if (!analysis.IsDeadAfter(array, next)) return 0;
+
+  fused->insert(fused->end(), new_variables.begin(), new_variables.end());
+  fused->push_back(
+      Bytecode(opcode, call.operand1, Operand(Value::Integer(args.size()))));
+  for (uint64 i = 0; i < args.size(); i += 3) {
+    Bytecode arguments(Bytecode::ARGUMENTS);
+    arguments.operand1 = args[i];
+    if (i + 1 < args.size()) arguments.operand2 = args[i + 1];
+    if (i + 2 < args.size()) arguments.operand3 = args[i + 2];
+    fused->push_back(arguments);
+  }
+  return next + 1;
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------------
+
+void FuseSuperinstructions(vector<Bytecode>* segment) {
+  CHECK_NOTNULL(segment);
+  const SegmentAnalysis analysis(*segment);
+  if (!analysis.supported()) return;
+
+  // Code pointer of each instruction in the fused segment.
+  // kNoInstruction for the instructions fused into a previous one.
+  vector<int64> fused_ip(segment->size() + 1, kNoInstruction);
+  vector<Bytecode> fused;
+  fused.reserve(segment->size());
+  uint64 ip = 0;
+  while (ip < segment->size()) {
+    fused_ip[ip] = fused.size();
+    uint64 next = FuseCompareAndBranch(*segment, analysis, ip, &fused);
+    if (next == 0) next = FuseCall(*segment, analysis, ip, &fused);
+    if (next == 0) {
+      fused.push_back((*segment)[ip]);
+      next = ip + 1;
+    }
+    ip = next;
+  }
+  fused_ip[segment->size()] = fused.size();
+
+  for (auto it = fused.begin(); it != fused.end(); ++it) {
+    Operand* const target = GetBranchTarget(&*it);
+    if (target == NULL) continue;
+    const int64 code_pointer = fused_ip[GetCodePointer(*target)];
+    CHECK_NE(code_pointer, kNoInstruction);
+    *target = Operand(Value::Integer(code_pointer));
+  }
+  segment->swap(fused);
+}
+
+}  // namespace store
@@ -0,0 +1,33 @@
+// Peephole optimization of compiled bytecode segments.
+#ifndef STORE_PEEPHOLE_H_
+#define STORE_PEEPHOLE_H_
+
+#include <vector>
+using std::vector;
+
+namespace store {
+
+struct Bytecode;
+
+// Fuses the instruction sequences the compiler emits the most into
+// superinstructions, to reduce the number of instructions dispatched:
+//  - test_less_than + branch_if into branch_if_less_than,
+//  - test_equality + branch_unless into branch_unless_equal,
+//    when the tested temporary register is not read afterwards;
+//  - array + assign_array * N + call (or call_native) into call_args
+//    (or call_native_args) with N inline arguments, when the parameter array
+//    register is not read after the call. The var instructions creating
+//    returned values in the middle of the sequence are moved before it.
+//
+// A sequence is only fused when no branch lands inside it.
+// Branch targets are rewritten to match the fused segment.
+// Segments with computed branches (branch_switch_literal or non-immediate
+// targets) are left untouched.
+//
+// @param segment The bytecode segment to optimize, in place.
+//     Branch targets must be determined.
+void FuseSuperinstructions(vector<Bytecode>* segment);
+
+}  // namespace store
+
+#endif  // STORE_PEEPHOLE_H_
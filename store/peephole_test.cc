@@ -0,0 +1,110 @@
+#include "store/peephole.h"
+
+#include <vector>
+using std::vector;
+
+#include <gtest/gtest.h>
+
+#include "store/values.h"
+
+namespace store {
+
+namespace {
+
+Operand L(int index) {
+  return Operand(Register(Register::LOCAL, index));
+}
+
+Operand P(int index) {
+  return Operand(Register(Register::PARAM, index));
+}
+
+Operand I(int64 value) {
+  return Operand(Value::Integer(value));
+}
+
+// @returns The branch target of an immediate operand.
+int64 Target(const Operand& operand) {
+  return SmallInteger(operand.value).value();
+}
+
+}  // namespace
+
+TEST(PeepholeTest, CompareAndBranch) {
+  vector<Bytecode> segment;
+  segment.push_back(Bytecode(Bytecode::LOAD, L(0), I(1)));
+  segment.push_back(Bytecode(Bytecode::TEST_LESS_THAN, L(1), P(0), L(0)));
+  segment.push_back(Bytecode(Bytecode::BRANCH_IF, L(1), I(5)));
+  segment.push_back(Bytecode(Bytecode::NUMBER_INT_ADD, L(0), L(0), I(1)));
+  segment.push_back(Bytecode(Bytecode::BRANCH, I(1)));
+  segment.push_back(Bytecode(Bytecode::RETURN));
+
+  FuseSuperinstructions(&segment);
+  ASSERT_EQ(5UL, segment.size());
+  EXPECT_EQ(Bytecode::BRANCH_IF_LESS_THAN, segment[1].opcode);
+  EXPECT_TRUE(segment[1].operand1 == P(0));
+  EXPECT_TRUE(segment[1].operand2 == L(0));
+  EXPECT_EQ(4, Target(segment[1].operand3));
+  EXPECT_EQ(Bytecode::BRANCH, segment[3].opcode);
+  EXPECT_EQ(1, Target(segment[3].operand1));
+}
+
+TEST(PeepholeTest, LiveConditionIsKept) {
+  vector<Bytecode> segment;
+  segment.push_back(Bytecode(Bytecode::TEST_EQUALITY, L(0), P(0), P(1)));
+  segment.push_back(Bytecode(Bytecode::BRANCH_UNLESS, L(0), I(3)));
+  segment.push_back(Bytecode(Bytecode::RETURN));
+  segment.push_back(Bytecode(Bytecode::UNIFY, P(2), L(0)));
+  segment.push_back(Bytecode(Bytecode::RETURN));
+
+  FuseSuperinstructions(&segment);
+  ASSERT_EQ(5UL, segment.size());
+  EXPECT_EQ(Bytecode::TEST_EQUALITY, segment[0].opcode);
+  EXPECT_EQ(Bytecode::BRANCH_UNLESS, segment[1].opcode);
+}
+
+TEST(PeepholeTest, CallWithInlineArguments) {
+  vector<Bytecode> segment;
+  segment.push_back(
+      Bytecode(Bytecode::NEW_ARRAY, L(0), I(4), Operand(KAtomEmpty())));
+  segment.push_back(Bytecode(Bytecode::ASSIGN_ARRAY, L(0), I(0), P(0)));
+  segment.push_back(Bytecode(Bytecode::ASSIGN_ARRAY, L(0), I(1), I(7)));
+  segment.push_back(Bytecode(Bytecode::ASSIGN_ARRAY, L(0), I(2), P(1)));
+  segment.push_back(Bytecode(Bytecode::NEW_VARIABLE, L(1)));
+  segment.push_back(Bytecode(Bytecode::ASSIGN_ARRAY, L(0), I(3), L(1)));
+  segment.push_back(Bytecode(Bytecode::CALL, P(2), L(0)));
+  segment.push_back(Bytecode(Bytecode::UNIFY, P(3), L(1)));
+  segment.push_back(Bytecode(Bytecode::RETURN));
+
+  FuseSuperinstructions(&segment);
+  ASSERT_EQ(6UL, segment.size());
+  EXPECT_EQ(Bytecode::NEW_VARIABLE, segment[0].opcode);
+  EXPECT_EQ(Bytecode::CALL_ARGS, segment[1].opcode);
+  EXPECT_TRUE(segment[1].operand1 == P(2));
+  EXPECT_TRUE(segment[1].operand2 == I(4));
+  EXPECT_EQ(Bytecode::ARGUMENTS, segment[2].opcode);
+  EXPECT_TRUE(segment[2].operand1 == P(0));
+  EXPECT_TRUE(segment[2].operand2 == I(7));
+  EXPECT_TRUE(segment[2].operand3 == P(1));
+  EXPECT_EQ(Bytecode::ARGUMENTS, segment[3].opcode);
+  EXPECT_TRUE(segment[3].operand1 == L(1));
+  EXPECT_TRUE(segment[3].operand2.invalid());
+  EXPECT_EQ(Bytecode::UNIFY, segment[4].opcode);
+}
+
+TEST(PeepholeTest, NoFusionAcrossBranchTargets) {
+  vector<Bytecode> segment;
+  segment.push_back(Bytecode(Bytecode::BRANCH, I(3)));
+  segment.push_back(
+      Bytecode(Bytecode::NEW_ARRAY, L(0), I(1), Operand(KAtomEmpty())));
+  segment.push_back(Bytecode(Bytecode::ASSIGN_ARRAY, L(0), I(0), P(0)));
+  segment.push_back(Bytecode(Bytecode::CALL, P(1), L(0)));
+  segment.push_back(Bytecode(Bytecode::RETURN));
+
+  FuseSuperinstructions(&segment);
+  ASSERT_EQ(5UL, segment.size());
+  EXPECT_EQ(Bytecode::CALL, segment[3].opcode);
+  EXPECT_EQ(3, Target(segment[0].operand1));
+}
+
+}  // namespace store
@@ -1,8 +1,5 @@
 #include "store/values.h"
 
-#include <memory>
-using std::unique_ptr;
-
 #include <boost/format.hpp>
 using boost::format;
 
@@ -14,14 +11,16 @@ namespace store {
 const Value::ValueType Record::kType;
 
 Record::Record(Value label, Arity* arity)
-    : label_(label),
+    : HeapValue(kType, Value::CAP_RECORD),
+      label_(label),
       arity_(CHECK_NOTNULL(arity)) {
   CHECK(label.caps() & Value::CAP_LITERAL);
   CHECK(!arity->IsTuple());
 }
 
 Record::Record(Value label, Arity* arity, Value* values)
-    : label_(label),
+    : HeapValue(kType, Value::CAP_RECORD),
+      label_(label),
       arity_(CHECK_NOTNULL(arity)) {
   CHECK(label.caps() & Value::CAP_LITERAL);
   CHECK_NOTNULL(values);
@@ -68,6 +67,11 @@ Value Record::Subtract(Store* store, Value feature) {
   return Value::Record(store, label_, arity, values);
 }
 
+// virtual
+uint64 Record::HeapSize() const {
+  return SizeOfWithNestedArray<Record, Value>(size());
+}
+
 // virtual
 void Record::ExploreValue(ReferenceMap* ref_map) {
   CHECK_NOTNULL(ref_map);
@@ -94,14 +98,10 @@ bool Record::UnifyWith(UnificationContext* context, Value ovalue) {
   if (!Value::Unify(context, label_, ovalue.RecordLabel())) return false;
   if (arity_ != ovalue.RecordArity()) return false;  // arities are interned.
   // Unify all values
+  const RecordSpan ovalues = ovalue.RecordItems();
   const uint64 nvalues = size();
-  unique_ptr<Value::ValueIterator> it_deleter(ovalue.RecordIterValues());
-  Value::ValueIterator& it(*it_deleter);
-  for (uint64 i = 0; i < nvalues; ++i, ++it) {
-    Value value1 = values_[i];
-    Value value2 = *it;
-    if (!Value::Unify(context, value1, value2)) return false;
-  }
+  for (uint64 i = 0; i < nvalues; ++i)
+    if (!Value::Unify(context, values_[i], ovalues.value(i))) return false;
   return true;
 }
 
@@ -118,12 +118,15 @@ bool Record::Equals(EqualityContext* context, Value value) {
 
 // virtual
 HeapValue* Record::MoveInternal(Store* store) {
-  // TODO: We could save the array copy here...
+  return New(store, label_, arity_, values_);
+}
+
+// virtual
+void Record::MoveReferences(MoveContext* context) {
+  label_ = context->Move(label_);
   const uint64 nvalues = size();
-  Value moved_values[nvalues];
   for (uint64 i = 0; i < nvalues; ++i)
-    moved_values[i] = values_[i].Move(store);
-  return New(store, label_.Move(store), arity_, moved_values);
+    values_[i] = context->Move(values_[i]);
 }
 
 // virtual
@@ -66,14 +66,14 @@ class Record : public HeapValue {
 
   // ---------------------------------------------------------------------------
   // Value API
-  virtual ValueType type() const noexcept { return kType; }
-  virtual uint64 caps() const { return Value::CAP_RECORD; }
+  virtual uint64 HeapSize() const;
 
   virtual void ExploreValue(ReferenceMap* ref_map);
   virtual Value Optimize(OptimizeContext* context);
   virtual bool UnifyWith(UnificationContext* context, Value value);
   virtual bool Equals(EqualityContext* context, Value value);
   virtual HeapValue* MoveInternal(Store* store);
+  virtual void MoveReferences(MoveContext* context);
   virtual bool IsStateless(StatelessnessContext* context);
 
   // ---------------------------------------------------------------------------
@@ -97,6 +97,8 @@ class Record : public HeapValue {
   }
 
  private:  // ------------------------------------------------------------------
+  // Fixes references up when reading snapshots.
+  friend class SnapshotDecoder;
 
   // Initializes the record with the specified label, arity.
   // Values are left uninitialized.
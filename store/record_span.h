@@ -0,0 +1,69 @@
+#ifndef STORE_RECORD_SPAN_H_
+#define STORE_RECORD_SPAN_H_
+
+#include <utility>
+
+#include <glog/logging.h>
+
+namespace store {
+
+// -----------------------------------------------------------------------------
+// Record span
+//
+// View over the items of a record, tuple or list: its features and values,
+// in order. Spans are not allocated and do not dispatch, unlike
+// Value::RecordIterItems(). They are only valid as long as the underlying
+// value is not moved.
+//
+// Usage:
+//   const RecordSpan span = value.RecordItems();
+//   for (uint64 i = 0; i < span.size(); ++i) {
+//     ... span.feature(i) ... span.value(i) ...
+//   }
+//
+class RecordSpan {
+ public:
+  // Creates an empty span, as for atoms.
+  RecordSpan()
+      : features_(NULL), values_(NULL), size_(0) {
+  }
+
+  // @param features The features, or NULL for the features of a tuple,
+  //     ie. the integers 1 to size.
+  // @param values The values.
+  // @param size The number of items.
+  RecordSpan(const Value* features, const Value* values, uint64 size)
+      : features_(features), values_(values), size_(size) {
+  }
+
+  uint64 size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // @returns The feature of the item at the given index.
+  Value feature(uint64 index) const {
+    DCHECK_LT(index, size_);
+    return (features_ != NULL) ? features_[index] : Value::Integer(index + 1);
+  }
+
+  // @returns The value of the item at the given index.
+  Value value(uint64 index) const {
+    DCHECK_LT(index, size_);
+    return values_[index];
+  }
+
+  // @returns The (feature, value) pair at the given index.
+  std::pair<Value, Value> item(uint64 index) const {
+    return std::make_pair(feature(index), value(index));
+  }
+
+  const Value* values() const { return values_; }
+
+ private:
+  const Value* features_;
+  const Value* values_;
+  uint64 size_;
+};
+
+}  // namespace store
+
+#endif  // STORE_RECORD_SPAN_H_
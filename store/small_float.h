@@ -0,0 +1,110 @@
+#ifndef STORE_SMALL_FLOAT_H_
+#define STORE_SMALL_FLOAT_H_
+
+#include <string.h>
+
+#include <string>
+using std::string;
+
+#include <boost/format.hpp>
+
+#include <glog/logging.h>
+
+namespace store {
+
+// -----------------------------------------------------------------------------
+// Small floats
+//
+// Floats whose binary exponent lies within [-126, 128] are encoded in the
+// value word, without loss of precision. Other floats (zeros excepted) are
+// allocated in the heap as Float values: denormals, huge values, infinities
+// and NaNs. A given float has exactly one representation.
+//
+// The encoding rotates the double left by one bit, moving the sign bit to the
+// least significant position, then rebases the 11 bits exponent so that the
+// small exponents only use the low 8 bits. The 3 free high bits make room for
+// the tag.
+//
+// This class is not meant to be stored. It should only be instantiated as a
+// local variable, where it can be optimized/inlined.
+//
+class SmallFloat {
+ public:
+  static const Value::ValueType kType = Value::FLOAT;
+
+  static inline
+  bool IsSmallFloat(double value) {
+    const uint64 bits = DoubleBits(value);
+    const uint64 exponent = (bits >> kMantissaBits) & kExponentMask;
+    return ((exponent > kExponentOffset)
+            && (exponent <= kExponentOffset + kMaxExponent))
+        || ((bits << 1) == 0);  // +0.0 or -0.0
+  }
+
+  SmallFloat(const Value& value) : value_(Decode(value)) {
+  }
+
+  SmallFloat(double value) : value_(value) {
+    DCHECK(IsSmallFloat(value));
+  }
+
+  inline
+  double value() const { return value_; }
+
+  inline
+  Value Encode() const {
+    uint64 rotated = RotateLeft(DoubleBits(value_));
+    if (rotated > 1)  // Not a zero
+      rotated -= kExponentOffset << (kMantissaBits + 1);
+    return Value((rotated << kTagBits) | kFloatTag);
+  }
+
+  inline
+  uint64 caps() const { return Value::CAP_NONE; }
+
+  inline
+  void ToASCII(string* repr) const {
+    repr->append((boost::format("%f") % value_).str());
+  }
+
+ private:
+  static const int kMantissaBits = 52;
+  static const uint64 kExponentMask = 0x7ff;
+
+  // Biased exponents of the small floats are in
+  // ]kExponentOffset, kExponentOffset + kMaxExponent].
+  static const uint64 kExponentOffset = 1023 - 127;
+  static const uint64 kMaxExponent = 0xff;
+
+  static inline
+  uint64 DoubleBits(double value) {
+    uint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  static inline
+  uint64 RotateLeft(uint64 bits) { return (bits << 1) | (bits >> 63); }
+
+  static inline
+  uint64 RotateRight(uint64 bits) { return (bits >> 1) | (bits << 63); }
+
+  static inline
+  double Decode(const Value& value) {
+    DCHECK_EQ(kFloatTag, value.tag());
+    uint64 rotated = value.bits() >> kTagBits;
+    if (rotated > 1)  // Not a zero
+      rotated += kExponentOffset << (kMantissaBits + 1);
+    const uint64 bits = RotateRight(rotated);
+    double decoded;
+    memcpy(&decoded, &bits, sizeof(decoded));
+    return decoded;
+  }
+
+  // The small float value.
+  const double value_;
+};
+
+}  // namespace store
+
+#endif  // STORE_SMALL_FLOAT_H_
@@ -0,0 +1,90 @@
+// Tests for small floats.
+#include "store/values.h"
+
+#include <cmath>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include "store/engine.h"
+
+namespace store {
+
+const uint64 kStoreSize = 1024 * 1024;
+
+TEST(SmallFloat, Encoding) {
+  StaticStore store(kStoreSize);
+
+  const double small[] = {
+    0.0, -0.0, 1.0, -1.0, 0.1, 2.5, 3.141592653589793, 1e-30, 1e30,
+    std::ldexp(1.0, -126), std::ldexp(1.0, 128) * 1.5,
+  };
+  for (uint64 i = 0; i < ArraySize(small); ++i) {
+    const Value value = New::Float(&store, small[i]);
+    EXPECT_TRUE(value.IsSmallFloat()) << small[i];
+    EXPECT_EQ(Value::FLOAT, value.type());
+    EXPECT_EQ(std::signbit(small[i]), std::signbit(FloatValue(value)));
+    EXPECT_EQ(small[i], FloatValue(value));
+  }
+
+  const double large[] = {
+    std::ldexp(1.0, -127), std::ldexp(1.0, 129), 1e300, -1e-300,
+    std::numeric_limits<double>::denorm_min(),
+    std::numeric_limits<double>::infinity(),
+  };
+  for (uint64 i = 0; i < ArraySize(large); ++i) {
+    const Value value = New::Float(&store, large[i]);
+    EXPECT_TRUE(value.IsHeapValue()) << large[i];
+    EXPECT_EQ(Value::FLOAT, value.type());
+    EXPECT_EQ(large[i], FloatValue(value));
+  }
+  EXPECT_TRUE(std::isnan(
+      FloatValue(New::Float(&store, std::numeric_limits<double>::quiet_NaN()))));
+
+  EXPECT_EQ("2.500000", New::Float(&store, 2.5).ToString());
+  EXPECT_TRUE(New::Float(&store, 2.5) == New::Float(&store, 2.5));
+  EXPECT_TRUE(Unify(New::Float(&store, 2.5), New::Float(&store, 2.5)));
+  EXPECT_FALSE(Equals(New::Float(&store, 2.5), New::Float(&store, -2.5)));
+  EXPECT_TRUE(Equals(New::Float(&store, 1e300), New::Float(&store, 1e300)));
+
+  // +0.0 and -0.0 have distinct encodings, but are equal.
+  const Value zero = New::Float(&store, 0.0);
+  const Value negative_zero = New::Float(&store, -0.0);
+  EXPECT_TRUE(zero != negative_zero);
+  EXPECT_TRUE(Equals(zero, negative_zero));
+  EXPECT_TRUE(Unify(zero, negative_zero));
+}
+
+TEST(SmallFloat, Arithmetic) {
+  StaticStore store(kStoreSize);
+
+  // p1 = -(p0 * 3.0 + 1.0) / 2.0
+  const Operand l0(Register(Register::LOCAL, 0));
+  const Operand p0(Register(Register::PARAM, 0));
+  const Operand p1(Register(Register::PARAM, 1));
+  shared_ptr<vector<Bytecode> > code(new vector<Bytecode>);
+  code->push_back(Bytecode(Bytecode::NUMBER_FLOAT_MULTIPLY,
+                           l0, p0, Operand(New::Float(&store, 3.0))));
+  code->push_back(Bytecode(Bytecode::NUMBER_FLOAT_ADD,
+                           l0, l0, Operand(New::Float(&store, 1.0))));
+  code->push_back(Bytecode(Bytecode::NUMBER_FLOAT_DIVIDE,
+                           l0, l0, Operand(New::Float(&store, 2.0))));
+  code->push_back(Bytecode(Bytecode::NUMBER_FLOAT_INVERSE, l0, l0));
+  code->push_back(Bytecode(Bytecode::UNIFY, p1, l0));
+  code->push_back(Bytecode(Bytecode::RETURN));
+  Closure* const closure = Closure::New(&store, code, 2, 1, 0);
+
+  Array* const params = Array::New(&store, 2, Value());
+  params->Assign(0, New::Float(&store, 1.5));
+  params->Assign(1, New::Free(&store));
+
+  Engine engine;
+  Thread::New(&store, &engine, closure, params, &store);
+  engine.Run();
+
+  const Value result = params->Access(1).Deref();
+  EXPECT_TRUE(result.IsSmallFloat());
+  EXPECT_EQ(-2.75, FloatValue(result));
+}
+
+}  // namespace store
@@ -17,8 +17,9 @@ void SmallInteger::ToASCII(string* repr) const {
 inline
 bool SmallInteger::LiteralLessThan(Value other) const {
   switch (other.tag()) {
-    case kHeapValueTag: return value_ < other.as<Integer>()->mpz();
+    case kHeapValueTag: return other.as<Integer>()->Compare(value_) > 0;
     case kSmallIntTag: return value_ < SmallInteger(other).value();
+    default: break;
   }
   throw NotImplemented();
 }
@@ -0,0 +1,503 @@
+#include "store/snapshot.h"
+
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <vector>
+using std::shared_ptr;
+using std::vector;
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "store/values.h"
+
+namespace store {
+
+namespace {
+
+// "OZSNAP" followed by the format version.
+const uint64 kSnapshotMagic = 0x4f5a534e41500002ULL;
+
+// Header words: magic, number of nodes, root reference.
+const uint64 kHeaderSize = 3;
+
+// Kinds of nodes in an image.
+enum NodeKind {
+  NODE_ATOM = 1,
+  NODE_BOOLEAN,
+  NODE_NAME,
+  NODE_STRING,
+  NODE_FLOAT,
+  NODE_INTEGER,
+  NODE_ARITY,
+  NODE_LIST,
+  NODE_TUPLE,
+  NODE_RECORD,
+  NODE_CELL,
+  NODE_ARRAY,
+  NODE_VARIABLE,
+  NODE_CLOSURE,
+  NODE_CODE,  // A bytecode segment, possibly shared by several closures.
+};
+
+// -----------------------------------------------------------------------------
+
+// Encodes a value graph into an image.
+class Encoder {
+ public:
+  Encoder() {}
+
+  void Encode(Value root, string* image) {
+    const uint64 root_ref = Ref(root);
+    // Nodes are discovered while encoding the nodes before them.
+    vector<vector<uint64> > nodes;
+    for (uint64 i = 0; i < nodes_.size(); ++i) {
+      nodes.push_back(vector<uint64>());
+      EncodeNode(nodes_[i], &nodes.back());
+    }
+
+    vector<uint64> words;
+    words.push_back(kSnapshotMagic);
+    words.push_back(nodes.size());
+    words.push_back(root_ref);
+    uint64 offset = kHeaderSize + nodes.size();
+    for (uint64 i = 0; i < nodes.size(); ++i) {
+      words.push_back(offset);
+      offset += nodes[i].size();
+    }
+    for (uint64 i = 0; i < nodes.size(); ++i)
+      words.insert(words.end(), nodes[i].begin(), nodes[i].end());
+    image->assign(reinterpret_cast<const char*>(words.data()),
+                  words.size() * sizeof(uint64));
+  }
+
+ private:
+  struct Node {
+    // A heap value, or a bytecode segment when NULL.
+    HeapValue* value;
+    const PackedCode* code;
+  };
+
+  // @returns The reference word for a value.
+  //     Heap values and atoms are replaced by their node number, starting
+  //     from 1: immediate atoms are indexes in the atom table of this process.
+  //     Other values are position independent: they are kept as is.
+  uint64 Ref(Value value) {
+    if (!value.IsDefined()) return 0;
+    if (value.IsAtom()) return NodeNumber(value.as<Atom>(), NULL) << kTagBits;
+    if (!value.IsHeapValue()) return value.bits();
+    return NodeNumber(value.heap_value(), NULL) << kTagBits;
+  }
+
+  uint64 CodeRef(const PackedCode* code) {
+    return NodeNumber(NULL, code) << kTagBits;
+  }
+
+  uint64 NodeNumber(HeapValue* value, const PackedCode* code) {
+    const void* const key = (value != NULL)
+        ? static_cast<const void*>(value)
+        : static_cast<const void*>(code);
+    auto it = numbers_.find(key);
+    if (it != numbers_.end()) return it->second;
+    Node node = { value, code };
+    nodes_.push_back(node);
+    numbers_[key] = nodes_.size();
+    return nodes_.size();
+  }
+
+  static void EncodeString(const string& str, vector<uint64>* words) {
+    words->push_back(str.size());
+    const uint64 first = words->size();
+    words->resize(first + (str.size() + sizeof(uint64) - 1) / sizeof(uint64));
+    memcpy(words->data() + first, str.data(), str.size());
+  }
+
+  // @param node The node to encode, by value: encoding it appends the nodes
+  //     it references to nodes_, which may reallocate.
+  // @param words Returns the encoded node.
+  void EncodeNode(Node node, vector<uint64>* words) {
+    if (node.value == NULL) {
+      // Packed instructions are position independent.
+      words->push_back(NODE_CODE);
+      words->push_back(node.code->size());
+      words->insert(words->end(),
+                    node.code->instructions(),
+                    node.code->instructions() + node.code->size());
+      words->push_back(node.code->nconstants());
+      for (uint64 i = 0; i < node.code->nconstants(); ++i)
+        words->push_back(Ref(node.code->constants()[i]));
+      return;
+    }
+
+    const Value value = (node.value->type() == Value::ATOM)
+        ? Value(static_cast<Atom*>(node.value))
+        : Value(node.value);
+    switch (value.type()) {
+      case Value::ATOM: {
+        words->push_back(NODE_ATOM);
+        EncodeString(value.as<Atom>()->value(), words);
+        break;
+      }
+      case Value::BOOLEAN: {
+        words->push_back(NODE_BOOLEAN);
+        words->push_back(value.as<Boolean>()->value());
+        break;
+      }
+      case Value::NAME: {
+        words->push_back(NODE_NAME);
+        break;
+      }
+      case Value::STRING: {
+        words->push_back(NODE_STRING);
+        EncodeString(value.as<String>()->value(), words);
+        break;
+      }
+      case Value::FLOAT: {
+        words->push_back(NODE_FLOAT);
+        const double dvalue = value.as<Float>()->value();
+        uint64 bits;
+        memcpy(&bits, &dvalue, sizeof(bits));
+        words->push_back(bits);
+        break;
+      }
+      case Value::INTEGER: {
+        words->push_back(NODE_INTEGER);
+        EncodeString(value.as<Integer>()->mpz().get_str(16), words);
+        break;
+      }
+      case Value::ARITY: {
+        const vector<Value>& features = value.as<Arity>()->features();
+        words->push_back(NODE_ARITY);
+        words->push_back(features.size());
+        for (auto it = features.begin(); it != features.end(); ++it)
+          words->push_back(Ref(*it));
+        break;
+      }
+      case Value::LIST: {
+        List* const list = value.as<List>();
+        words->push_back(NODE_LIST);
+        words->push_back(Ref(list->head()));
+        words->push_back(Ref(list->tail()));
+        break;
+      }
+      case Value::TUPLE: {
+        Tuple* const tuple = value.as<Tuple>();
+        words->push_back(NODE_TUPLE);
+        words->push_back(Ref(tuple->label()));
+        words->push_back(tuple->size());
+        for (uint64 i = 0; i < tuple->size(); ++i)
+          words->push_back(Ref(tuple->values()[i]));
+        break;
+      }
+      case Value::RECORD: {
+        Record* const record = value.as<Record>();
+        words->push_back(NODE_RECORD);
+        words->push_back(Ref(record->label()));
+        words->push_back(Ref(record->arity()));
+        for (uint64 i = 0; i < record->size(); ++i)
+          words->push_back(Ref(record->values()[i]));
+        break;
+      }
+      case Value::CELL: {
+        words->push_back(NODE_CELL);
+        words->push_back(Ref(value.as<Cell>()->Access()));
+        break;
+      }
+      case Value::ARRAY: {
+        Array* const array = value.as<Array>();
+        words->push_back(NODE_ARRAY);
+        words->push_back(array->size());
+        for (uint64 i = 0; i < array->size(); ++i)
+          words->push_back(Ref(array->Access(i)));
+        break;
+      }
+      case Value::VARIABLE: {
+        Variable* const variable = value.as<Variable>();
+        CHECK(variable->suspensions()->empty())
+            << "Cannot snapshot a variable with suspensions.";
+        words->push_back(NODE_VARIABLE);
+        words->push_back(Ref(variable->ref()));
+        break;
+      }
+      case Value::CLOSURE: {
+        Closure* const closure = value.as<Closure>();
+        words->push_back(NODE_CLOSURE);
+        words->push_back(CodeRef(&closure->code()));
+        words->push_back(closure->nparams());
+        words->push_back(closure->nlocals());
+        words->push_back(closure->nclosures());
+        words->push_back(Ref(closure->environment()));
+        break;
+      }
+      default:
+        LOG(FATAL) << "Cannot snapshot values of type "
+                   << ValueTypeName(value.type());
+    }
+  }
+
+  // Nodes, in numbering order.
+  vector<Node> nodes_;
+
+  // Node numbers, keyed by heap value or bytecode segment.
+  UnorderedMap<const void*, uint64> numbers_;
+
+  DISALLOW_COPY_AND_ASSIGN(Encoder);
+};
+
+}  // anonymous namespace
+
+// -----------------------------------------------------------------------------
+
+// Decodes an image into a store.
+class SnapshotDecoder {
+ public:
+  SnapshotDecoder(const char* image, uint64 size, Store* store)
+      : words_(reinterpret_cast<const uint64*>(image)),
+        nwords_(size / sizeof(uint64)),
+        store_(CHECK_NOTNULL(store)) {
+    CHECK_EQ(0UL, size % sizeof(uint64)) << "Truncated snapshot image.";
+    CHECK_GE(nwords_, kHeaderSize) << "Truncated snapshot image.";
+    CHECK_EQ(kSnapshotMagic, words_[0]) << "Not a snapshot image.";
+    nnodes_ = words_[1];
+    CHECK_LE(kHeaderSize + nnodes_, nwords_) << "Truncated snapshot image.";
+  }
+
+  Value Decode() {
+    values_.resize(nnodes_ + 1);
+    codes_.resize(nnodes_ + 1);
+
+    // Creates the values that do not depend on other nodes, and empty shells
+    // for the others.
+    for (uint64 inode = 1; inode <= nnodes_; ++inode) {
+      const uint64* const node = Node(inode);
+      switch (node[0]) {
+        case NODE_ATOM:
+          values_[inode] = Atom::Get(DecodeString(node + 1));
+          break;
+        case NODE_BOOLEAN:
+          values_[inode] = Boolean::GetBoolean(node[1] != 0);
+          break;
+        case NODE_NAME:
+          values_[inode] = Name::New(store_);
+          break;
+        case NODE_STRING:
+          values_[inode] = String::Get(store_, DecodeString(node + 1));
+          break;
+        case NODE_FLOAT: {
+          double dvalue;
+          memcpy(&dvalue, &node[1], sizeof(dvalue));
+          values_[inode] = New::Float(store_, dvalue);
+          break;
+        }
+        case NODE_INTEGER:
+          values_[inode] =
+              Integer::New(store_, mpz_class(DecodeString(node + 1), 16));
+          break;
+        case NODE_ARITY:
+          break;  // Features are decoded first.
+        case NODE_LIST:
+          values_[inode] = List::New(store_, Value(), Value());
+          break;
+        case NODE_TUPLE: {
+          vector<Value> values(node[2]);
+          values_[inode] =
+              Tuple::New(store_, KAtomTuple(), values.size(), values.data());
+          break;
+        }
+        case NODE_RECORD:
+          break;  // The arity is decoded first.
+        case NODE_CELL:
+          values_[inode] = Cell::New(store_, Value());
+          break;
+        case NODE_ARRAY:
+          values_[inode] = Array::New(store_, node[1], Value());
+          break;
+        case NODE_VARIABLE:
+          values_[inode] = Variable::New(store_);
+          break;
+        case NODE_CLOSURE:
+          break;  // The bytecode is decoded first.
+        case NODE_CODE:
+          codes_[inode].reset(
+              new PackedCode(node + 2, node[1], node[2 + node[1]]));
+          break;
+        default:
+          LOG(FATAL) << "Invalid snapshot node kind: " << node[0];
+      }
+    }
+
+    // Arities only reference literals.
+    for (uint64 inode = 1; inode <= nnodes_; ++inode) {
+      const uint64* const node = Node(inode);
+      if (node[0] != NODE_ARITY) continue;
+      vector<Value> features(node[1]);
+      for (uint64 i = 0; i < features.size(); ++i)
+        features[i] = Ref(node[2 + i]);
+      values_[inode] = Arity::Get(features);
+    }
+
+    for (uint64 inode = 1; inode <= nnodes_; ++inode) {
+      const uint64* const node = Node(inode);
+      if (node[0] == NODE_RECORD) {
+        Arity* const arity = Ref(node[2]).as<Arity>();
+        vector<Value> values(arity->size());
+        values_[inode] =
+            Record::New(store_, KAtomTuple(), arity, values.data());
+      } else if (node[0] == NODE_CLOSURE) {
+        values_[inode] = Closure::New(store_, Code(node[1]),
+                                      node[2], node[3], node[4]);
+      }
+    }
+
+    // Fixes the references up.
+    for (uint64 inode = 1; inode <= nnodes_; ++inode)
+      FixUp(inode);
+
+    return Ref(words_[2]);
+  }
+
+ private:
+  // @returns The words of the given node.
+  const uint64* Node(uint64 inode) const {
+    CHECK_GE(inode, 1UL);
+    CHECK_LE(inode, nnodes_);
+    const uint64 offset = words_[kHeaderSize + inode - 1];
+    CHECK_LT(offset, nwords_) << "Invalid snapshot node offset.";
+    return words_ + offset;
+  }
+
+  // @returns The value for a reference word.
+  Value Ref(uint64 ref) const {
+    CHECK_NE(kAtomTag, ref & kTagBitMask) << "Invalid snapshot reference.";
+    if ((ref & kTagBitMask) != kHeapValueTag) return Value(ref);
+    if (ref == 0) return Value();
+    const uint64 inode = ref >> kTagBits;
+    CHECK_LE(inode, nnodes_) << "Invalid snapshot reference.";
+    CHECK(values_[inode].IsDefined()) << "Invalid snapshot reference.";
+    return values_[inode];
+  }
+
+  // @returns The bytecode segment for a reference word.
+  const shared_ptr<PackedCode>& Code(uint64 ref) const {
+    const uint64 inode = ref >> kTagBits;
+    CHECK_LE(inode, nnodes_) << "Invalid snapshot reference.";
+    CHECK(codes_[inode] != NULL) << "Invalid snapshot reference.";
+    return codes_[inode];
+  }
+
+  static string DecodeString(const uint64* words) {
+    return string(reinterpret_cast<const char*>(words + 1), words[0]);
+  }
+
+  void FixUp(uint64 inode) {
+    const uint64* const node = Node(inode);
+    const Value value = values_[inode];
+    switch (node[0]) {
+      case NODE_LIST: {
+        List* const list = value.as<List>();
+        list->head_ = Ref(node[1]);
+        list->tail_ = Ref(node[2]);
+        break;
+      }
+      case NODE_TUPLE: {
+        Tuple* const tuple = value.as<Tuple>();
+        tuple->label_ = Ref(node[1]);
+        for (uint64 i = 0; i < tuple->size(); ++i)
+          tuple->values_[i] = Ref(node[3 + i]);
+        break;
+      }
+      case NODE_RECORD: {
+        Record* const record = value.as<Record>();
+        record->label_ = Ref(node[1]);
+        for (uint64 i = 0; i < record->size(); ++i)
+          record->values_[i] = Ref(node[3 + i]);
+        break;
+      }
+      case NODE_CELL:
+        value.as<Cell>()->Assign(Ref(node[1]));
+        break;
+      case NODE_ARRAY: {
+        Array* const array = value.as<Array>();
+        for (uint64 i = 0; i < array->size(); ++i)
+          array->Assign(i, Ref(node[2 + i]));
+        break;
+      }
+      case NODE_VARIABLE:
+        value.as<Variable>()->ref_ = Ref(node[1]);
+        break;
+      case NODE_CLOSURE: {
+        const Value environment = Ref(node[5]);
+        value.as<Closure>()->environment_ =
+            environment.IsDefined() ? environment.as<Array>() : NULL;
+        break;
+      }
+      case NODE_CODE: {
+        PackedCode* const code = codes_[inode].get();
+        const uint64* const constants = node + 3 + code->size();
+        for (uint64 i = 0; i < code->nconstants(); ++i)
+          code->mutable_constants()[i] = Ref(constants[i]);
+        break;
+      }
+      default:
+        break;  // No reference to fix up.
+    }
+  }
+
+  const uint64* const words_;
+  const uint64 nwords_;
+  uint64 nnodes_;
+  Store* const store_;
+
+  // Decoded values, indexed by node number.
+  vector<Value> values_;
+
+  // Decoded bytecode segments, indexed by node number.
+  vector<shared_ptr<PackedCode> > codes_;
+
+  DISALLOW_COPY_AND_ASSIGN(SnapshotDecoder);
+};
+
+// -----------------------------------------------------------------------------
+
+// static
+void Snapshot::Write(Value root, string* image) {
+  Encoder encoder;
+  encoder.Encode(root, CHECK_NOTNULL(image));
+}
+
+// static
+bool Snapshot::WriteToFile(Value root, const string& path) {
+  string image;
+  Write(root, &image);
+  std::ofstream out(path.c_str(), std::ios::binary);
+  if (!out) return false;
+  out.write(image.data(), image.size());
+  return out.good();
+}
+
+// static
+Value Snapshot::Read(const char* image, uint64 size, Store* store) {
+  SnapshotDecoder decoder(CHECK_NOTNULL(image), size, store);
+  return decoder.Decode();
+}
+
+// static
+Value Snapshot::ReadFromFile(const string& path, Store* store) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  PCHECK(fd >= 0) << "Cannot open snapshot " << path;
+  struct stat st;
+  PCHECK(fstat(fd, &st) == 0) << "Cannot stat snapshot " << path;
+  void* const image =
+      mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  PCHECK(image != MAP_FAILED) << "Cannot map snapshot " << path;
+  close(fd);
+  const Value root =
+      Read(static_cast<const char*>(image), st.st_size, store);
+  munmap(image, st.st_size);
+  return root;
+}
+
+}  // namespace store
@@ -0,0 +1,58 @@
+// Snapshots of value graphs.
+#ifndef STORE_SNAPSHOT_H_
+#define STORE_SNAPSHOT_H_
+
+#include <string>
+using std::string;
+
+#include "base/macros.h"
+#include "store/store.h"
+
+namespace store {
+
+// A snapshot is a relocatable image of the values reachable from a root
+// value, eg. a compiled program: closures and their bytecode, records, atoms,
+// arities, etc.
+//
+// An image is a sequence of 64 bits words: a header, a table with the offset
+// of each node in the image, then the nodes. References between values are
+// encoded as node numbers, and are fixed up when the image is read back into
+// a store. Atoms and arities are interned again when read. Bytecode segments
+// shared by several closures are shared in the image too.
+//
+// Images are not memory dumps: values hold virtual table pointers, which are
+// not stable across processes. Reading an image still saves parsing, and
+// compiling a program.
+//
+// Threads, open records and types cannot be saved. Variables must not have
+// suspensions.
+class Snapshot {
+ public:
+  // Encodes the values reachable from a root value into an image.
+  // @param root The root value of the snapshot.
+  // @param image Returns the image.
+  static void Write(Value root, string* image);
+
+  // Writes the image of the values reachable from a root value to a file.
+  // @returns True if successful, false if an error occured.
+  static bool WriteToFile(Value root, const string& path);
+
+  // Decodes an image into a store.
+  // @param image The image to decode.
+  // @param size The size of the image, in bytes.
+  // @param store The store to create the values into.
+  // @returns The root value of the snapshot.
+  static Value Read(const char* image, uint64 size, Store* store);
+
+  // Maps an image file into memory, and decodes it into a store.
+  // @returns The root value of the snapshot.
+  static Value ReadFromFile(const string& path, Store* store);
+
+ private:
+  // Not instantiable.
+  Snapshot();
+};
+
+}  // namespace store
+
+#endif  // STORE_SNAPSHOT_H_
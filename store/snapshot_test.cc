@@ -0,0 +1,109 @@
+// Tests for snapshots.
+#include "store/snapshot.h"
+
+#include <memory>
+using std::shared_ptr;
+
+#include <boost/format.hpp>
+using boost::format;
+
+#include <gtest/gtest.h>
+
+#include "combinators/oznode_eval_visitor.h"
+#include "store/bytecode.h"
+#include "store/compiler.h"
+#include "store/values.h"
+
+namespace store {
+
+const uint64 kStoreSize = 1024 * 1024;
+
+class SnapshotTest : public testing::Test {
+ protected:
+  SnapshotTest()
+      : store_(kStoreSize),
+        loaded_(kStoreSize) {
+  }
+
+  // @returns A copy of a value, through a snapshot image.
+  Value RoundTrip(Value value) {
+    string image;
+    Snapshot::Write(value, &image);
+    EXPECT_EQ(0UL, image.size() % sizeof(uint64));
+    return Snapshot::Read(image.data(), image.size(), &loaded_);
+  }
+
+  StaticStore store_;
+  StaticStore loaded_;
+};
+
+TEST_F(SnapshotTest, Values) {
+  Value record =
+      combinators::oz::ParseEval("r(a:1 b:[x y] c:f(1 g))", &store_);
+  Value values[] = {
+    record,
+    New::Float(&store_, 2.5),
+    New::Float(&store_, 1e300),
+    String::Get(&store_, "s"),
+    Integer::New(&store_, mpz_class("123456789012345678901234567890")),
+  };
+  Value value = Tuple::New(&store_, Atom::Get("t"), 5, values);
+  Value copy = RoundTrip(value);
+  EXPECT_TRUE(loaded_.Contains(copy.heap_value()));
+  EXPECT_EQ(value.ToString(), copy.ToString());
+  EXPECT_TRUE(record.RecordArity() == copy.TupleGet(0).RecordArity());
+  EXPECT_TRUE(Equals(value, copy));
+}
+
+TEST_F(SnapshotTest, Sharing) {
+  // X = f(X N N), with a shared name N.
+  Value name = Name::New(&store_);
+  Value values[] = { Variable::New(&store_), name, name };
+  Value x = Tuple::New(&store_, Atom::Get("f"), 3, values);
+  EXPECT_TRUE(Unify(x.TupleGet(0), x));
+
+  Value copy = RoundTrip(x);
+  EXPECT_TRUE(copy.TupleGet(0).Deref() == copy);
+  EXPECT_TRUE(copy.TupleGet(1) == copy.TupleGet(2));
+  EXPECT_TRUE(copy.TupleGet(1) != name);
+}
+
+TEST_F(SnapshotTest, Closure) {
+  Value code_desc = combinators::oz::ParseEval(
+      "'proc'(code: sequence(loop("
+      "    range: range(var:x 'from':1 to:5)"
+      "    body: call(native: print params: p(var(x))))))",
+      &store_);
+  Compiler compiler(&store_, NULL);
+  vector<string> env;
+  Closure* const closure = compiler.CompileProcedure(code_desc, &env);
+
+  Value copy = RoundTrip(closure);
+  ASSERT_EQ(Value::CLOSURE, copy.type());
+  EXPECT_EQ(Value(closure).ToString(), copy.ToString());
+  EXPECT_EQ(closure->code().size(), copy.as<Closure>()->code().size());
+  EXPECT_EQ(closure->nlocals(), copy.as<Closure>()->nlocals());
+}
+
+TEST_F(SnapshotTest, ClosureConstants) {
+  // Encoding the constants of the code discovers one node per atom.
+  const int kNumAtoms = 64;
+  shared_ptr<vector<Bytecode> > code(new vector<Bytecode>);
+  for (int i = 0; i < kNumAtoms; ++i)
+    code->push_back(
+        Bytecode(Bytecode::LOAD,
+                 Operand(Register(Register::LOCAL, 0)),
+                 Operand(Atom::Get((format("atom%d") % i).str()))));
+  code->push_back(Bytecode(Bytecode::RETURN));
+  Closure* const closure = Closure::New(&store_, code, 0, 1, 0);
+
+  Value copy = RoundTrip(closure);
+  ASSERT_EQ(Value::CLOSURE, copy.type());
+  const PackedCode& copy_code = copy.as<Closure>()->code();
+  ASSERT_EQ(closure->code().nconstants(), copy_code.nconstants());
+  EXPECT_EQ(uint64(kNumAtoms), copy_code.nconstants());
+  for (uint64 i = 0; i < copy_code.nconstants(); ++i)
+    EXPECT_TRUE(closure->code().constants()[i] == copy_code.constants()[i]);
+}
+
+}  // namespace store
@@ -1,11 +1,74 @@
 #include "store/store.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#include <boost/format.hpp>
+using boost::format;
+
+#include <sys/mman.h>
+
 #include <glog/logging.h>
 
 #include "store/values.h"
 
 namespace store {
 
+static_assert(kStoreAlignment == (1 << kTagBits),
+              "Store allocations must preserve the value tag bits.");
+
+uint64 NowUsec() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// -----------------------------------------------------------------------------
+
+AllocStats::AllocStats()
+    : high_water_(0),
+      start_usec_(NowUsec()) {
+  std::fill(nallocs_, nallocs_ + ArraySize(nallocs_), 0);
+  std::fill(bytes_, bytes_ + ArraySize(bytes_), 0);
+}
+
+uint64 AllocStats::total_nallocs() const {
+  uint64 total = 0;
+  for (uint64 i = 0; i < ArraySize(nallocs_); ++i)
+    total += nallocs_[i];
+  return total;
+}
+
+uint64 AllocStats::total_bytes() const {
+  uint64 total = 0;
+  for (uint64 i = 0; i < ArraySize(bytes_); ++i)
+    total += bytes_[i];
+  return total;
+}
+
+double AllocStats::bytes_per_sec() const {
+  const uint64 elapsed_usec = std::max<uint64>(NowUsec() - start_usec_, 1);
+  return total_bytes() * 1e6 / elapsed_usec;
+}
+
+string AllocStats::ToString() const {
+  string str = (format("allocated=%dB in %d values, high_water=%dB, "
+                       "rate=%.0fB/s\n")
+                % total_bytes() % total_nallocs() % high_water_
+                % bytes_per_sec()).str();
+  for (uint64 i = 0; i < ArraySize(nallocs_); ++i) {
+    if (nallocs_[i] == 0) continue;
+    const Value::ValueType type = (i == 0)
+        ? Value::INVALID
+        : static_cast<Value::ValueType>(i);
+    str += (format("  %-14s %10d values %12dB\n")
+            % ValueTypeName(type) % nallocs_[i] % bytes_[i]).str();
+  }
+  return str;
+}
+
+// -----------------------------------------------------------------------------
+
 HeapStore::HeapStore()
     : nallocs_(0),
       size_(0) {
@@ -21,19 +84,25 @@ void* HeapStore::Alloc(uint64 size) {
   return new char[size];
 }
 
-HeapStore* const kHeapStore = new HeapStore();
+// -----------------------------------------------------------------------------
+
+OutOfMemory::OutOfMemory(uint64 size, uint64 limit)
+    : message_((boost::format("Cannot allocate %d bytes: hard limit of %d bytes "
+                              "exceeded") % size % limit).str()) {
+}
 
 // -----------------------------------------------------------------------------
 
 StaticStore::StaticStore(uint64 size)
-    : size_(size),
-      free_(size),
+    : size_(size & ~(kStoreAlignment - 1)),
+      free_(size_),
       base_(new char[size]),
       next_(base_) {
   CHECK_NOTNULL(base_);
 }
 
 StaticStore::~StaticStore() {
+  delete[] base_;
 }
 
 // virtual
@@ -41,7 +110,7 @@ void* StaticStore::Alloc(uint64 size) {
   VLOG(3) << __PRETTY_FUNCTION__
           << " size=" << size
           << " free=" << free_;
-  // TODO: Ensure 8 bytes alignment
+  size = AlignSize(size);
   if (size > free_) return NULL;
   void* const new_alloc = next_;
   free_ -= size;
@@ -49,6 +118,12 @@ void* StaticStore::Alloc(uint64 size) {
   return new_alloc;
 }
 
+void StaticStore::Reset() {
+  UpdateHighWater();
+  free_ = size_;
+  next_ = base_;
+}
+
 void StaticStore::AddRoot(HeapValue* root) {
   roots_.insert(root);
 }
@@ -59,9 +134,652 @@ void StaticStore::RemoveRoot(HeapValue* root) {
 
 // static
 void StaticStore::Move(StaticStore* from, Store* to) {
-  for (auto it = from->roots_.begin(); it != from->roots_.end(); ++it) {
-    (*it)->Move(to);
+  MoveContext context(to);
+  context.AddFromSpace(from);
+  UnorderedSet<HeapValue*> moved_roots;
+  for (auto it = from->roots_.begin(); it != from->roots_.end(); ++it)
+    moved_roots.insert(context.MoveRef(*it));
+  context.MoveReferences();
+  from->roots_.swap(moved_roots);
+}
+
+// -----------------------------------------------------------------------------
+
+const uint64 SegmentedStore::kDefaultChunkSize;
+const uint64 SegmentedStore::kHugePageSize;
+
+SegmentedStore::SegmentedStore(uint64 chunk_size, bool huge_pages)
+    : chunk_size_(huge_pages
+                  ? ((chunk_size + kHugePageSize - 1) & ~(kHugePageSize - 1))
+                  : AlignSize(chunk_size)),
+      huge_pages_(huge_pages),
+      next_(NULL),
+      free_(0),
+      size_(0),
+      capacity_(0) {
+  CHECK_GT(chunk_size_, 0UL);
+}
+
+SegmentedStore::~SegmentedStore() {
+  for (auto it = chunks_.begin(); it != chunks_.end(); ++it) {
+    if (it->mapped)
+      munmap(it->base, it->size);
+    else
+      delete[] it->base;
+  }
+}
+
+// virtual
+void* SegmentedStore::Alloc(uint64 size) {
+  size = AlignSize(size);
+  if (size > free_) AddChunk(size);
+  void* const new_alloc = next_;
+  free_ -= size;
+  next_ += size;
+  size_ += size;
+  return new_alloc;
+}
+
+void SegmentedStore::AddChunk(uint64 min_size) {
+  Chunk chunk;
+  chunk.size = std::max(chunk_size_, min_size);
+  chunk.base = NULL;
+  chunk.mapped = false;
+  if (huge_pages_) {
+    chunk.size = (chunk.size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+    void* block = mmap(NULL, chunk.size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (block == MAP_FAILED) {
+      // No reserved huge pages: fall back to transparent huge pages.
+      block = mmap(NULL, chunk.size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      CHECK(block != MAP_FAILED) << "Cannot map " << chunk.size << " bytes";
+      madvise(block, chunk.size, MADV_HUGEPAGE);
+    }
+    chunk.base = static_cast<char*>(block);
+    chunk.mapped = true;
+  } else {
+    chunk.base = new char[chunk.size];
+  }
+  VLOG(2) << "New store chunk: size=" << chunk.size;
+  // The space left in the previous chunk is lost.
+  chunks_.push_back(chunk);
+  next_ = chunk.base;
+  free_ = chunk.size;
+  capacity_ += chunk.size;
+}
+
+void SegmentedStore::Reset() {
+  UpdateHighWater();
+  if (chunks_.empty()) return;
+  for (uint64 i = 1; i < chunks_.size(); ++i) {
+    const Chunk& chunk = chunks_[i];
+    if (chunk.mapped)
+      munmap(chunk.base, chunk.size);
+    else
+      delete[] chunk.base;
+  }
+  chunks_.resize(1);
+  next_ = chunks_[0].base;
+  free_ = chunks_[0].size;
+  size_ = 0;
+  capacity_ = chunks_[0].size;
+}
+
+// virtual
+bool SegmentedStore::Contains(const void* const ptr) const {
+  for (auto it = chunks_.begin(); it != chunks_.end(); ++it)
+    if ((it->base <= ptr) && (ptr < it->base + it->size)) return true;
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+
+Value RegionStore::Export(Value value, Store* store) {
+  MoveContext context(store);
+  context.AddFromSpace(this);
+  const Value moved = context.Move(value);
+  context.MoveReferences();
+  return moved;
+}
+
+// -----------------------------------------------------------------------------
+
+const uint64 PoolStore::kMaxPooledSize;
+const uint64 PoolStore::kDefaultSlabSize;
+
+PoolStore::PoolStore(uint64 slab_size)
+    : slab_size_(AlignSize(slab_size)),
+      slab_store_(16 * slab_size_),
+      size_(0),
+      nslabs_(0) {
+  CHECK_GE(slab_size_, kMaxPooledSize);
+}
+
+PoolStore::~PoolStore() {
+}
+
+// virtual
+void* PoolStore::Alloc(uint64 size) {
+  size = AlignSize(size);
+  if (size > kMaxPooledSize) return large_.Alloc(size);
+
+  SizeClass* const size_class = &classes_[size / kStoreAlignment];
+  size_ += size;
+  if (size_class->free_list != NULL) {
+    FreeBlock* const block = size_class->free_list;
+    size_class->free_list = block->next;
+    return block;
+  }
+  if (size_class->next + size > size_class->end)
+    NextSlab(size_class);
+  void* const block = size_class->next;
+  size_class->next += size;
+  return block;
+}
+
+void PoolStore::NextSlab(SizeClass* size_class) {
+  if (!size_class->slabs.empty()
+      && (size_class->slab_index + 1 < size_class->slabs.size())) {
+    size_class->slab_index++;
+  } else {
+    size_class->slabs.push_back(
+        static_cast<char*>(slab_store_.Alloc(slab_size_)));
+    size_class->slab_index = size_class->slabs.size() - 1;
+    nslabs_++;
+  }
+  size_class->next = size_class->slabs[size_class->slab_index];
+  size_class->end = size_class->next + slab_size_;
+}
+
+void PoolStore::Free(void* block, uint64 size) {
+  DCHECK(Contains(block));
+  UpdateHighWater();
+  size = AlignSize(size);
+  if (size > kMaxPooledSize) return;
+  SizeClass* const size_class = &classes_[size / kStoreAlignment];
+  FreeBlock* const free_block = static_cast<FreeBlock*>(block);
+  free_block->next = size_class->free_list;
+  size_class->free_list = free_block;
+  size_ -= size;
+}
+
+void PoolStore::Reset() {
+  UpdateHighWater();
+  for (uint64 i = 0; i < ArraySize(classes_); ++i) {
+    SizeClass* const size_class = &classes_[i];
+    size_class->free_list = NULL;
+    size_class->slab_index = 0;
+    if (size_class->slabs.empty()) continue;
+    size_class->next = size_class->slabs[0];
+    size_class->end = size_class->next + slab_size_;
+  }
+  large_.Reset();
+  size_ = 0;
+}
+
+// virtual
+bool PoolStore::Contains(const void* const ptr) const {
+  return slab_store_.Contains(ptr) || large_.Contains(ptr);
+}
+
+// -----------------------------------------------------------------------------
+
+SharedStore::SharedStore(uint64 chunk_size)
+    : Store(false),
+      store_(chunk_size) {
+}
+
+SharedStore::~SharedStore() {
+}
+
+// virtual
+void* SharedStore::Alloc(uint64 size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return store_.Alloc(size);
+}
+
+// virtual
+bool SharedStore::Contains(const void* const ptr) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return store_.Contains(ptr);
+}
+
+uint64 SharedStore::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return store_.size();
+}
+
+// -----------------------------------------------------------------------------
+
+const uint64 ThreadLocalStore::kDefaultBufferSize;
+
+ThreadLocalStore::ThreadLocalStore(Store* parent, uint64 buffer_size)
+    : parent_(CHECK_NOTNULL(parent)),
+      buffer_size_(AlignSize(buffer_size)),
+      next_(NULL),
+      free_(0),
+      size_(0),
+      nrefills_(0) {
+}
+
+ThreadLocalStore::~ThreadLocalStore() {
+}
+
+// virtual
+void* ThreadLocalStore::Alloc(uint64 size) {
+  size = AlignSize(size);
+  size_ += size;
+  if (size > free_) {
+    // Allocate large blocks in the parent directly, rather than wasting the
+    // space left in the current buffer.
+    if (size > buffer_size_ / 4) return CHECK_NOTNULL(parent_->Alloc(size));
+
+    next_ = static_cast<char*>(CHECK_NOTNULL(parent_->Alloc(buffer_size_)));
+    free_ = buffer_size_;
+    nrefills_++;
   }
+  void* const new_alloc = next_;
+  free_ -= size;
+  next_ += size;
+  return new_alloc;
+}
+
+// -----------------------------------------------------------------------------
+
+namespace {
+
+// Mixes a word into a hash code.
+inline uint64 HashCombine(uint64 hash, uint64 word) {
+  return hash ^ (word + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+inline uint64 HashValue(Value value) {
+  return std::hash<Value>()(value);
+}
+
+// @returns A new interning store identifier.
+uint32 NextInterningStoreId() {
+  static std::atomic<uint32> last_id(0);
+  const uint32 id = ++last_id;
+  CHECK_NE(0U, id) << "Too many interning stores.";
+  return id;
+}
+
+}  // anonymous namespace
+
+InterningStore::InterningStore(uint64 chunk_size)
+    : id_(NextInterningStoreId()),
+      store_(chunk_size) {
+}
+
+InterningStore::~InterningStore() {
+}
+
+Value InterningStore::Intern(Value value) {
+  Value canonical;
+  const bool interned = InternValue(value, &canonical);
+  in_progress_.clear();
+  interned_.clear();
+  return interned ? canonical : value;
+}
+
+bool InterningStore::IsCanonical(Value value) const {
+  return value.IsHeapValue() && (value.heap_value()->canonical_store() == id_);
+}
+
+// static
+bool InterningStore::AreCanonical(Value value1, Value value2) {
+  if (!value1.IsHeapValue() || !value2.IsHeapValue()) return false;
+  const uint32 id = value1.heap_value()->canonical_store();
+  return (id != 0) && (id == value2.heap_value()->canonical_store());
+}
+
+bool InterningStore::InternValue(Value value, Value* canonical) {
+  value = value.Deref();
+  if (!value.IsHeapValue() || IsCanonical(value)) {
+    *canonical = value;
+    return true;
+  }
+  auto it = interned_.find(value);
+  if (it != interned_.end()) {
+    *canonical = it->second;
+    return true;
+  }
+  // A value reached again while interning its content is part of a cycle.
+  // Free variables dereference to themselves and are caught here too.
+  if (!in_progress_.insert(value).second) return false;
+
+  bool internable = true;
+  switch (value.type()) {
+    case Value::ATOM:
+    case Value::BOOLEAN:
+    case Value::ARITY: {
+      *canonical = value;
+      break;
+    }
+    case Value::VARIABLE: {
+      internable = InternValue(value.Deref(), canonical);
+      break;
+    }
+    case Value::INTEGER: {
+      Integer* const integer = value.as<Integer>();
+      const uint64 hash =
+          HashCombine(HashCombine(Value::INTEGER, integer->limbs()[0]),
+                      integer->nlimbs());
+      *canonical = GetCanonical(
+          hash,
+          [integer](HeapValue* candidate) {
+            return candidate->IsA<Integer>()
+                && (static_cast<Integer*>(candidate)->Compare(integer) == 0);
+          },
+          [this, integer]() { return Integer::New(this, integer->mpz()); });
+      break;
+    }
+    case Value::FLOAT: {
+      const double dvalue = value.as<Float>()->value();
+      const uint64 hash =
+          HashCombine(Value::FLOAT, std::hash<double>()(dvalue));
+      *canonical = GetCanonical(
+          hash,
+          [dvalue](HeapValue* candidate) {
+            return candidate->IsA<Float>()
+                && (static_cast<Float*>(candidate)->value() == dvalue);
+          },
+          [this, dvalue]() { return Float::New(this, dvalue); });
+      break;
+    }
+    case Value::STRING: {
+      const string& svalue = value.as<String>()->value();
+      const uint64 hash =
+          HashCombine(Value::STRING, std::hash<string>()(svalue));
+      *canonical = GetCanonical(
+          hash,
+          [&svalue](HeapValue* candidate) {
+            return candidate->IsA<String>()
+                && (static_cast<String*>(candidate)->value() == svalue);
+          },
+          [this, &svalue]() { return String::Get(this, svalue); });
+      break;
+    }
+    case Value::LIST: {
+      List* const list = value.as<List>();
+      vector<Value> values(2);
+      internable = InternValue(list->head(), &values[0])
+          && InternValue(list->tail(), &values[1]);
+      if (internable)
+        *canonical = GetComposite(Value::LIST, KAtomList(), NULL, &values);
+      break;
+    }
+    case Value::TUPLE: {
+      Tuple* const tuple = value.as<Tuple>();
+      Value label;
+      vector<Value> values(tuple->size());
+      internable = InternValue(tuple->label(), &label);
+      for (uint64 i = 0; internable && (i < values.size()); ++i)
+        internable = InternValue(tuple->values()[i], &values[i]);
+      if (internable)
+        *canonical = GetComposite(Value::TUPLE, label, NULL, &values);
+      break;
+    }
+    case Value::RECORD: {
+      Record* const record = value.as<Record>();
+      Value label;
+      vector<Value> values(record->size());
+      internable = InternValue(record->label(), &label);
+      for (uint64 i = 0; internable && (i < values.size()); ++i)
+        internable = InternValue(record->values()[i], &values[i]);
+      if (internable) {
+        *canonical =
+            GetComposite(Value::RECORD, label, record->arity(), &values);
+      }
+      break;
+    }
+    default:
+      internable = false;
+  }
+
+  in_progress_.erase(value);
+  if (internable) interned_[value] = *canonical;
+  return internable;
+}
+
+template <typename Matches, typename Create>
+Value InterningStore::GetCanonical(uint64 hash,
+                                   Matches matches,
+                                   Create create) {
+  auto range = table_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it)
+    if (matches(it->second)) return it->second;
+  HeapValue* const value = create();
+  table_.insert(std::make_pair(hash, value));
+  value->canonical_store_ = id_;
+  return value;
+}
+
+Value InterningStore::GetComposite(Value::ValueType type,
+                                   Value label,
+                                   Arity* arity,
+                                   vector<Value>* values) {
+  uint64 hash = HashCombine(type, HashValue(label));
+  hash = HashCombine(hash, reinterpret_cast<uint64>(arity));
+  for (auto it = values->begin(); it != values->end(); ++it)
+    hash = HashCombine(hash, HashValue(*it));
+
+  // Components are canonical: comparing them is a pointer comparison.
+  auto matches = [type, label, arity, values](HeapValue* candidate) {
+    if (candidate->type() != type) return false;
+    const Value* candidate_values = NULL;
+    switch (type) {
+      case Value::LIST: {
+        List* const list = static_cast<List*>(candidate);
+        return (list->head() == (*values)[0])
+            && (list->tail() == (*values)[1]);
+      }
+      case Value::TUPLE: {
+        Tuple* const tuple = static_cast<Tuple*>(candidate);
+        if ((tuple->label() != label) || (tuple->size() != values->size()))
+          return false;
+        candidate_values = tuple->values();
+        break;
+      }
+      case Value::RECORD: {
+        Record* const record = static_cast<Record*>(candidate);
+        if ((record->label() != label) || (record->arity() != arity))
+          return false;
+        candidate_values = record->values();
+        break;
+      }
+      default:
+        LOG(FATAL) << "Unexpected composite type: " << type;
+    }
+    return std::equal(values->begin(), values->end(), candidate_values);
+  };
+
+  auto create = [this, type, label, arity, values]() -> HeapValue* {
+    switch (type) {
+      case Value::LIST:
+        return List::New(this, (*values)[0], (*values)[1]);
+      case Value::TUPLE:
+        return Tuple::New(this, label, values->size(), values->data());
+      case Value::RECORD:
+        return Record::New(this, label, arity, values->data());
+      default:
+        LOG(FATAL) << "Unexpected composite type: " << type;
+    }
+  };
+
+  return GetCanonical(hash, matches, create);
+}
+
+
+// -----------------------------------------------------------------------------
+
+GenerationalStore::GenerationalStore(uint64 nursery_size, uint64 old_size)
+    : nursery_(nursery_size),
+      old_(new PoolStore()),
+      spare_(new PoolStore()),
+      min_old_budget_(old_size),
+      old_budget_(old_size),
+      overflow_(false),
+      soft_trigger_(0),
+      over_quota_(false),
+      nsoft_collections_(0),
+      nrefused_(0) {
+}
+
+GenerationalStore::~GenerationalStore() {
+  for (auto it = finalizable_.begin(); it != finalizable_.end(); ++it)
+    (*it)->~HeapValue();
+  delete old_;
+  delete spare_;
+}
+
+// virtual
+void* GenerationalStore::Alloc(uint64 size) {
+  if ((quota_.hard_limit > 0) && (used() + size > quota_.hard_limit)) {
+    over_quota_ = true;
+    nrefused_++;
+    throw OutOfMemory(size, quota_.hard_limit);
+  }
+
+  void* const block = nursery_.Alloc(size);
+  if (block != NULL) return block;
+
+  // The nursery is full: allocate in the old generation until the next
+  // collection. These values may reference values in the nursery.
+  overflow_ = true;
+  void* const old_block = old_->Alloc(size);
+  old_values_.push_back(static_cast<HeapValue*>(old_block));
+  return old_block;
+}
+
+// virtual
+bool GenerationalStore::Contains(const void* const ptr) const {
+  return nursery_.Contains(ptr) || old_->Contains(ptr);
+}
+
+bool GenerationalStore::NeedsCollection() const {
+  return overflow_
+      || over_quota_
+      || (nursery_.free() < nursery_.size() / 4)
+      || ((quota_.soft_limit > 0) && (used() > soft_trigger_));
+}
+
+void GenerationalStore::Collect(RootSet* roots) {
+  const bool over_soft_limit =
+      (quota_.soft_limit > 0) && (used() > soft_trigger_);
+  if (over_soft_limit) nsoft_collections_++;
+
+  // Values left half-built by a refused allocation may be registered as old
+  // values: a major collection does not scan them.
+  if (over_soft_limit || over_quota_ || (used() > old_budget_))
+    CollectMajor(roots);
+  else
+    CollectMinor(roots);
+
+  over_quota_ = false;
+  soft_trigger_ = std::max(quota_.soft_limit, used() + nursery_.size() / 2);
+}
+
+void GenerationalStore::set_quota(const StoreQuota& quota) {
+  CHECK((quota.soft_limit == 0) || (quota.hard_limit == 0)
+        || (quota.soft_limit <= quota.hard_limit))
+      << "Soft limit " << quota.soft_limit
+      << " exceeds hard limit " << quota.hard_limit;
+  quota_ = quota;
+  soft_trigger_ = quota.soft_limit;
+}
+
+QuotaUsage GenerationalStore::quota_usage() const {
+  QuotaUsage usage;
+  usage.quota = quota_;
+  usage.used = used();
+  usage.nsoft_collections = nsoft_collections_;
+  usage.nrefused = nrefused_;
+  return usage;
+}
+
+void GenerationalStore::CollectMinor(RootSet* roots) {
+  CHECK_NOTNULL(roots);
+  const uint64 start_usec = NowUsec();
+  const uint64 old_used_before = old_used();
+  UpdateHighWater();
+
+  // Values are moved straight into the old generation: promotions are not
+  // accounted as allocations of this store.
+  MoveContext context(old_);
+  context.AddFromSpace(&nursery_);
+  roots->MoveRoots(&context);
+  // The old generation acts as the remembered set.
+  for (auto it = old_values_.begin(); it != old_values_.end(); ++it)
+    (*it)->MoveReferences(&context);
+  context.MoveReferences();
+
+  old_values_.insert(old_values_.end(),
+                     context.moved().begin(), context.moved().end());
+  FinalizeDead(false);
+  nursery_.Reset();
+  overflow_ = false;
+
+  stats_.nminor++;
+  stats_.promoted_bytes += old_used() - old_used_before;
+  RecordPause(start_usec, "minor");
+}
+
+void GenerationalStore::CollectMajor(RootSet* roots) {
+  CHECK_NOTNULL(roots);
+  const uint64 start_usec = NowUsec();
+  UpdateHighWater();
+
+  PoolStore* const from = old_;
+  old_ = spare_;
+
+  MoveContext context(old_);
+  context.AddFromSpace(&nursery_);
+  context.AddFromSpace(from);
+  roots->MoveRoots(&context);
+  context.MoveReferences();
+
+  old_values_ = context.moved();
+  FinalizeDead(true);
+  from->Reset();
+  spare_ = from;
+  nursery_.Reset();
+  overflow_ = false;
+  // Leave room for the old generation to grow as much as it is live.
+  old_budget_ = std::max(min_old_budget_, 2 * old_used());
+
+  stats_.nmajor++;
+  RecordPause(start_usec, "major");
+}
+
+void GenerationalStore::FinalizeDead(bool major) {
+  uint64 nlive = 0;
+  for (auto it = finalizable_.begin(); it != finalizable_.end(); ++it) {
+    HeapValue* const value = *it;
+    if (!major && !nursery_.Contains(value)) {
+      // Old values are not collected by minor collections.
+      finalizable_[nlive++] = value;
+    } else if (value->type() == Value::MOVED_VALUE) {
+      // Destroyed when moved: the new location owns the memory now.
+      HeapValue* const moved = static_cast<MovedValue*>(value)->new_location();
+      if (Contains(moved)) finalizable_[nlive++] = moved;
+    } else {
+      value->~HeapValue();
+    }
+  }
+  finalizable_.resize(nlive);
+}
+
+void GenerationalStore::RecordPause(uint64 start_usec, const char* kind) {
+  const uint64 pause_usec = NowUsec() - start_usec;
+  stats_.last_pause_usec = pause_usec;
+  stats_.max_pause_usec = std::max(stats_.max_pause_usec, pause_usec);
+  stats_.total_pause_usec += pause_usec;
+  VLOG(1) << "Collection (" << kind << "): pause=" << pause_usec << "us"
+          << " old_used=" << old_used()
+          << " old_values=" << old_values_.size();
 }
 
 }  // namespace store
@@ -5,14 +5,30 @@
 #ifndef STORE_STORE_H_
 #define STORE_STORE_H_
 
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
+using std::string;
+using std::vector;
 
 #include "base/macros.h"
 #include "base/stl-util.h"
+#include "store/value.h"
 
 namespace store {
 
 class HeapValue;
+class MoveContext;
+
+// Alignment of the memory blocks allocated in stores, in bytes.
+// Values are tagged on their low bits (see kTagBits in value.h).
+const uint64 kStoreAlignment = 8;
+
+// @returns The given size rounded up to the store alignment.
+inline uint64 AlignSize(uint64 size) {
+  return (size + kStoreAlignment - 1) & ~(kStoreAlignment - 1);
+}
 
 // Computes the size of object T with a nested array A[size];
 template <typename T, typename A>
@@ -20,22 +36,113 @@ uint64 SizeOfWithNestedArray(uint64 size) {
   return sizeof(T) + size * sizeof(A);
 }
 
+// @returns A monotonic time, in micro-seconds.
+uint64 NowUsec();
+
+// Raised when an allocation would exceed the hard limit of a store quota.
+class OutOfMemory : public std::exception {
+ public:
+  // @param size The size of the refused allocation, in bytes.
+  // @param limit The hard limit of the store, in bytes.
+  OutOfMemory(uint64 size, uint64 limit);
+  virtual ~OutOfMemory() noexcept {}
+  virtual const char* what() const noexcept {
+    return message_.c_str();
+  }
+
+ private:
+  const string message_;
+};
+
+// -----------------------------------------------------------------------------
+
+// Allocation statistics of a store, per value type.
+class AllocStats {
+ public:
+  AllocStats();
+
+  // Records the allocation of a value.
+  // @param type The type of the value, INVALID for untyped memory blocks.
+  // @param size The size of the value, in bytes.
+  void Record(Value::ValueType type, uint64 size) {
+    const int index = (type > 0) ? type : 0;
+    nallocs_[index]++;
+    bytes_[index] += size;
+  }
+
+  // Updates the high-water mark with the number of bytes currently in use.
+  void UpdateHighWater(uint64 used) {
+    if (used > high_water_) high_water_ = used;
+  }
+
+  // @returns The number of values of the given type allocated so far.
+  uint64 nallocs(Value::ValueType type) const {
+    return nallocs_[(type > 0) ? type : 0];
+  }
+
+  // @returns The bytes allocated so far for values of the given type.
+  uint64 bytes(Value::ValueType type) const {
+    return bytes_[(type > 0) ? type : 0];
+  }
+
+  // @returns The number of values allocated so far, of any type.
+  uint64 total_nallocs() const;
+
+  // @returns The bytes allocated so far, for values of any type.
+  uint64 total_bytes() const;
+
+  // @returns The largest number of bytes in use seen so far.
+  uint64 high_water() const { return high_water_; }
+
+  // @returns The bytes allocated per second, since the creation of the store.
+  double bytes_per_sec() const;
+
+  // @returns A dump of the statistics, with one line per allocated type.
+  string ToString() const;
+
+ private:
+  // Indexed by value type. Untyped memory blocks are accounted in slot 0.
+  uint64 nallocs_[Value::VALUE_TYPE_COUNT];
+  uint64 bytes_[Value::VALUE_TYPE_COUNT];
+
+  uint64 high_water_;
+
+  // Creation time of the store, in micro-seconds.
+  const uint64 start_usec_;
+};
+
 // -----------------------------------------------------------------------------
 
 // Abstract base class for value stores.
 class Store {
  public:
-  Store() {}
+  // @param record_stats Whether to maintain allocation statistics.
+  //     Stores shared by several OS threads must not record statistics.
+  explicit Store(bool record_stats = true) : record_stats_(record_stats) {}
   virtual ~Store() {}
 
   // Allocates a new block of memory in the store.
+  // Untyped blocks are not accounted in the allocation statistics.
   // @returns Pointer to the allocated memory block,
   //     NULL if not enough space left.
   virtual void* Alloc(uint64 size) = 0;
 
+  // Allocates a block of memory for a value of the given type, and records
+  // it in the allocation statistics.
+  // @param type The type of the value to allocate.
+  // @param size The size of the value, in bytes.
+  // @returns Pointer to the allocated memory block,
+  //     NULL if not enough space left.
+  void* AllocValue(Value::ValueType type, uint64 size) {
+    void* const block = Alloc(size);
+    if (record_stats_ && (block != NULL))
+      alloc_stats_.Record(type, AlignSize(size));
+    return block;
+  }
+
   // Allocates a block of memory for the given object.
   template <typename T>
-  T* Alloc() { return static_cast<T*>(Alloc(sizeof(T))); }
+  T* Alloc() { return static_cast<T*>(AllocValue(T::kType, sizeof(T))); }
 
   // Allocates a block of memory for an array T[size];
   template <typename T>
@@ -46,10 +153,41 @@ class Store {
   // Allocates a memory block for an object T, with a nested array A[size].
   template <typename T, typename A>
   T* AllocWithNestedArray(uint64 size) {
-    return static_cast<T*>(Alloc(SizeOfWithNestedArray<T, A>(size)));
+    return static_cast<T*>(
+        AllocValue(T::kType, SizeOfWithNestedArray<T, A>(size)));
+  }
+
+  // Registers a value that owns memory outside of the store, once it is
+  // constructed: its destructor must run when the value is discarded.
+  // Stores that discard dead values override this. Values moved out of a
+  // store are destroyed by HeapValue::Move() already.
+  // @param value The value to register, allocated in this store.
+  virtual void AddFinalizable(HeapValue* value) {}
+
+  // @returns Whether the pointer belongs to this store or not.
+  //     Stores unable to tell report false, their values are never moved.
+  // @param ptr The pointer to test.
+  virtual bool Contains(const void* const ptr) const { return false; }
+
+  // @returns The number of bytes currently in use in this store.
+  virtual uint64 used() const = 0;
+
+  // @returns The allocation statistics of this store.
+  //     The high-water mark is brought up to date.
+  const AllocStats& alloc_stats() {
+    alloc_stats_.UpdateHighWater(used());
+    return alloc_stats_;
   }
 
+ protected:
+  // Stores that release memory must call this before doing so.
+  void UpdateHighWater() { alloc_stats_.UpdateHighWater(used()); }
+
  private:
+  const bool record_stats_;
+
+  AllocStats alloc_stats_;
+
   DISALLOW_COPY_AND_ASSIGN(Store);
 };
 
@@ -64,6 +202,8 @@ class HeapStore : public Store {
 
   virtual void* Alloc(uint64 size);
 
+  virtual uint64 used() const { return size_; }
+
  private:
   // Number of allocs.
   uint64 nallocs_;
@@ -74,8 +214,6 @@ class HeapStore : public Store {
   DISALLOW_COPY_AND_ASSIGN(HeapStore);
 };
 
-extern HeapStore* const kHeapStore;
-
 // -----------------------------------------------------------------------------
 
 // A fixed size store.
@@ -93,17 +231,24 @@ class StaticStore : public Store {
   // @returns The space left, in bytes.
   uint64 free() const { return free_; }
 
+  virtual uint64 used() const { return size_ - free_; }
+
   // @returns Whether the pointer belongs to this store or not.
   // @param ptr The pointer to test.
-  bool Contains(const void* const ptr) const {
+  virtual bool Contains(const void* const ptr) const {
     return (base_ <= ptr) && (ptr < base_ + size_);
   }
 
+  // Releases all the values from this store at once.
+  // Values are not finalized: the store must not contain live values.
+  void Reset();
+
   // Manages the store roots.
   void AddRoot(HeapValue* root);
   void RemoveRoot(HeapValue* root);
 
   // Moves the reachable content of store from into store to.
+  // The roots of store from are updated to their new locations.
   // @param from Store to copy from.
   // @param to Store to copy into.
   static void Move(StaticStore* from, Store* to);
@@ -127,6 +272,586 @@ class StaticStore : public Store {
   DISALLOW_COPY_AND_ASSIGN(StaticStore);
 };
 
+// -----------------------------------------------------------------------------
+
+// A growable store, allocating from a chain of large chunks.
+// Allocations are aligned on kStoreAlignment and never return NULL: a new
+// chunk is allocated when the current one is exhausted.
+class SegmentedStore : public Store {
+ public:
+  // Default size of the chunks, in bytes.
+  static const uint64 kDefaultChunkSize = 1024 * 1024;
+
+  // Size of huge pages, in bytes.
+  static const uint64 kHugePageSize = 2 * 1024 * 1024;
+
+  // @param chunk_size Size of the chunks, in bytes.
+  //     Allocations larger than this get a dedicated chunk.
+  // @param huge_pages Whether to back chunks with huge pages, when available.
+  //     The chunk size is then rounded up to a multiple of kHugePageSize.
+  explicit SegmentedStore(uint64 chunk_size = kDefaultChunkSize,
+                          bool huge_pages = false);
+  virtual ~SegmentedStore();
+
+  virtual void* Alloc(uint64 size);
+
+  virtual bool Contains(const void* const ptr) const;
+
+  // Releases all the values from this store at once, and all the chunks
+  // but the first one.
+  // Values are not finalized: the store must not contain live values.
+  void Reset();
+
+  // @returns The number of bytes allocated in this store.
+  uint64 size() const { return size_; }
+
+  virtual uint64 used() const { return size_; }
+
+  // @returns The number of bytes reserved by the chunks of this store.
+  uint64 capacity() const { return capacity_; }
+
+  // @returns The number of chunks.
+  uint64 nchunks() const { return chunks_.size(); }
+
+ private:  // ------------------------------------------------------------------
+  struct Chunk {
+    // Bottom of the chunk memory area.
+    char* base;
+
+    // Size of the chunk, in bytes.
+    uint64 size;
+
+    // Whether the chunk is mapped rather than allocated in the heap.
+    bool mapped;
+  };
+
+  // Appends a new chunk that can hold at least the given number of bytes.
+  void AddChunk(uint64 min_size);
+
+  // Default size of the chunks, in bytes.
+  const uint64 chunk_size_;
+
+  const bool huge_pages_;
+
+  vector<Chunk> chunks_;
+
+  // Position of the next area to allocate, in the last chunk.
+  char* next_;
+
+  // Space left in the last chunk, in bytes.
+  uint64 free_;
+
+  // Bytes allocated, and bytes reserved.
+  uint64 size_;
+  uint64 capacity_;
+
+  DISALLOW_COPY_AND_ASSIGN(SegmentedStore);
+};
+
+// -----------------------------------------------------------------------------
+
+// A store for short-lived temporaries, eg. the code descriptions built by the
+// parser and walked by the compiler.
+// Values are released in bulk when the region is reset, usually by a
+// ScopedRegion. Values meant to outlive the region are moved out of it first,
+// with Export(). As with SegmentedStore::Reset(), values are not finalized.
+class RegionStore : public SegmentedStore {
+ public:
+  // @param chunk_size Size of the chunks, in bytes.
+  explicit RegionStore(uint64 chunk_size = kDefaultChunkSize)
+      : SegmentedStore(chunk_size) {
+  }
+
+  // Moves the values reachable from a value out of this region.
+  // References to values living outside of this region are preserved.
+  // @param value The value to move.
+  // @param store The store to move the values into.
+  // @returns The new location of the value.
+  Value Export(Value value, Store* store);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RegionStore);
+};
+
+// Resets a region store when going out of scope:
+//
+//   {
+//     ScopedRegion scope(&region);
+//     Value desc = ParseEval(code, &region);
+//     ...
+//     closure = region.Export(closure, store).as<Closure>();
+//   }  // The temporaries are released here.
+class ScopedRegion {
+ public:
+  explicit ScopedRegion(RegionStore* region)
+      : region_(CHECK_NOTNULL(region)) {
+  }
+
+  ~ScopedRegion() { region_->Reset(); }
+
+ private:
+  RegionStore* const region_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedRegion);
+};
+
+// -----------------------------------------------------------------------------
+
+// A store pooling the memory blocks of small values by size class.
+//
+// Each size class carves its blocks out of its own contiguous slabs: values of
+// the same type end up next to each other (e.g. the cells of a list).
+// Released blocks are kept in per size class free lists, and reused first.
+// Blocks larger than kMaxPooledSize are allocated in a SegmentedStore.
+class PoolStore : public Store {
+ public:
+  // Largest pooled block size, in bytes.
+  static const uint64 kMaxPooledSize = 256;
+
+  // Default size of the slabs, in bytes.
+  static const uint64 kDefaultSlabSize = 64 * 1024;
+
+  // @param slab_size Size of the slabs, in bytes.
+  explicit PoolStore(uint64 slab_size = kDefaultSlabSize);
+  virtual ~PoolStore();
+
+  virtual void* Alloc(uint64 size);
+
+  virtual bool Contains(const void* const ptr) const;
+
+  // Releases a memory block into the free list of its size class.
+  // Blocks larger than kMaxPooledSize are only reclaimed by Reset().
+  // @param block The memory block to release. Must belong to this store.
+  // @param size The size the block was allocated with.
+  void Free(void* block, uint64 size);
+
+  // Releases all the values from this store at once.
+  // Slabs are kept and reused by subsequent allocations.
+  // Values are not finalized: the store must not contain live values.
+  void Reset();
+
+  // @returns The number of bytes in use in this store.
+  uint64 size() const { return size_ + large_.size(); }
+
+  virtual uint64 used() const { return size(); }
+
+  // @returns The number of slabs allocated so far.
+  uint64 nslabs() const { return nslabs_; }
+
+ private:  // ------------------------------------------------------------------
+  // Links the released blocks of a size class.
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct SizeClass {
+    SizeClass() : next(NULL), end(NULL), slab_index(0), free_list(NULL) {}
+
+    // Position of the next block to carve out of the current slab.
+    char* next;
+
+    // End of the current slab.
+    char* end;
+
+    // The slabs of this size class, in allocation order.
+    vector<char*> slabs;
+
+    // Index of the current slab in slabs.
+    uint64 slab_index;
+
+    // Released blocks.
+    FreeBlock* free_list;
+  };
+
+  // Moves a size class to its next slab, reusing slabs released by Reset().
+  void NextSlab(SizeClass* size_class);
+
+  // Size of the slabs, in bytes.
+  const uint64 slab_size_;
+
+  // Size classes, indexed by block size / kStoreAlignment.
+  SizeClass classes_[kMaxPooledSize / kStoreAlignment + 1];
+
+  // Slabs are carved out of this store.
+  SegmentedStore slab_store_;
+
+  // Store for the blocks larger than kMaxPooledSize.
+  SegmentedStore large_;
+
+  // Number of bytes in use in pooled blocks.
+  uint64 size_;
+
+  uint64 nslabs_;
+
+  DISALLOW_COPY_AND_ASSIGN(PoolStore);
+};
+
+// -----------------------------------------------------------------------------
+
+// A store that may be shared by several OS threads.
+// Allocations are serialized in an underlying SegmentedStore.
+// Meant to be the parent of ThreadLocalStores.
+// No allocation statistics are recorded: they are recorded per thread by the
+// ThreadLocalStores.
+class SharedStore : public Store {
+ public:
+  // @param chunk_size Size of the underlying chunks, in bytes.
+  explicit SharedStore(
+      uint64 chunk_size = SegmentedStore::kDefaultChunkSize);
+  virtual ~SharedStore();
+
+  // Thread-safe.
+  virtual void* Alloc(uint64 size);
+
+  // Thread-safe.
+  virtual bool Contains(const void* const ptr) const;
+
+  // @returns The number of bytes allocated in this store.
+  uint64 size() const;
+
+  virtual uint64 used() const { return size(); }
+
+ private:  // ------------------------------------------------------------------
+  mutable std::mutex mutex_;
+
+  SegmentedStore store_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedStore);
+};
+
+// A thread-local allocation buffer (TLAB).
+//
+// A store private to one OS thread, that bump-allocates without atomics in
+// buffers carved out of a shared parent store. The parent is only involved,
+// and locked, when a buffer is exhausted.
+// The values belong to the parent store.
+class ThreadLocalStore : public Store {
+ public:
+  // Default size of the buffers, in bytes.
+  static const uint64 kDefaultBufferSize = 32 * 1024;
+
+  // @param parent The store to carve the buffers out of. Must be thread-safe.
+  // @param buffer_size Size of the buffers, in bytes.
+  explicit ThreadLocalStore(Store* parent,
+                            uint64 buffer_size = kDefaultBufferSize);
+  virtual ~ThreadLocalStore();
+
+  virtual void* Alloc(uint64 size);
+
+  virtual bool Contains(const void* const ptr) const {
+    return parent_->Contains(ptr);
+  }
+
+  // @returns The number of bytes allocated through this store.
+  virtual uint64 used() const { return size_; }
+
+  // @returns How many buffers have been carved out of the parent store.
+  uint64 nrefills() const { return nrefills_; }
+
+ private:  // ------------------------------------------------------------------
+  Store* const parent_;
+
+  // Size of the buffers, in bytes.
+  const uint64 buffer_size_;
+
+  // Position of the next area to allocate, in the current buffer.
+  char* next_;
+
+  // Space left in the current buffer, in bytes.
+  uint64 free_;
+
+  // Bytes allocated through this store.
+  uint64 size_;
+
+  uint64 nrefills_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadLocalStore);
+};
+
+// -----------------------------------------------------------------------------
+
+// A store that hash-conses immutable values.
+//
+// Intern() returns a canonical copy of a value, allocated in this store:
+// structurally equal values interned in the same store share a single copy.
+// Copies are built bottom-up, the components of a canonical value are
+// canonical themselves.
+//
+// Lists, tuples, records, integers, floats and strings can be interned, as
+// long as their content can be interned too. Atoms, booleans, arities and
+// small integers are unique already. Values with free variables, stateful
+// values, names and cyclic values are not interned.
+//
+// Canonical values are never collected. Testing the equality of two
+// canonical values of the same store is a pointer comparison.
+class InterningStore : public Store {
+ public:
+  // @param chunk_size Size of the chunks canonical values are allocated in.
+  explicit InterningStore(
+      uint64 chunk_size = SegmentedStore::kDefaultChunkSize);
+  virtual ~InterningStore();
+
+  virtual void* Alloc(uint64 size) { return store_.Alloc(size); }
+
+  virtual bool Contains(const void* const ptr) const {
+    return store_.Contains(ptr);
+  }
+
+  virtual uint64 used() const { return store_.size(); }
+
+  // @param value The value to intern.
+  // @returns The canonical copy of the given value,
+  //     or the value itself if it cannot be interned.
+  Value Intern(Value value);
+
+  // @returns Whether the given value is a canonical value of this store.
+  bool IsCanonical(Value value) const;
+
+  // @returns The number of canonical values in this store.
+  uint64 size() const { return table_.size(); }
+
+  // @returns Whether the given values are canonical values of the same store:
+  //     they are then equal if and only if they are the same value.
+  //     Only reads the headers of the values.
+  static bool AreCanonical(Value value1, Value value2);
+
+ private:  // ------------------------------------------------------------------
+  // Interns a value and its content.
+  // @param value The value to intern.
+  // @param canonical Returns the canonical copy of the value.
+  // @returns False if the value cannot be interned.
+  bool InternValue(Value value, Value* canonical);
+
+  // @returns The canonical value with the given hash code and matching the
+  //     given predicate, created with the given factory if there is none.
+  template <typename Matches, typename Create>
+  Value GetCanonical(uint64 hash, Matches matches, Create create);
+
+  // @returns The canonical list, tuple or record with the given content.
+  //     The content must be made of canonical values.
+  Value GetComposite(Value::ValueType type,
+                     Value label,
+                     Arity* arity,
+                     vector<Value>* values);
+
+  // Identifier recorded in the header of the canonical values of this store.
+  // Unique among the interning stores of the process, never 0.
+  const uint32 id_;
+
+  // The canonical values are allocated in this store.
+  SegmentedStore store_;
+
+  // Canonical values, indexed by structural hash codes.
+  std::unordered_multimap<uint64, HeapValue*> table_;
+
+  // Values being interned by the current Intern() call, to detect cycles.
+  UnorderedSet<Value> in_progress_;
+
+  // Values interned by the current Intern() call, with their canonical copy.
+  UnorderedMap<Value, Value> interned_;
+
+  DISALLOW_COPY_AND_ASSIGN(InterningStore);
+};
+
+// -----------------------------------------------------------------------------
+
+// Enumerates the roots of a live value graph, for collections.
+class RootSet {
+ public:
+  virtual ~RootSet() {}
+
+  // Moves the roots through the given context, and updates the references to
+  // the roots with their new locations.
+  virtual void MoveRoots(MoveContext* context) = 0;
+
+  // Lists the roots, eg. for heap profiles.
+  // @param roots Appends the roots to this vector.
+  virtual void GetRoots(vector<Value>* roots) = 0;
+};
+
+// Statistics about the collections run by a GenerationalStore.
+struct CollectionStats {
+  CollectionStats()
+      : nminor(0),
+        nmajor(0),
+        promoted_bytes(0),
+        last_pause_usec(0),
+        max_pause_usec(0),
+        total_pause_usec(0) {
+  }
+
+  // Number of minor collections.
+  uint64 nminor;
+
+  // Number of major collections.
+  uint64 nmajor;
+
+  // Bytes moved out of the nursery by minor collections, overall.
+  uint64 promoted_bytes;
+
+  // Collection pauses, in micro-seconds.
+  uint64 last_pause_usec;
+  uint64 max_pause_usec;
+  uint64 total_pause_usec;
+};
+
+// Memory limits of a store, in bytes. A limit of 0 means no limit.
+struct StoreQuota {
+  StoreQuota()
+      : soft_limit(0),
+        hard_limit(0) {
+  }
+
+  // Past this limit, the next safe point runs a major collection.
+  uint64 soft_limit;
+
+  // Allocations that would exceed this limit raise OutOfMemory.
+  uint64 hard_limit;
+};
+
+// Memory usage of a store against its quota.
+struct QuotaUsage {
+  StoreQuota quota;
+
+  // Bytes currently in use.
+  uint64 used;
+
+  // Number of collections forced by the soft limit.
+  uint64 nsoft_collections;
+
+  // Number of allocations refused by the hard limit.
+  uint64 nrefused;
+};
+
+// A garbage collected store, with two generations.
+//
+// Values are allocated in a fixed size nursery. Minor collections move the
+// live values out of the nursery into the old generation, then reset the
+// nursery. Major collections move all the live values into a new old
+// generation. Both are Stop&Copy collections driven by a MoveContext.
+//
+// The old generation is a PoolStore: promoted values are grouped by size
+// class. Two pools are flipped by major collections, the evacuated pool is
+// reset and its slabs are reused by the next major collection.
+//
+// There is no write barrier yet: minor collections scan all the values of the
+// old generation for references into the nursery.
+//
+// Collections may only run at safe points, where all the live values are
+// reachable from the root set (see Engine::Run()).
+// All the memory blocks allocated in this store must hold a HeapValue.
+//
+// An optional quota bounds the memory used by the store: crossing the soft
+// limit makes the next collection a major one, allocations crossing the hard
+// limit raise OutOfMemory, and force a major collection at the next safe
+// point. Values being constructed when the hard limit is hit are dropped.
+class GenerationalStore : public Store {
+ public:
+  // @param nursery_size Size of the nursery, in bytes.
+  // @param old_size Size the old generation may reach before the first major
+  //     collection, in bytes.
+  GenerationalStore(uint64 nursery_size, uint64 old_size);
+  virtual ~GenerationalStore();
+
+  // Allocates in the nursery, or in the old generation once the nursery is
+  // full. Never returns NULL.
+  virtual void* Alloc(uint64 size);
+
+  virtual bool Contains(const void* const ptr) const;
+
+  virtual void AddFinalizable(HeapValue* value) {
+    finalizable_.push_back(value);
+  }
+
+  // @returns The number of values owning memory outside of the store.
+  uint64 nfinalizable() const { return finalizable_.size(); }
+
+  // @returns Whether a collection should run at the next safe point.
+  bool NeedsCollection() const;
+
+  // Runs a minor collection, or a major collection when the old generation
+  // exceeds its budget.
+  // @param roots The roots of the live value graph.
+  void Collect(RootSet* roots);
+
+  // Moves the live values out of the nursery.
+  // @param roots The roots of the live value graph.
+  void CollectMinor(RootSet* roots);
+
+  // Moves all the live values into a new old generation.
+  // @param roots The roots of the live value graph.
+  void CollectMajor(RootSet* roots);
+
+  // @returns The collection statistics.
+  const CollectionStats& stats() const { return stats_; }
+
+  // Sets the memory quota of this store.
+  void set_quota(const StoreQuota& quota);
+
+  // @returns The memory usage of this store against its quota.
+  QuotaUsage quota_usage() const;
+
+  // @returns The size of the nursery, in bytes.
+  uint64 nursery_size() const { return nursery_.size(); }
+
+  // @returns The bytes allocated in the nursery.
+  uint64 nursery_used() const { return nursery_.size() - nursery_.free(); }
+
+  // @returns The bytes allocated in the old generation.
+  uint64 old_used() const { return old_->size(); }
+
+  virtual uint64 used() const { return nursery_used() + old_used(); }
+
+ private:  // ------------------------------------------------------------------
+  // Records the pause of a collection started at the given time.
+  void RecordPause(uint64 start_usec, const char* kind);
+
+  // Destroys the finalizable values a collection left behind, and updates
+  // the moved ones to their new location. Runs before the collected spaces
+  // are reset.
+  // @param major Whether the whole store was collected, or only the nursery.
+  void FinalizeDead(bool major);
+
+  // The young generation.
+  StaticStore nursery_;
+
+  // The old generation, flipped with spare_ by major collections.
+  PoolStore* old_;
+  PoolStore* spare_;
+
+  // Minimum size the old generation may reach before a major collection.
+  const uint64 min_old_budget_;
+
+  // Bytes the old generation may hold before a major collection is due.
+  uint64 old_budget_;
+
+  // Values in the old generation, scanned by minor collections.
+  vector<HeapValue*> old_values_;
+
+  // Values owning memory outside of the store, see AddFinalizable().
+  vector<HeapValue*> finalizable_;
+
+  // True when the nursery overflowed since the last collection.
+  bool overflow_;
+
+  CollectionStats stats_;
+
+  StoreQuota quota_;
+
+  // Bytes the store may hold before a collection is forced by the soft limit.
+  // Past a soft limit collection, the store must grow by half a nursery before
+  // the next one: the live values may exceed the soft limit.
+  uint64 soft_trigger_;
+
+  // True when an allocation was refused since the last collection.
+  bool over_quota_;
+
+  uint64 nsoft_collections_;
+  uint64 nrefused_;
+
+  DISALLOW_COPY_AND_ASSIGN(GenerationalStore);
+};
+
 }  // namespace store
 
 #endif  // STORE_STORE_H_
@@ -0,0 +1,447 @@
+// Tests for the stores.
+#include "store/values.h"
+
+#include <memory>
+#include <vector>
+using std::shared_ptr;
+using std::vector;
+
+#include <gtest/gtest.h>
+
+#include "store/bytecode.h"
+
+namespace store {
+
+const uint64 kNurserySize = 4 * 1024;
+const uint64 kOldSize = 64 * 1024;
+
+TEST(StaticStoreTest, Alignment) {
+  StaticStore store(1024);
+  char* const block1 = static_cast<char*>(store.Alloc(3));
+  char* const block2 = static_cast<char*>(store.Alloc(8));
+  EXPECT_EQ(block1 + 8, block2);
+  EXPECT_EQ(1024UL - 16, store.free());
+}
+
+TEST(StaticStoreTest, AllocStats) {
+  StaticStore store(1024);
+  for (int i = 0; i < 3; ++i)
+    List::New(&store, KAtomNil(), KAtomNil());
+  Variable::New(&store);
+  Tuple::New(&store, Atom::Get("f"), 2);  // With 2 fresh variables.
+  store.Alloc(16);  // Untyped blocks are not accounted.
+
+  const AllocStats& stats = store.alloc_stats();
+  EXPECT_EQ(3UL, stats.nallocs(Value::LIST));
+  EXPECT_EQ(3 * AlignSize(sizeof(List)), stats.bytes(Value::LIST));
+  EXPECT_EQ(3UL, stats.nallocs(Value::VARIABLE));
+  EXPECT_EQ(AlignSize(SizeOfWithNestedArray<Tuple, Value>(2)),
+            stats.bytes(Value::TUPLE));
+  EXPECT_EQ(0UL, stats.nallocs(Value::INVALID));
+  EXPECT_EQ(7UL, stats.total_nallocs());
+  EXPECT_EQ(store.used(), stats.total_bytes() + 16);
+
+  const uint64 used = store.used();
+  store.Reset();
+  EXPECT_EQ(used, store.alloc_stats().high_water());
+  EXPECT_NE(string::npos, stats.ToString().find("list"));
+}
+
+TEST(SegmentedStoreTest, Grows) {
+  SegmentedStore store(1024);
+  vector<void*> blocks;
+  for (int i = 0; i < 100; ++i) {
+    void* const block = store.Alloc(17);
+    ASSERT_TRUE(block != NULL);
+    EXPECT_EQ(0UL, reinterpret_cast<uint64>(block) % kStoreAlignment);
+    blocks.push_back(block);
+  }
+  EXPECT_EQ(100UL * 24, store.size());
+  EXPECT_EQ(3UL, store.nchunks());
+  for (uint64 i = 0; i < blocks.size(); ++i)
+    EXPECT_TRUE(store.Contains(blocks[i]));
+  int on_stack;
+  EXPECT_FALSE(store.Contains(&on_stack));
+
+  // Large allocations get a dedicated chunk.
+  EXPECT_TRUE(store.Alloc(10000) != NULL);
+  EXPECT_EQ(4UL, store.nchunks());
+}
+
+TEST(SegmentedStoreTest, HugePages) {
+  SegmentedStore store(1024, true);
+  Value list = KAtomNil();
+  for (int i = 0; i < 1000; ++i)
+    list = List::New(&store, Value::Integer(i), list);
+  EXPECT_EQ(1UL, store.nchunks());
+  EXPECT_EQ(SegmentedStore::kHugePageSize, store.capacity());
+  EXPECT_TRUE(store.Contains(list.heap_value()));
+}
+
+TEST(RegionStoreTest, Export) {
+  StaticStore store(kOldSize);
+  Value outside = List::New(&store, Value::Integer(0), KAtomNil());
+  RegionStore region(1024);
+  Value exported;
+  {
+    ScopedRegion scope(&region);
+    Value list = outside;
+    for (int i = 1; i <= 100; ++i)
+      list = List::New(&region, Value::Integer(i), list);
+    Value values[] = { list, Value::Integer(1) };
+    Value temporary = Tuple::New(&region, Atom::Get("f"), 2, values);
+    ASSERT_TRUE(region.Contains(temporary.heap_value()));
+
+    exported = region.Export(list, &store);
+    EXPECT_TRUE(store.Contains(exported.heap_value()));
+    EXPECT_GT(region.nchunks(), 1UL);
+  }
+  EXPECT_EQ(0UL, region.size());
+  EXPECT_EQ(1UL, region.nchunks());
+
+  // The value outside of the region is shared, not copied.
+  Value list = exported;
+  for (int i = 100; i >= 1; --i) {
+    EXPECT_EQ(i, IntValue(list.as<List>()->head()));
+    list = list.as<List>()->tail();
+  }
+  EXPECT_TRUE(list == outside);
+}
+
+TEST(PoolStoreTest, SizeClasses) {
+  PoolStore store;
+  // Lists and variables are carved out of distinct slabs.
+  List* const list1 = List::New(&store, KAtomNil(), KAtomNil());
+  Variable::New(&store);
+  List* const list2 = List::New(&store, KAtomNil(), KAtomNil());
+  EXPECT_EQ(reinterpret_cast<char*>(list1) + sizeof(List),
+            reinterpret_cast<char*>(list2));
+  EXPECT_EQ(2UL, store.nslabs());
+  EXPECT_EQ(2 * sizeof(List) + sizeof(Variable), store.size());
+
+  // Large blocks are not pooled.
+  EXPECT_TRUE(store.Contains(store.Alloc(10000)));
+  EXPECT_EQ(2UL, store.nslabs());
+}
+
+TEST(PoolStoreTest, FreeList) {
+  PoolStore store;
+  void* const block1 = store.Alloc(sizeof(Cell));
+  void* const block2 = store.Alloc(sizeof(Cell));
+  store.Free(block1, sizeof(Cell));
+  EXPECT_EQ(sizeof(Cell), store.size());
+  EXPECT_EQ(block1, store.Alloc(sizeof(Cell)));
+  EXPECT_NE(block2, store.Alloc(sizeof(Cell)));
+}
+
+TEST(PoolStoreTest, Reset) {
+  PoolStore store(1024);
+  void* const first = store.Alloc(sizeof(List));
+  for (int i = 0; i < 1000; ++i)
+    store.Alloc(sizeof(List));
+  const uint64 nslabs = store.nslabs();
+  EXPECT_GT(nslabs, 1UL);
+
+  store.Reset();
+  EXPECT_EQ(0UL, store.size());
+  EXPECT_EQ(first, store.Alloc(sizeof(List)));
+  for (int i = 0; i < 1000; ++i)
+    store.Alloc(sizeof(List));
+  EXPECT_EQ(nslabs, store.nslabs());
+}
+
+TEST(ThreadLocalStoreTest, Refills) {
+  SharedStore shared;
+  ThreadLocalStore tlab1(&shared, 1024);
+  ThreadLocalStore tlab2(&shared, 1024);
+  char* const block1 = static_cast<char*>(tlab1.Alloc(8));
+  char* const block2 = static_cast<char*>(tlab2.Alloc(8));
+  EXPECT_EQ(block1 + 8, static_cast<char*>(tlab1.Alloc(8)));
+  EXPECT_EQ(block2 + 8, static_cast<char*>(tlab2.Alloc(8)));
+  EXPECT_EQ(2048UL, shared.size());
+
+  for (int i = 0; i < 1000; ++i)
+    EXPECT_TRUE(tlab1.Contains(List::New(&tlab1, KAtomNil(), KAtomNil())));
+  EXPECT_GE(tlab1.nrefills(), 1000 * sizeof(List) / 1024);
+  EXPECT_EQ(1024 * (tlab1.nrefills() + tlab2.nrefills()), shared.size());
+
+  // Large blocks bypass the buffers.
+  tlab2.Alloc(4096);
+  EXPECT_EQ(1UL, tlab2.nrefills());
+}
+
+class InterningStoreTest : public testing::Test {
+ protected:
+  InterningStoreTest()
+      : store_(kOldSize) {
+  }
+
+  // @returns A new value f(1 [a 1e300] "s" 2^70 r(x:[1]) <tail>).
+  Value MakeValue(Value tail) {
+    vector<Value> features;
+    features.push_back(Atom::Get("x"));
+    Value rvalues[] = {
+      List::New(&store_, Value::Integer(1), KAtomNil()),
+    };
+    Value values[] = {
+      Value::Integer(1),
+      List::New(&store_, Atom::Get("a"),
+                List::New(&store_, New::Float(&store_, 1e300), KAtomNil())),
+      String::Get(&store_, "s"),
+      Integer::New(&store_, mpz_class(1) << 70),
+      Record::New(&store_, Atom::Get("r"), Arity::Get(features), rvalues),
+      tail,
+    };
+    return Tuple::New(&store_, Atom::Get("f"), ArraySize(values), values);
+  }
+
+  StaticStore store_;
+  InterningStore interning_store_;
+};
+
+TEST_F(InterningStoreTest, HashConsing) {
+  Value value1 = MakeValue(KAtomNil());
+  Value value2 = MakeValue(KAtomNil());
+  EXPECT_TRUE(value1 != value2);
+
+  Value canonical1 = interning_store_.Intern(value1);
+  EXPECT_TRUE(canonical1 != value1);
+  EXPECT_TRUE(interning_store_.Contains(canonical1.heap_value()));
+  EXPECT_TRUE(interning_store_.IsCanonical(canonical1));
+  EXPECT_EQ(value1.ToString(), canonical1.ToString());
+  const uint64 size = interning_store_.size();
+
+  // Structurally equal values share a single copy.
+  EXPECT_TRUE(canonical1 == interning_store_.Intern(value2));
+  EXPECT_TRUE(canonical1 == interning_store_.Intern(canonical1));
+  EXPECT_EQ(size, interning_store_.size());
+
+  // Components are shared too: [1] appears twice in the value.
+  Value canonical3 =
+      interning_store_.Intern(MakeValue(Value::Integer(0)));
+  EXPECT_TRUE(canonical3 != canonical1);
+  EXPECT_TRUE(canonical3.TupleGet(1) == canonical1.TupleGet(1));
+  EXPECT_EQ(size + 1, interning_store_.size());
+
+  EXPECT_TRUE(InterningStore::AreCanonical(canonical1, canonical3));
+  EXPECT_FALSE(Equals(canonical1, canonical3));
+  EXPECT_TRUE(Equals(canonical1, value2));
+}
+
+TEST_F(InterningStoreTest, SeveralStores) {
+  InterningStore other_store;
+  Value canonical1 = interning_store_.Intern(MakeValue(KAtomNil()));
+  Value canonical2 = other_store.Intern(MakeValue(KAtomNil()));
+  EXPECT_TRUE(canonical1 != canonical2);
+  EXPECT_FALSE(interning_store_.IsCanonical(canonical2));
+  EXPECT_FALSE(other_store.IsCanonical(canonical1));
+
+  // Canonical values of different stores may be structurally equal.
+  EXPECT_FALSE(InterningStore::AreCanonical(canonical1, canonical2));
+  EXPECT_TRUE(Equals(canonical1, canonical2));
+}
+
+TEST_F(InterningStoreTest, NotInternable) {
+  // Free variable.
+  Value free = MakeValue(Variable::New(&store_));
+  EXPECT_TRUE(free == interning_store_.Intern(free));
+
+  // Stateful value.
+  Value stateful = MakeValue(New::Cell(&store_, KAtomNil()));
+  EXPECT_TRUE(stateful == interning_store_.Intern(stateful));
+
+  // X = f(X)
+  Value cyclic = Tuple::New(&store_, Atom::Get("f"), 1);
+  EXPECT_TRUE(Unify(cyclic.TupleGet(0), cyclic));
+  EXPECT_TRUE(cyclic == interning_store_.Intern(cyclic));
+
+  // Once bound, the variable is dereferenced.
+  Variable* const var = Variable::New(&store_);
+  Value value = MakeValue(var);
+  EXPECT_TRUE(Unify(var, KAtomNil()));
+  EXPECT_TRUE(interning_store_.Intern(value)
+              == interning_store_.Intern(MakeValue(KAtomNil())));
+}
+
+// Root set made of a list of value references.
+class ValueRoots : public RootSet {
+ public:
+  void Add(Value* value) { values_.push_back(value); }
+
+  virtual void MoveRoots(MoveContext* context) {
+    for (uint64 i = 0; i < values_.size(); ++i)
+      *values_[i] = context->Move(*values_[i]);
+  }
+
+  virtual void GetRoots(vector<Value>* roots) {
+    for (uint64 i = 0; i < values_.size(); ++i)
+      roots->push_back(*values_[i]);
+  }
+
+ private:
+  vector<Value*> values_;
+};
+
+class GenerationalStoreTest : public testing::Test {
+ protected:
+  GenerationalStoreTest()
+      : store_(kNurserySize, kOldSize) {
+  }
+
+  // @returns A list of integers from 1 to size.
+  Value MakeList(uint64 size) {
+    Value list = KAtomNil();
+    for (uint64 i = size; i > 0; --i)
+      list = List::New(&store_, Value::Integer(i), list);
+    return list;
+  }
+
+  GenerationalStore store_;
+};
+
+TEST_F(GenerationalStoreTest, MinorCollection) {
+  Value list = MakeList(10);
+  const string repr = list.ToString();
+  MakeList(20);  // Garbage
+  EXPECT_TRUE(store_.Contains(list.heap_value()));
+
+  ValueRoots roots;
+  roots.Add(&list);
+  store_.CollectMinor(&roots);
+
+  EXPECT_EQ(0UL, store_.nursery_used());
+  EXPECT_EQ(10 * sizeof(List), store_.old_used());
+  EXPECT_EQ(repr, list.ToString());
+  EXPECT_EQ(1UL, store_.stats().nminor);
+  EXPECT_EQ(10 * sizeof(List), store_.stats().promoted_bytes);
+
+  // Promotions are not accounted as allocations.
+  EXPECT_EQ(30UL, store_.alloc_stats().nallocs(Value::LIST));
+}
+
+TEST_F(GenerationalStoreTest, CyclicValue) {
+  // X = f(X a)
+  Value x = Tuple::New(&store_, Atom::Get("f"), 2);
+  EXPECT_TRUE(Unify(x.TupleGet(0), x));
+  EXPECT_TRUE(Unify(x.TupleGet(1), Atom::Get("a")));
+
+  ValueRoots roots;
+  roots.Add(&x);
+  store_.CollectMinor(&roots);
+
+  EXPECT_EQ(Value::TUPLE, x.type());
+  EXPECT_TRUE(x.TupleGet(0).Deref() == x);
+  EXPECT_TRUE(x.TupleGet(1).Deref() == Atom::Get("a"));
+}
+
+TEST_F(GenerationalStoreTest, OldToYoungReference) {
+  Value cell = New::Cell(&store_, KAtomNil());
+  ValueRoots roots;
+  roots.Add(&cell);
+  store_.CollectMinor(&roots);
+
+  // The cell lives in the old generation, the list is young.
+  cell.as<Cell>()->Assign(MakeList(3));
+  store_.CollectMinor(&roots);
+  MakeList(10);  // Overwrites the nursery.
+
+  EXPECT_EQ("[1 2 3]", cell.as<Cell>()->Access().ToString());
+}
+
+TEST_F(GenerationalStoreTest, NurseryOverflow) {
+  Value list = MakeList(1000);
+  EXPECT_TRUE(store_.NeedsCollection());
+  EXPECT_GT(store_.old_used(), 0UL);
+
+  ValueRoots roots;
+  roots.Add(&list);
+  store_.Collect(&roots);
+  EXPECT_FALSE(store_.NeedsCollection());
+  uint64 length = 0;
+  for (Value it = list; it != KAtomNil(); it = it.TupleGet(1).Deref())
+    length++;
+  EXPECT_EQ(1000UL, length);
+}
+
+TEST_F(GenerationalStoreTest, MajorCollection) {
+  Value list = MakeList(10);
+  ValueRoots roots;
+  roots.Add(&list);
+  store_.CollectMinor(&roots);
+  Value garbage = MakeList(100);
+  roots.Add(&garbage);
+  store_.CollectMinor(&roots);
+  EXPECT_EQ(110 * sizeof(List), store_.old_used());
+
+  garbage = KAtomNil();
+  store_.CollectMajor(&roots);
+  EXPECT_EQ(10 * sizeof(List), store_.old_used());
+  EXPECT_EQ("[1 2 3 4 5 6 7 8 9 10]", list.ToString());
+  EXPECT_EQ(1UL, store_.stats().nmajor);
+}
+
+TEST_F(GenerationalStoreTest, FinalizeDeadValues) {
+  // Closures hold a reference to their code: it is released when a
+  // closure is destroyed.
+  vector<Bytecode> bytecode(1, Bytecode(Bytecode::RETURN));
+  const shared_ptr<PackedCode> code(new PackedCode(bytecode));
+  Value live = Closure::New(&store_, code, 0, 0, 0);
+  ValueRoots roots;
+  roots.Add(&live);
+
+  for (int round = 0; round < 10; ++round) {
+    // Garbage owning memory outside of the store.
+    for (int i = 0; i < 10; ++i) {
+      Closure::New(&store_, code, 0, 0, 0);
+      String::Get(&store_, string(100, 'x'));
+      OpenRecord::New(&store_, Atom::Get("r"));
+    }
+    EXPECT_EQ(12, code.use_count());
+    if (round % 2 == 0)
+      store_.CollectMinor(&roots);
+    else
+      store_.CollectMajor(&roots);
+
+    // Only the live closure is left.
+    EXPECT_EQ(2, code.use_count());
+    EXPECT_EQ(1UL, store_.nfinalizable());
+  }
+  ASSERT_EQ(Value::CLOSURE, live.type());
+  EXPECT_EQ(code.get(), &live.as<Closure>()->code());
+}
+
+TEST_F(GenerationalStoreTest, Quota) {
+  StoreQuota quota;
+  quota.soft_limit = 2 * kNurserySize;
+  quota.hard_limit = 4 * kNurserySize;
+  store_.set_quota(quota);
+
+  Value list = MakeList(100);
+  ValueRoots roots;
+  roots.Add(&list);
+  EXPECT_THROW(MakeList(1000), OutOfMemory);
+  EXPECT_EQ(1UL, store_.quota_usage().nrefused);
+  EXPECT_LE(store_.used(), quota.hard_limit);
+
+  // A refused allocation forces a major collection.
+  EXPECT_TRUE(store_.NeedsCollection());
+  store_.Collect(&roots);
+  EXPECT_EQ(1UL, store_.stats().nmajor);
+  EXPECT_EQ(100 * sizeof(List), store_.used());
+  // The store was past its soft limit as well.
+  EXPECT_EQ(1UL, store_.quota_usage().nsoft_collections);
+
+  // Crossing the soft limit forces a major collection too.
+  Value live = MakeList(400);
+  roots.Add(&live);
+  EXPECT_GT(store_.used(), quota.soft_limit);
+  EXPECT_TRUE(store_.NeedsCollection());
+  store_.Collect(&roots);
+  EXPECT_EQ(2UL, store_.stats().nmajor);
+  EXPECT_EQ(2UL, store_.quota_usage().nsoft_collections);
+
+  // The live values exceed the soft limit: wait for the store to grow.
+  EXPECT_FALSE(store_.NeedsCollection());
+}
+
+}  // namespace store
@@ -20,14 +20,20 @@ class String : public HeapValue {
   // ---------------------------------------------------------------------------
   // Factory methods
   static inline String* Get(Store* store, const string& value) {
-    return new(CHECK_NOTNULL(store->Alloc<String>())) String(value);
+    String* const str =
+        new(CHECK_NOTNULL(store->Alloc<String>())) String(value);
+    store->AddFinalizable(str);  // Owns the characters.
+    return str;
   }
 
+  const string& value() const { return value_; }
+
   // ---------------------------------------------------------------------------
   // Value API
-  virtual ValueType type() const noexcept { return kType; }
+  virtual uint64 HeapSize() const { return sizeof(String); }
   virtual bool UnifyWith(UnificationContext* context, Value value);
   virtual bool Equals(EqualityContext* context, Value value);
+  virtual HeapValue* MoveInternal(Store* store) { return Get(store, value_); }
 
   // ---------------------------------------------------------------------------
   // Serialization
@@ -36,7 +42,7 @@ class String : public HeapValue {
 
  private:  // ------------------------------------------------------------------
 
-  explicit String(const string& value) : value_(value) {}
+  explicit String(const string& value) : HeapValue(kType), value_(value) {}
   virtual ~String() {}
 
   // ---------------------------------------------------------------------------
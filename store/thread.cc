@@ -10,11 +10,59 @@ using boost::format;
 
 namespace store {
 
+const Value::ValueType Thread::kType;
+const uint32 Thread::kIndexedOperandKinds;
+const uint32 Thread::kWritableOperandKinds;
+
 uint64 Thread::next_id_ = 0;
 
+Thread::Thread(Thread* thread)
+    : HeapValue(kType),
+      id_(thread->id_),
+      engine_(thread->engine_),
+      store_(thread->store_),
+      exception_(thread->exception_),
+      next_suspended_(thread->next_suspended_),
+      linked_(thread->linked_) {
+  call_stack_.swap(thread->call_stack_);
+}
+
 Thread::~Thread() {
 }
 
+// virtual
+HeapValue* Thread::MoveInternal(Store* store) {
+  Thread* const moved = new(CHECK_NOTNULL(store->Alloc<Thread>())) Thread(this);
+  store->AddFinalizable(moved);
+  return moved;
+}
+
+// virtual
+void Thread::MoveReferences(MoveContext* context) {
+  for (auto it = call_stack_.begin(); it != call_stack_.end(); ++it) {
+    it->proc_ = context->MoveRef(it->proc_);
+    it->parameters_ = context->MoveRef(it->parameters_);
+    it->locals_ = context->MoveRef(it->locals_);
+    it->array_ = context->MoveRef(it->array_);
+  }
+  exception_ = context->Move(exception_);
+  next_suspended_ = context->MoveRef(next_suspended_);
+}
+
+// virtual
+void Thread::ExploreValue(ReferenceMap* ref_map) {
+  CHECK_NOTNULL(ref_map);
+  for (auto it = call_stack_.begin(); it != call_stack_.end(); ++it) {
+    Value(it->proc_).Explore(ref_map);
+    Value(it->parameters_).Explore(ref_map);
+    Value(it->locals_).Explore(ref_map);
+    if (it->array_ != NULL)
+      Value(it->array_).Explore(ref_map);
+  }
+  if (exception_.IsDefined())
+    exception_.Explore(ref_map);
+}
+
 uint64 Thread::GetNextThreadID() {
   uint64 id = next_id_;
   ++next_id_;
@@ -22,7 +70,8 @@ uint64 Thread::GetNextThreadID() {
 }
 
 // @returns True if the current thread suspends on the specified value.
-//     Registers the waiting thread as a suspension of the free variable.
+//     Registers the waiting thread as a suspension of the free variable,
+//     unless it is already registered in a suspension list.
 // @param value A value that has already been dereferenced.
 bool Thread::WaitOn(Value value) {
   // TODO Find a correct way to report suspensions
@@ -34,733 +83,1111 @@ bool Thread::WaitOn(Value value) {
 
 Thread::ThreadState Thread::Run(
     uint64 steps_count,
-    list<Thread*>* new_runnable) {
-
-  for (uint64 i = 0; i < steps_count; ++i) {
-
-    // Warning: Do not use cse after call_stack_ has been modified!
-    CallStackEntry* cse = &call_stack_.back();
-    if (cse->code_pointer_ >= cse->proc_->bytecode().size())
-      goto terminated;
-    const Bytecode& inst =
-        cse->proc_->bytecode()[cse->code_pointer_];
-    VLOG(3) << "Executing: "
-            << (format("closure@%p cp=%d ")
-                % cse->proc_ % cse->code_pointer_).str()
-            << inst.GetOpcodeName();
-
-    int32 next_code_pointer = cse->code_pointer_ + 1;
-
-    switch (inst.opcode) {
-      case Bytecode::NO_OPERATION:
-        break;
-
-      case Bytecode::LOAD: {
-        RSet(inst.operand1, OpGet(inst.operand2));
-        break;
-      }
-
-      case Bytecode::UNIFY: {
-        const bool success =
-            store::Unify(
-                OpGet(inst.operand1),
-                OpGet(inst.operand2),
-                new_runnable);
-        if (!success) {
-          // TODO: throw an exception instead
-          goto bad_operand;
-        }
-        break;
-      }
-
-      case Bytecode::TRY_UNIFY: {
-        const bool success =
-            store::Unify(
-                OpGet(inst.operand1),
-                OpGet(inst.operand2),
-                new_runnable);
-        RSet(inst.operand3, success ? KAtomTrue() : KAtomFalse());
-        break;
-      }
-
-      case Bytecode::UNIFY_RECORD_FIELD: {
-        Value record = OpGet(inst.operand1).Deref();
-        if (WaitOn(record)) goto suspended;
-        if (!(record.caps() & Value::CAP_RECORD)) goto bad_operand;
-
-        Value feature = OpGet(inst.operand2).Deref();
-        if (WaitOn(feature)) goto suspended;
-        if (!(feature.caps() & Value::CAP_LITERAL)) goto bad_operand;
-
-        const bool success =
-            store::Unify(
-                record.RecordGet(feature),
-                OpGet(inst.operand3),
-                new_runnable);
-        if (!success) {
-          // TODO: throw an exception instead
-          goto bad_operand;
-        }
-        break;
-      }
-
-      // -----------------------------------------------------------------------
-      // Control-flow
-
-      case Bytecode::BRANCH: {
-        Value bc_pointer = OpGet(inst.operand1).Deref();
-        if (!HasType(bc_pointer, Value::SMALL_INTEGER)) goto bad_operand;
-
-        next_code_pointer = SmallInteger(bc_pointer).value();
-        break;
-      }
-
-      case Bytecode::BRANCH_IF: {
-        Value cond_val = OpGet(inst.operand1).Deref();
-        if (WaitOn(cond_val)) goto suspended;
-        // if (!HasType(cond_val, Value::BOOLEAN)) goto bad_operand;
-        bool cond;
-        if (cond_val == KAtomTrue()) cond = true;
-        else if (cond_val == KAtomFalse()) cond = false;
-        else goto bad_operand;
-
-        // The following check could be statically verified.
-        Value bc_pointer = OpGet(inst.operand2).Deref();
-        if (!HasType(bc_pointer, Value::SMALL_INTEGER)) goto bad_operand;
+    SuspensionList* new_runnable) {
+  try {
+    return Execute(steps_count, new_runnable);
+  } catch (const OutOfMemory& error) {
+    LOG(INFO) << "Thread " << id_ << ": " << error.what();
+    if (!Raise(Atom::Get("out_of_memory"))) return TERMINATED;
+    // The engine may collect the store before the handler runs.
+    return RUNNABLE;
+  }
+}
 
-        // const bool cond = cond_val.as<Boolean>()->value();
-        if (cond) {
-          next_code_pointer = SmallInteger(bc_pointer).value();
-        }
-        break;
-      }
+bool Thread::Raise(Value exception) {
+  exception_ = exception;
+
+  // Jump to the first reachable exception/finally handler.
+  while (!call_stack_.empty() && call_stack_.back().exn_handlers_.empty())
+    call_stack_.pop_back();
+  if (call_stack_.empty()) {
+    LOG(INFO) << "Thread terminated by uncaught exception: "
+              << exception.ToString();
+    return false;
+  }
+  CallStackEntry* const cse = &call_stack_.back();
+  const ExnStackEntry& ese = cse->exn_handlers_.back();
+  cse->code_pointer_ = ese.code_pointer_;
+  cse->exn_handlers_.pop_back();
+  return true;
+}
 
-      case Bytecode::BRANCH_UNLESS: {
-        Value cond_val = OpGet(inst.operand1).Deref();
-        if (WaitOn(cond_val)) goto suspended;
-        // if (!HasType(cond_val, Value::BOOLEAN)) goto bad_operand;
-        bool cond;
-        if (cond_val == KAtomTrue()) cond = true;
-        else if (cond_val == KAtomFalse()) cond = false;
-        else goto bad_operand;
-
-        // The following check could be statically verified.
-        Value bc_pointer = OpGet(inst.operand2).Deref();
-        if (!HasType(bc_pointer, Value::SMALL_INTEGER)) goto bad_operand;
+namespace {
 
-        // const bool cond = cond_val.as<Boolean>()->value();
-        if (!cond) {
-          next_code_pointer = SmallInteger(bc_pointer).value();
-        }
-        break;
-      }
+// @returns The base pointer of a register array, or NULL if the array is unset
+//     or does not hold all the registers of this type the bytecode uses.
+Value* ResolveArray(Array* array, const PackedCode& code,
+                    Register::RegisterType type) {
+  if ((array == NULL) || (array->size() < code.nregisters(type))) return NULL;
+  return array->mutable_values();
+}
 
-      case Bytecode::BRANCH_SWITCH_LITERAL: {
-        Value branches = OpGet(inst.operand2).Deref();
-        if (!(branches.caps() & Value::CAP_ARITY)) goto bad_operand;
+}  // anonymous namespace
+
+void Thread::ResolveRegisters(RegisterFile* registers) {
+  const CallStackEntry& cse = call_stack_.back();
+  const PackedCode& code = cse.proc_->code();
+  Value** const bases = *registers;
+  std::fill(bases, bases + arraysize(*registers), static_cast<Value*>(NULL));
+
+  // Register operands are not bound-checked when executed through their base
+  // pointer: only resolve the register arrays that hold the highest index the
+  // bytecode uses. The bytecode may still use smaller arrays, e.g. on paths
+  // that do not run, or after replacing an array.
+  bases[Register::LOCAL] = ResolveArray(cse.locals_, code, Register::LOCAL);
+  bases[Register::PARAM] =
+      ResolveArray(cse.parameters_, code, Register::PARAM);
+  bases[Register::ENVMT] =
+      ResolveArray(cse.proc_->environment(), code, Register::ENVMT);
+  bases[Register::ARRAY] = ResolveArray(cse.array_, code, Register::ARRAY);
+  // Constants are never written: OpSet() rejects constant operands.
+  bases[PackedCode::CONSTANT] = const_cast<Value*>(code.constants());
+}
 
-        Value value = OpGet(inst.operand1).Deref();
-        if (WaitOn(value)) goto suspended;
-        if (!(value.caps() & Value::CAP_LITERAL)) goto bad_operand;
+Array* Thread::NewArguments(uint64 nargs,
+                            const uint64* arguments,
+                            const RegisterFile& registers) {
+  Array* const params = Array::New(store_, nargs, KAtomEmpty());
+  Value* const values = params->mutable_values();
+  for (uint64 i = 0; i < nargs; ++i) {
+    values[i] = OpGet(PackedCode::GetOperand(arguments[i / 3], i % 3 + 1),
+                      registers);
+  }
+  return params;
+}
 
-        try {
-          Value bc_pointer = branches.RecordGet(value).Deref();
-          if (!HasType(bc_pointer, Value::SMALL_INTEGER)) goto bad_operand;
-          next_code_pointer = SmallInteger(bc_pointer).value();
-        } catch (FeatureNotFound) {
-          // Move to next instruction
-        }
-        break;
-      }
+namespace {
+
+// Looks a record feature up through the inline cache of an instruction.
+// Values other than proper records are looked up with RecordGet().
+// @param record The record to look the feature up in, dereferenced.
+// @param feature The feature to look up, dereferenced.
+// @param cache The inline cache of the instruction.
+// @param stats Accounts for the cache hits and misses.
+// @returns The value of the feature. Throws FeatureNotFound.
+inline Value CachedRecordGet(Value record, Value feature,
+                             PackedCode::InlineCache* cache,
+                             InlineCacheStats* stats) {
+  if (record.type() != Value::RECORD) return record.RecordGet(feature);
+  Record* const rec = record.as<Record>();
+  const Arity* const arity = rec->arity();
+  if ((cache->arity == arity) && (cache->feature == feature.bits())) {
+    stats->nhits++;
+    return rec->values()[cache->index];
+  }
+  stats->nmisses++;
+  const uint64 index = rec->arity()->Map(feature);
+  if (HasType(feature, Value::ATOM) || HasType(feature, Value::SMALL_INTEGER)) {
+    cache->arity = arity;
+    cache->feature = feature.bits();
+    cache->index = index;
+  }
+  return rec->values()[index];
+}
 
-      case Bytecode::CALL: {
-        Value closure_val = OpGet(inst.operand1).Deref();
-        if (WaitOn(closure_val)) goto suspended;
-        if (!HasType(closure_val, Value::CLOSURE)) goto bad_operand;
-        Closure* closure = closure_val.as<Closure>();
-
-        Value params_val = OpGet(inst.operand2).Deref();
-        if (!HasType(params_val, Value::ARRAY)) goto bad_operand;
-        Array* params = params_val.as<Array>();
-
-        cse->code_pointer_ = next_code_pointer;
-        call_stack_.push_back(CallStackEntry(store_, closure, params));
-        // Do not use cse after call_stack_ has been modified!
-        continue;
-        break;
+}  // namespace
+
+// -----------------------------------------------------------------------------
+// Instruction dispatch
+//
+// With GCC-compatible compilers, the interpreter is direct-threaded: every
+// instruction handler jumps straight to the handler of the next instruction,
+// through a table of label addresses. Other compilers, or builds defining
+// GOOZ_SWITCH_DISPATCH, use a switch statement in a loop instead.
+
+#if defined(__GNUC__) && !defined(GOOZ_SWITCH_DISPATCH)
+#define GOOZ_THREADED_DISPATCH
+#endif
+
+// Fetches the packed instruction at next_code_pointer into inst.
+// Leaves the interpreter loop when the thread runs out of steps.
+#define FETCH_INSTRUCTION()                                             \
+  do {                                                                  \
+    if (steps_left == 0) goto out_of_steps;                             \
+    --steps_left;                                                       \
+    code_pointer = next_code_pointer;                                   \
+    if (code_pointer >= code_size) goto terminated;                     \
+    inst = code[code_pointer];                                          \
+    next_code_pointer = code_pointer + 1;                               \
+    DVLOG(3) << "Executing: "                                           \
+             << (format("closure@%p cp=%d ")                            \
+                 % cse->proc_ % code_pointer).str()                     \
+             << cse->proc_->code().Unpack(code_pointer).ToString();     \
+  } while (false)
+
+#ifdef GOOZ_THREADED_DISPATCH
+#define OPCODE(Name) op_##Name
+#define NEXT_INSTRUCTION()                                              \
+  do {                                                                  \
+    FETCH_INSTRUCTION();                                                \
+    goto *kDispatchTable[PackedCode::GetOpcode(inst)];                  \
+  } while (false)
+#else
+#define OPCODE(Name) case Bytecode::Name
+#define NEXT_INSTRUCTION() goto next_instruction
+#endif
+
+// Descriptor of the specified operand of the current instruction.
+#define OPERAND(N) PackedCode::GetOperand(inst, N)
+
+Thread::ThreadState Thread::Execute(
+    uint64 steps_count,
+    SuspensionList* new_runnable) {
+#ifdef GOOZ_THREADED_DISPATCH
+  // Handler of each opcode, in the order of Bytecode::OpcodeType.
+  static const void* const kDispatchTable[Bytecode::OPCODE_TYPE_COUNT] = {
+#define DISPATCH_ENTRY(Name) [Bytecode::Name] = &&op_##Name
+    DISPATCH_ENTRY(NO_OPERATION),
+    DISPATCH_ENTRY(LOAD),
+    DISPATCH_ENTRY(UNIFY),
+    DISPATCH_ENTRY(TRY_UNIFY),
+    DISPATCH_ENTRY(UNIFY_RECORD_FIELD),
+    DISPATCH_ENTRY(BRANCH),
+    DISPATCH_ENTRY(BRANCH_IF),
+    DISPATCH_ENTRY(BRANCH_UNLESS),
+    DISPATCH_ENTRY(BRANCH_SWITCH_LITERAL),
+    DISPATCH_ENTRY(CALL),
+    DISPATCH_ENTRY(CALL_TAIL),
+    DISPATCH_ENTRY(CALL_NATIVE),
+    DISPATCH_ENTRY(RETURN),
+    DISPATCH_ENTRY(EXN_PUSH_CATCH),
+    DISPATCH_ENTRY(EXN_PUSH_FINALLY),
+    DISPATCH_ENTRY(EXN_POP),
+    DISPATCH_ENTRY(EXN_RAISE),
+    DISPATCH_ENTRY(EXN_RESET),
+    DISPATCH_ENTRY(EXN_RERAISE),
+    DISPATCH_ENTRY(NEW_VARIABLE),
+    DISPATCH_ENTRY(NEW_NAME),
+    DISPATCH_ENTRY(NEW_CELL),
+    DISPATCH_ENTRY(NEW_ARRAY),
+    DISPATCH_ENTRY(NEW_ARITY),
+    DISPATCH_ENTRY(NEW_LIST),
+    DISPATCH_ENTRY(NEW_TUPLE),
+    DISPATCH_ENTRY(NEW_RECORD),
+    DISPATCH_ENTRY(NEW_PROC),
+    DISPATCH_ENTRY(NEW_THREAD),
+    DISPATCH_ENTRY(GET_VALUE_TYPE),
+    DISPATCH_ENTRY(ACCESS_CELL),
+    DISPATCH_ENTRY(ACCESS_ARRAY),
+    DISPATCH_ENTRY(ACCESS_RECORD),
+    DISPATCH_ENTRY(ACCESS_RECORD_LABEL),
+    DISPATCH_ENTRY(ACCESS_RECORD_ARITY),
+    DISPATCH_ENTRY(ACCESS_OPEN_RECORD_ARITY),
+    DISPATCH_ENTRY(ASSIGN_CELL),
+    DISPATCH_ENTRY(ASSIGN_ARRAY),
+    DISPATCH_ENTRY(TEST_IS_DET),
+    DISPATCH_ENTRY(TEST_IS_RECORD),
+    DISPATCH_ENTRY(TEST_EQUALITY),
+    DISPATCH_ENTRY(TEST_LESS_THAN),
+    DISPATCH_ENTRY(TEST_LESS_OR_EQUAL),
+    DISPATCH_ENTRY(TEST_ARITY_EXTENDS),
+    DISPATCH_ENTRY(NUMBER_INT_INVERSE),
+    DISPATCH_ENTRY(NUMBER_INT_ADD),
+    DISPATCH_ENTRY(NUMBER_INT_SUBTRACT),
+    DISPATCH_ENTRY(NUMBER_INT_MULTIPLY),
+    DISPATCH_ENTRY(NUMBER_INT_DIVIDE),
+    DISPATCH_ENTRY(NUMBER_FLOAT_INVERSE),
+    DISPATCH_ENTRY(NUMBER_FLOAT_ADD),
+    DISPATCH_ENTRY(NUMBER_FLOAT_SUBTRACT),
+    DISPATCH_ENTRY(NUMBER_FLOAT_MULTIPLY),
+    DISPATCH_ENTRY(NUMBER_FLOAT_DIVIDE),
+    DISPATCH_ENTRY(NUMBER_BOOL_NEGATE),
+    DISPATCH_ENTRY(NUMBER_BOOL_AND_THEN),
+    DISPATCH_ENTRY(NUMBER_BOOL_OR_ELSE),
+    DISPATCH_ENTRY(NUMBER_BOOL_XOR),
+    DISPATCH_ENTRY(BRANCH_IF_LESS_THAN),
+    DISPATCH_ENTRY(BRANCH_UNLESS_EQUAL),
+    DISPATCH_ENTRY(CALL_ARGS),
+    DISPATCH_ENTRY(CALL_NATIVE_ARGS),
+    DISPATCH_ENTRY(ARGUMENTS),
+#undef DISPATCH_ENTRY
+  };
+#endif  // GOOZ_THREADED_DISPATCH
+
+  // The current frame, its bytecode and its register file are kept in locals,
+  // and are only reloaded from call_stack_ when it changes (calls, returns,
+  // exceptions). The store is not collected while executing, hence the
+  // register file only goes stale when the frame replaces a register array.
+  // The code pointer of the frame is written back when leaving the loop or
+  // pushing a new frame.
+  CallStackEntry* cse = NULL;
+  const PackedCode::Instruction* code = NULL;
+  RegisterFile registers;
+  PackedCode::InlineCache* caches = NULL;
+  uint64 code_size = 0;
+  uint64 code_pointer = 0;  // Code pointer of the current instruction.
+  uint64 next_code_pointer = 0;
+  PackedCode::Instruction inst = 0;
+  uint64 steps_left = steps_count;
+
+enter_frame:  // call_stack_ has been modified: reload the current frame.
+  cse = &call_stack_.back();
+  code = cse->proc_->code().instructions();
+  ResolveRegisters(&registers);
+  caches = cse->proc_->code().inline_caches();
+  code_size = cse->proc_->code().size();
+  next_code_pointer = cse->code_pointer_;
+
+#ifdef GOOZ_THREADED_DISPATCH
+  NEXT_INSTRUCTION();
+  {
+#else
+next_instruction:
+  FETCH_INSTRUCTION();
+  switch (PackedCode::GetOpcode(inst)) {
+#endif
+    OPCODE(NO_OPERATION):
+      NEXT_INSTRUCTION();
+
+    OPCODE(LOAD): {
+      OpSet(OPERAND(1), &registers, OpGet(OPERAND(2), registers));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(UNIFY): {
+      const bool success =
+          store::Unify(
+              OpGet(OPERAND(1), registers),
+              OpGet(OPERAND(2), registers),
+              new_runnable);
+      if (!success) {
+        // TODO: throw an exception instead
+        goto bad_operand;
       }
-
-      case Bytecode::RETURN: {
-        const ExnStackEntry* finally_handler = NULL;
-        while (!cse->exn_handlers_.empty()) {
-          const ExnStackEntry& ese = cse->exn_handlers_.back();
-          if (ese.type_ == ExnStackEntry::FINALLY) {
-            finally_handler = &ese;
-            break;
-          }
-          cse->exn_handlers_.pop_back();
-        }
-        if (finally_handler != NULL) {
-          // Finally handler found: branch to it.
-          next_code_pointer = finally_handler->code_pointer_;
-          cse->exn_handlers_.pop_back();
-        } else {
-          // No finally handler in the current call: back to caller.
-          call_stack_.pop_back();
-          if (call_stack_.empty()) goto terminated;
-          // Do not use cse after call_stack_ is modified!
-          continue;
-        }
-        break;
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(TRY_UNIFY): {
+      const bool success =
+          store::Unify(
+              OpGet(OPERAND(1), registers),
+              OpGet(OPERAND(2), registers),
+              new_runnable);
+      OpSet(OPERAND(3), &registers, success ? KAtomTrue() : KAtomFalse());
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(UNIFY_RECORD_FIELD): {
+      Value record = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(record)) goto suspended;
+      if (!(record.caps() & Value::CAP_RECORD)) goto bad_operand;
+
+      Value feature = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(feature)) goto suspended;
+      if (!(feature.caps() & Value::CAP_LITERAL)) goto bad_operand;
+
+      const bool success =
+          store::Unify(
+              CachedRecordGet(record, feature, caches + code_pointer,
+                              &engine_->inline_cache_stats_),
+              OpGet(OPERAND(3), registers),
+              new_runnable);
+      if (!success) {
+        // TODO: throw an exception instead
+        goto bad_operand;
       }
-
-      case Bytecode::CALL_TAIL: {
-        Value closure_val = OpGet(inst.operand1).Deref();
-        if (WaitOn(closure_val)) goto suspended;
-        if (!HasType(closure_val, Value::CLOSURE)) goto bad_operand;
-        Closure* closure = closure_val.as<Closure>();
-
-        Value params_val = OpGet(inst.operand2).Deref();
-        if (!HasType(params_val, Value::ARRAY)) goto bad_operand;
-        Array* params = params_val.as<Array>();
-
-        cse->proc_ = closure;
-        cse->parameters_ = params;
-        // keep the existing cse->locals_
-        cse->array_ = NULL;
-        cse->exn_handlers_.clear();
-        next_code_pointer = 0;
-        break;
+      NEXT_INSTRUCTION();
+    }
+
+    // -------------------------------------------------------------------------
+    // Control-flow
+
+    OPCODE(BRANCH): {
+      Value bc_pointer = OpGet(OPERAND(1), registers).Deref();
+      if (!HasType(bc_pointer, Value::SMALL_INTEGER)) goto bad_operand;
+
+      next_code_pointer = SmallInteger(bc_pointer).value();
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(BRANCH_IF): {
+      Value cond_val = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(cond_val)) goto suspended;
+      // if (!HasType(cond_val, Value::BOOLEAN)) goto bad_operand;
+      bool cond;
+      if (cond_val == KAtomTrue()) cond = true;
+      else if (cond_val == KAtomFalse()) cond = false;
+      else goto bad_operand;
+
+      // The following check could be statically verified.
+      Value bc_pointer = OpGet(OPERAND(2), registers).Deref();
+      if (!HasType(bc_pointer, Value::SMALL_INTEGER)) goto bad_operand;
+
+      // const bool cond = cond_val.as<Boolean>()->value();
+      if (cond) {
+        next_code_pointer = SmallInteger(bc_pointer).value();
       }
-
-      case Bytecode::CALL_NATIVE: {
-        Value native_val = OpGet(inst.operand1).Deref();
-        if (WaitOn(native_val)) goto suspended;
-        if (!HasType(native_val, Value::ATOM)) goto bad_operand;
-        const string& native_name = native_val.as<Atom>()->value();
-
-        Value params_val = OpGet(inst.operand2).Deref();
-        if (!HasType(params_val, Value::ARRAY)) goto bad_operand;
-        Array* params = params_val.as<Array>();
-
-        // TODO: Better implementation for natives?
-        engine_->native_map_[native_name]->Execute(params);
-        break;
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(BRANCH_UNLESS): {
+      Value cond_val = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(cond_val)) goto suspended;
+      // if (!HasType(cond_val, Value::BOOLEAN)) goto bad_operand;
+      bool cond;
+      if (cond_val == KAtomTrue()) cond = true;
+      else if (cond_val == KAtomFalse()) cond = false;
+      else goto bad_operand;
+
+      // The following check could be statically verified.
+      Value bc_pointer = OpGet(OPERAND(2), registers).Deref();
+      if (!HasType(bc_pointer, Value::SMALL_INTEGER)) goto bad_operand;
+
+      // const bool cond = cond_val.as<Boolean>()->value();
+      if (!cond) {
+        next_code_pointer = SmallInteger(bc_pointer).value();
       }
+      NEXT_INSTRUCTION();
+    }
 
-      // -----------------------------------------------------------------------
-      // Exception handling
+    OPCODE(BRANCH_SWITCH_LITERAL): {
+      Value branches = OpGet(OPERAND(2), registers).Deref();
+      if (!(branches.caps() & Value::CAP_ARITY)) goto bad_operand;
 
-      case Bytecode::EXN_PUSH_CATCH: {
-        Value bc_pointer_val = OpGet(inst.operand1);
-        if (!HasType(bc_pointer_val, Value::SMALL_INTEGER)) goto bad_operand;
-        const uint64 bc_pointer = SmallInteger(bc_pointer_val).value();
+      Value value = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(value)) goto suspended;
+      if (!(value.caps() & Value::CAP_LITERAL)) goto bad_operand;
 
-        cse->exn_handlers_.push_back(
-            ExnStackEntry(ExnStackEntry::CATCH, bc_pointer));
-        break;
-      }
-
-      case Bytecode::EXN_PUSH_FINALLY: {
-        Value bc_pointer_val = OpGet(inst.operand1);
-        if (!HasType(bc_pointer_val, Value::SMALL_INTEGER)) goto bad_operand;
-        const uint64 bc_pointer = SmallInteger(bc_pointer_val).value();
-
-        cse->exn_handlers_.push_back(
-            ExnStackEntry(ExnStackEntry::FINALLY, bc_pointer));
-        break;
+      try {
+        Value bc_pointer =
+            CachedRecordGet(branches, value, caches + code_pointer,
+                            &engine_->inline_cache_stats_).Deref();
+        if (!HasType(bc_pointer, Value::SMALL_INTEGER)) goto bad_operand;
+        next_code_pointer = SmallInteger(bc_pointer).value();
+      } catch (FeatureNotFound) {
+        // Move to next instruction
       }
-
-      case Bytecode::EXN_POP: {
-        if (cse->exn_handlers_.empty()) goto bad_operand;
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(CALL): {
+      Value closure_val = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(closure_val)) goto suspended;
+      if (!HasType(closure_val, Value::CLOSURE)) goto bad_operand;
+      Closure* closure = closure_val.as<Closure>();
+
+      Value params_val = OpGet(OPERAND(2), registers).Deref();
+      if (!HasType(params_val, Value::ARRAY)) goto bad_operand;
+      Array* params = params_val.as<Array>();
+
+      cse->code_pointer_ = next_code_pointer;
+      call_stack_.push_back(CallStackEntry(store_, closure, params));
+      // Do not use cse after call_stack_ has been modified!
+      goto enter_frame;
+    }
+
+    OPCODE(RETURN): {
+      const ExnStackEntry* finally_handler = NULL;
+      while (!cse->exn_handlers_.empty()) {
         const ExnStackEntry& ese = cse->exn_handlers_.back();
-        if (ese.type_ == ExnStackEntry::FINALLY)
-          // Branch to the finally block
-          next_code_pointer = ese.code_pointer_;
-        cse->exn_handlers_.pop_back();
-        break;
-      }
-
-      case Bytecode::EXN_RERAISE: {
-        Value exn_val = OpGet(inst.operand1);
-        if (!exn_val.IsDetermined())
-          break;  // Do not raise!
-        // Fall through EXN_RAISE
-      }
-
-      case Bytecode::EXN_RAISE: {
-        Value exn_val = OpGet(inst.operand1);
-        if (WaitOn(exn_val)) goto suspended;
-
-        // RSet(Operand(Register(Register::EXN)), exn_val);
-        exception_ = exn_val;
-
-        // Jump to the first reachable exception/finally handler.
-        while ((cse != NULL) && cse->exn_handlers_.empty()) {
-          call_stack_.pop_back();
-          cse = call_stack_.empty() ? NULL : &call_stack_.back();
-        }
-        if (cse == NULL) {
-          LOG(INFO) << "Thread terminated by uncaught exception: "
-                    << exn_val.ToString();
-          goto terminated;
+        if (ese.type_ == ExnStackEntry::FINALLY) {
+          finally_handler = &ese;
+          break;
         }
-        const ExnStackEntry& ese = cse->exn_handlers_.back();
-        cse->code_pointer_ = ese.code_pointer_;
         cse->exn_handlers_.pop_back();
-        continue;
-        break;
-      }
-
-      case Bytecode::EXN_RESET: {
-        RSet(inst.operand1, exception_);
-        exception_ = New::Free(store_);
-        break;
-      }
-
-      // -----------------------------------------------------------------------
-      // Constructors
-
-      case Bytecode::NEW_VARIABLE: {
-        RSet(inst.operand1, New::Free(store_));
-        break;
-      }
-
-      case Bytecode::NEW_NAME: {
-        RSet(inst.operand1, New::Name(store_));
-        break;
-      }
-
-      case Bytecode::NEW_CELL: {
-        Value initial_val = OpGet(inst.operand2).Deref();
-
-        RSet(inst.operand1, New::Cell(store_, initial_val));
-        break;
-      }
-
-      case Bytecode::NEW_ARRAY: {
-        Value size_val = OpGet(inst.operand2).Deref();
-        if (WaitOn(size_val)) goto suspended;
-        if (!HasType(size_val, Value::SMALL_INTEGER)) goto bad_operand;
-        const uint64 array_size = SmallInteger(size_val).value();
-
-        Value initial_val = OpGet(inst.operand3).Deref();
-
-        RSet(inst.operand1, New::Array(store_, array_size, initial_val));
-        break;
-      }
-
-      case Bytecode::NEW_ARITY: {
-        Value array_val = OpGet(inst.operand2).Deref();
-        if (WaitOn(array_val)) goto suspended;
-        if (!HasType(array_val, Value::ARRAY)) goto bad_operand;
-        Array* const array = array_val.as<Array>();
-
-        RSet(inst.operand1, New::Arity(store_, array->size(), array->values()));
-        break;
-      }
-
-      case Bytecode::NEW_LIST: {
-        Value head_val = OpGet(inst.operand2).Deref();
-        Value tail_val = OpGet(inst.operand3).Deref();
-
-        RSet(inst.operand1, New::List(store_, head_val, tail_val));
-        break;
-      }
-
-      case Bytecode::NEW_TUPLE: {
-        Value size_val = OpGet(inst.operand2).Deref();
-        if (WaitOn(size_val)) goto suspended;
-        if (!HasType(size_val, Value::SMALL_INTEGER)) goto bad_operand;
-        const uint64 size = SmallInteger(size_val).value();
-
-        Value label_val = OpGet(inst.operand3).Deref();
-        if (WaitOn(label_val)) goto suspended;
-        if (!(label_val.caps() & Value::CAP_LITERAL)) goto bad_operand;
-
-        RSet(inst.operand1, New::Tuple(store_, label_val, size));
-        break;
-      }
-
-      case Bytecode::NEW_RECORD: {
-        Value arity_val = OpGet(inst.operand2).Deref();
-        if (WaitOn(arity_val)) goto suspended;
-        if (!HasType(arity_val, Value::ARITY)) goto bad_operand;
-        Arity* arity = arity_val.as<Arity>();
-
-        Value label_val = OpGet(inst.operand3).Deref();
-        if (WaitOn(label_val)) goto suspended;
-        if (!(label_val.caps() & Value::CAP_LITERAL)) goto bad_operand;
-
-        RSet(inst.operand1, New::Record(store_, label_val, arity));
-        break;
-      }
-
-      case Bytecode::NEW_PROC: {
-        Value closure_val = OpGet(inst.operand2).Deref();
-        if (WaitOn(closure_val)) goto suspended;
-        if (!HasType(closure_val, Value::CLOSURE)) goto bad_operand;
-        Closure* closure = closure_val.as<Closure>();
-
-        Value env_val = OpGet(inst.operand3).Deref();
-        if (!HasType(env_val, Value::ARRAY)) goto bad_operand;
-        Array* env = env_val.as<Array>();
-
-        RSet(inst.operand1, New::Closure(store_, closure, env));
-        break;
-      }
-
-      case Bytecode::NEW_THREAD: {
-        Value closure_val = OpGet(inst.operand2).Deref();
-        if (WaitOn(closure_val)) goto suspended;
-        if (!HasType(closure_val, Value::CLOSURE)) goto bad_operand;
-        Closure* closure = closure_val.as<Closure>();
-
-        Value params_val = OpGet(inst.operand3).Deref();
-        if (!HasType(params_val, Value::ARRAY)) goto bad_operand;
-        Array* params = params_val.as<Array>();
-
-        RSet(inst.operand1,
-             New::Thread(store_, engine_, closure, params, store_));
-        break;
-      }
-
-      // -----------------------------------------------------------------------
-      // Accessors
-
-      case Bytecode::GET_VALUE_TYPE: {
-        Value value = OpGet(inst.operand2).Deref();
-        RSet(inst.operand1, New::Integer(store_, value.type()));
-        break;
-      }
-
-      case Bytecode::ACCESS_CELL: {
-        Value cell_val = OpGet(inst.operand2).Deref();
-        if (WaitOn(cell_val)) goto suspended;
-        if (!HasType(cell_val, Value::CELL)) goto bad_operand;
-        Cell* cell = cell_val.as<Cell>();
-
-        RSet(inst.operand1, cell->Access());
-        break;
-      }
-
-      case Bytecode::ACCESS_ARRAY: {
-        Value array_val = OpGet(inst.operand2).Deref();
-        if (WaitOn(array_val)) goto suspended;
-        if (!HasType(array_val, Value::ARRAY)) goto bad_operand;
-        Array* array = array_val.as<Array>();
-
-        Value index_val = OpGet(inst.operand3).Deref();
-        if (WaitOn(index_val)) goto suspended;
-        if (!HasType(index_val, Value::SMALL_INTEGER)) goto bad_operand;
-        const uint64 index = SmallInteger(index_val).value();
-
-        RSet(inst.operand1, array->Access(index));
-        break;
-      }
-
-      case Bytecode::ACCESS_RECORD: {
-        Value record = OpGet(inst.operand2).Deref();
-        if (WaitOn(record)) goto suspended;
-        if (!(record.caps() & Value::CAP_RECORD)) goto bad_operand;
-
-        Value feature = OpGet(inst.operand3).Deref();
-        if (WaitOn(feature)) goto suspended;
-        if (!(feature.caps() & Value::CAP_LITERAL)) goto bad_operand;
-
-        RSet(inst.operand1, record.RecordGet(feature));
-        break;
-      }
-
-      case Bytecode::ACCESS_RECORD_LABEL: {
-        Value record = OpGet(inst.operand2).Deref();
-        if (WaitOn(record)) goto suspended;
-        if (!(record.caps() & Value::CAP_RECORD)) goto bad_operand;
-
-        RSet(inst.operand1, record.RecordLabel());
-        break;
-      }
-
-      case Bytecode::ACCESS_RECORD_ARITY: {
-        Value record = OpGet(inst.operand2).Deref();
-        if (WaitOn(record)) goto suspended;
-        if (!(record.caps() & Value::CAP_RECORD)) goto bad_operand;
-
-        RSet(inst.operand1, record.RecordArity());
-        break;
-      }
-
-      case Bytecode::ACCESS_OPEN_RECORD_ARITY: {
-        Value record = OpGet(inst.operand2).Deref();
-        if (WaitOn(record)) goto suspended;
-        if (!(record.caps() & Value::CAP_RECORD)) goto bad_operand;
-
-        RSet(inst.operand1, record.OpenRecordArity(store_));
-        break;
-      }
-
-      // -----------------------------------------------------------------------
-      // Mutations
-
-      case Bytecode::ASSIGN_CELL: {
-        Value cell_val = OpGet(inst.operand1).Deref();
-        if (WaitOn(cell_val)) goto suspended;
-        if (!HasType(cell_val, Value::CELL)) goto bad_operand;
-        Cell* cell = cell_val.as<Cell>();
-
-        Value new_val = OpGet(inst.operand2).Deref();
-
-        cell->Assign(new_val);
-        break;
-      }
-
-      case Bytecode::ASSIGN_ARRAY: {
-        Value array_val = OpGet(inst.operand1).Deref();
-        if (WaitOn(array_val)) goto suspended;
-        if (!HasType(array_val, Value::ARRAY)) goto bad_operand;
-        Array* const array = array_val.as<Array>();
-
-        Value index_val = OpGet(inst.operand2).Deref();
-        if (WaitOn(index_val)) goto suspended;
-        if (!HasType(index_val, Value::SMALL_INTEGER)) goto bad_operand;
-        const uint64 index = SmallInteger(index_val).value();
-
-        Value new_val = OpGet(inst.operand3).Deref();
-
-        array->Assign(index, new_val);
-        break;
-      }
-
-      // -----------------------------------------------------------------------
-      // Predicates
-
-      case Bytecode::TEST_IS_DET: {
-        Value value = OpGet(inst.operand2).Deref();
-        RSet(inst.operand1, Boolean::Get(store::IsDet(value)));
-        break;
       }
-
-      case Bytecode::TEST_IS_RECORD: {
-        Value value = OpGet(inst.operand2).Deref();
-        RSet(inst.operand1, Boolean::Get(value.caps() & Value::CAP_RECORD));
-        break;
-      }
-
-      case Bytecode::TEST_ARITY_EXTENDS: {
-        Value super_val = OpGet(inst.operand2).Deref();
-        if (WaitOn(super_val)) goto suspended;
-        if (!HasType(super_val, Value::ARITY)) goto bad_operand;
-        Value sub_val = OpGet(inst.operand3).Deref();
-        if (WaitOn(sub_val)) goto suspended;
-        if (!HasType(sub_val, Value::ARITY)) goto bad_operand;
-        Arity* const super = super_val.as<Arity>();
-        Arity* const sub = sub_val.as<Arity>();
-        RSet(inst.operand1, Boolean::Get(sub->LessThan(super)));
-        break;
-      }
-
-      case Bytecode::TEST_EQUALITY: {
-        Value value1 = OpGet(inst.operand2).Deref();
-        Value value2 = OpGet(inst.operand3).Deref();
-        RSet(inst.operand1, Boolean::Get(store::Equals(value1, value2)));
-        break;
+      if (finally_handler != NULL) {
+        // Finally handler found: branch to it.
+        next_code_pointer = finally_handler->code_pointer_;
+        cse->exn_handlers_.pop_back();
+      } else {
+        // No finally handler in the current call: back to caller.
+        call_stack_.pop_back();
+        if (call_stack_.empty()) goto terminated;
+        // Do not use cse after call_stack_ is modified!
+        goto enter_frame;
       }
-
-      case Bytecode::TEST_LESS_THAN: {
-        Value value1 = OpGet(inst.operand2).Deref();
-        if (WaitOn(value1)) goto suspended;
-        if (!(value1.caps() & Value::CAP_LITERAL)) goto bad_operand;
-        Value value2 = OpGet(inst.operand3).Deref();
-        if (WaitOn(value2)) goto suspended;
-        if (!(value2.caps() & Value::CAP_LITERAL)) goto bad_operand;
-        RSet(inst.operand1, Boolean::Get(value1.LiteralLessThan(value2)));
-        break;
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(CALL_TAIL): {
+      Value closure_val = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(closure_val)) goto suspended;
+      if (!HasType(closure_val, Value::CLOSURE)) goto bad_operand;
+      Closure* closure = closure_val.as<Closure>();
+
+      Value params_val = OpGet(OPERAND(2), registers).Deref();
+      if (!HasType(params_val, Value::ARRAY)) goto bad_operand;
+      Array* params = params_val.as<Array>();
+
+      cse->proc_ = closure;
+      cse->parameters_ = params;
+      // keep the existing cse->locals_
+      cse->array_ = NULL;
+      cse->exn_handlers_.clear();
+      cse->code_pointer_ = 0;
+      // The frame runs a different closure: reload its bytecode.
+      goto enter_frame;
+    }
+
+    OPCODE(CALL_NATIVE): {
+      Value native_val = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(native_val)) goto suspended;
+      if (!HasType(native_val, Value::ATOM)) goto bad_operand;
+      const string& native_name = native_val.as<Atom>()->value();
+
+      Value params_val = OpGet(OPERAND(2), registers).Deref();
+      if (!HasType(params_val, Value::ARRAY)) goto bad_operand;
+      Array* params = params_val.as<Array>();
+
+      // TODO: Better implementation for natives?
+      engine_->native_map_[native_name]->Execute(params);
+      NEXT_INSTRUCTION();
+    }
+
+    // -------------------------------------------------------------------------
+    // Exception handling
+
+    OPCODE(EXN_PUSH_CATCH): {
+      Value bc_pointer_val = OpGet(OPERAND(1), registers);
+      if (!HasType(bc_pointer_val, Value::SMALL_INTEGER)) goto bad_operand;
+      const uint64 bc_pointer = SmallInteger(bc_pointer_val).value();
+
+      cse->exn_handlers_.push_back(
+          ExnStackEntry(ExnStackEntry::CATCH, bc_pointer));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(EXN_PUSH_FINALLY): {
+      Value bc_pointer_val = OpGet(OPERAND(1), registers);
+      if (!HasType(bc_pointer_val, Value::SMALL_INTEGER)) goto bad_operand;
+      const uint64 bc_pointer = SmallInteger(bc_pointer_val).value();
+
+      cse->exn_handlers_.push_back(
+          ExnStackEntry(ExnStackEntry::FINALLY, bc_pointer));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(EXN_POP): {
+      if (cse->exn_handlers_.empty()) goto bad_operand;
+      const ExnStackEntry& ese = cse->exn_handlers_.back();
+      if (ese.type_ == ExnStackEntry::FINALLY)
+        // Branch to the finally block
+        next_code_pointer = ese.code_pointer_;
+      cse->exn_handlers_.pop_back();
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(EXN_RERAISE): {
+      Value exn_val = OpGet(OPERAND(1), registers);
+      if (!exn_val.IsDetermined())
+        NEXT_INSTRUCTION();  // Do not raise!
+      // Fall through EXN_RAISE
+    }
+
+    OPCODE(EXN_RAISE): {
+      Value exn_val = OpGet(OPERAND(1), registers);
+      if (WaitOn(exn_val)) goto suspended;
+
+      if (!Raise(exn_val)) goto terminated;
+      // Do not use cse after call_stack_ has been modified!
+      goto enter_frame;
+    }
+
+    OPCODE(EXN_RESET): {
+      OpSet(OPERAND(1), &registers, exception_);
+      exception_ = New::Free(store_);
+      NEXT_INSTRUCTION();
+    }
+
+    // -------------------------------------------------------------------------
+    // Constructors
+
+    OPCODE(NEW_VARIABLE): {
+      OpSet(OPERAND(1), &registers, New::Free(store_));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NEW_NAME): {
+      OpSet(OPERAND(1), &registers, New::Name(store_));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NEW_CELL): {
+      Value initial_val = OpGet(OPERAND(2), registers).Deref();
+
+      OpSet(OPERAND(1), &registers, New::Cell(store_, initial_val));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NEW_ARRAY): {
+      Value size_val = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(size_val)) goto suspended;
+      if (!HasType(size_val, Value::SMALL_INTEGER)) goto bad_operand;
+      const uint64 array_size = SmallInteger(size_val).value();
+
+      Value initial_val = OpGet(OPERAND(3), registers).Deref();
+
+      OpSet(OPERAND(1), &registers,
+            New::Array(store_, array_size, initial_val));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NEW_ARITY): {
+      Value array_val = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(array_val)) goto suspended;
+      if (!HasType(array_val, Value::ARRAY)) goto bad_operand;
+      Array* const array = array_val.as<Array>();
+
+      OpSet(OPERAND(1), &registers,
+            New::Arity(store_, array->size(), array->values()));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NEW_LIST): {
+      Value head_val = OpGet(OPERAND(2), registers).Deref();
+      Value tail_val = OpGet(OPERAND(3), registers).Deref();
+
+      OpSet(OPERAND(1), &registers, New::List(store_, head_val, tail_val));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NEW_TUPLE): {
+      Value size_val = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(size_val)) goto suspended;
+      if (!HasType(size_val, Value::SMALL_INTEGER)) goto bad_operand;
+      const uint64 size = SmallInteger(size_val).value();
+
+      Value label_val = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(label_val)) goto suspended;
+      if (!(label_val.caps() & Value::CAP_LITERAL)) goto bad_operand;
+
+      OpSet(OPERAND(1), &registers, New::Tuple(store_, label_val, size));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NEW_RECORD): {
+      Value arity_val = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(arity_val)) goto suspended;
+      if (!HasType(arity_val, Value::ARITY)) goto bad_operand;
+      Arity* arity = arity_val.as<Arity>();
+
+      Value label_val = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(label_val)) goto suspended;
+      if (!(label_val.caps() & Value::CAP_LITERAL)) goto bad_operand;
+
+      OpSet(OPERAND(1), &registers, New::Record(store_, label_val, arity));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NEW_PROC): {
+      Value closure_val = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(closure_val)) goto suspended;
+      if (!HasType(closure_val, Value::CLOSURE)) goto bad_operand;
+      Closure* closure = closure_val.as<Closure>();
+
+      Value env_val = OpGet(OPERAND(3), registers).Deref();
+      if (!HasType(env_val, Value::ARRAY)) goto bad_operand;
+      Array* env = env_val.as<Array>();
+
+      OpSet(OPERAND(1), &registers, New::Closure(store_, closure, env));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NEW_THREAD): {
+      Value closure_val = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(closure_val)) goto suspended;
+      if (!HasType(closure_val, Value::CLOSURE)) goto bad_operand;
+      Closure* closure = closure_val.as<Closure>();
+
+      Value params_val = OpGet(OPERAND(3), registers).Deref();
+      if (!HasType(params_val, Value::ARRAY)) goto bad_operand;
+      Array* params = params_val.as<Array>();
+
+      OpSet(OPERAND(1), &registers,
+            New::Thread(store_, engine_, closure, params, store_));
+      NEXT_INSTRUCTION();
+    }
+
+    // -------------------------------------------------------------------------
+    // Accessors
+
+    OPCODE(GET_VALUE_TYPE): {
+      Value value = OpGet(OPERAND(2), registers).Deref();
+      OpSet(OPERAND(1), &registers, New::Integer(store_, value.type()));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(ACCESS_CELL): {
+      Value cell_val = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(cell_val)) goto suspended;
+      if (!HasType(cell_val, Value::CELL)) goto bad_operand;
+      Cell* cell = cell_val.as<Cell>();
+
+      OpSet(OPERAND(1), &registers, cell->Access());
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(ACCESS_ARRAY): {
+      Value array_val = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(array_val)) goto suspended;
+      if (!HasType(array_val, Value::ARRAY)) goto bad_operand;
+      Array* array = array_val.as<Array>();
+
+      Value index_val = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(index_val)) goto suspended;
+      if (!HasType(index_val, Value::SMALL_INTEGER)) goto bad_operand;
+      const uint64 index = SmallInteger(index_val).value();
+
+      OpSet(OPERAND(1), &registers, array->Access(index));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(ACCESS_RECORD): {
+      Value record = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(record)) goto suspended;
+      if (!(record.caps() & Value::CAP_RECORD)) goto bad_operand;
+
+      Value feature = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(feature)) goto suspended;
+      if (!(feature.caps() & Value::CAP_LITERAL)) goto bad_operand;
+
+      OpSet(OPERAND(1), &registers,
+            CachedRecordGet(record, feature, caches + code_pointer,
+                            &engine_->inline_cache_stats_));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(ACCESS_RECORD_LABEL): {
+      Value record = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(record)) goto suspended;
+      if (!(record.caps() & Value::CAP_RECORD)) goto bad_operand;
+
+      OpSet(OPERAND(1), &registers, record.RecordLabel());
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(ACCESS_RECORD_ARITY): {
+      Value record = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(record)) goto suspended;
+      if (!(record.caps() & Value::CAP_RECORD)) goto bad_operand;
+
+      OpSet(OPERAND(1), &registers, record.RecordArity());
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(ACCESS_OPEN_RECORD_ARITY): {
+      Value record = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(record)) goto suspended;
+      if (!(record.caps() & Value::CAP_RECORD)) goto bad_operand;
+
+      OpSet(OPERAND(1), &registers, record.OpenRecordArity(store_));
+      NEXT_INSTRUCTION();
+    }
+
+    // -------------------------------------------------------------------------
+    // Mutations
+
+    OPCODE(ASSIGN_CELL): {
+      Value cell_val = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(cell_val)) goto suspended;
+      if (!HasType(cell_val, Value::CELL)) goto bad_operand;
+      Cell* cell = cell_val.as<Cell>();
+
+      Value new_val = OpGet(OPERAND(2), registers).Deref();
+
+      cell->Assign(new_val);
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(ASSIGN_ARRAY): {
+      Value array_val = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(array_val)) goto suspended;
+      if (!HasType(array_val, Value::ARRAY)) goto bad_operand;
+      Array* const array = array_val.as<Array>();
+
+      Value index_val = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(index_val)) goto suspended;
+      if (!HasType(index_val, Value::SMALL_INTEGER)) goto bad_operand;
+      const uint64 index = SmallInteger(index_val).value();
+
+      Value new_val = OpGet(OPERAND(3), registers).Deref();
+
+      array->Assign(index, new_val);
+      NEXT_INSTRUCTION();
+    }
+
+    // -------------------------------------------------------------------------
+    // Predicates
+
+    OPCODE(TEST_IS_DET): {
+      Value value = OpGet(OPERAND(2), registers).Deref();
+      OpSet(OPERAND(1), &registers, Boolean::Get(store::IsDet(value)));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(TEST_IS_RECORD): {
+      Value value = OpGet(OPERAND(2), registers).Deref();
+      OpSet(OPERAND(1), &registers,
+            Boolean::Get(value.caps() & Value::CAP_RECORD));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(TEST_ARITY_EXTENDS): {
+      Value super_val = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(super_val)) goto suspended;
+      if (!HasType(super_val, Value::ARITY)) goto bad_operand;
+      Value sub_val = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(sub_val)) goto suspended;
+      if (!HasType(sub_val, Value::ARITY)) goto bad_operand;
+      Arity* const super = super_val.as<Arity>();
+      Arity* const sub = sub_val.as<Arity>();
+      OpSet(OPERAND(1), &registers, Boolean::Get(sub->LessThan(super)));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(TEST_EQUALITY): {
+      Value value1 = OpGet(OPERAND(2), registers).Deref();
+      Value value2 = OpGet(OPERAND(3), registers).Deref();
+      OpSet(OPERAND(1), &registers,
+            Boolean::Get(store::Equals(value1, value2)));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(TEST_LESS_THAN): {
+      Value value1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(value1)) goto suspended;
+      if (!(value1.caps() & Value::CAP_LITERAL)) goto bad_operand;
+      Value value2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(value2)) goto suspended;
+      if (!(value2.caps() & Value::CAP_LITERAL)) goto bad_operand;
+      OpSet(OPERAND(1), &registers,
+            Boolean::Get(value1.LiteralLessThan(value2)));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(TEST_LESS_OR_EQUAL): {
+      Value value1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(value1)) goto suspended;
+      if (!(value1.caps() & Value::CAP_LITERAL)) goto bad_operand;
+      Value value2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(value2)) goto suspended;
+      if (!(value2.caps() & Value::CAP_LITERAL)) goto bad_operand;
+      const bool less_or_equal =
+          value1.LiteralLessThan(value2) || value1.LiteralEquals(value2);
+      OpSet(OPERAND(1), &registers, Boolean::Get(less_or_equal));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_INT_INVERSE): {
+      Value number1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(number1)) goto suspended;
+
+      const Value result = Integer::Inverse(store_, number1);
+      if (!result.IsDefined()) goto bad_operand;
+      OpSet(OPERAND(1), &registers, result);
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_INT_ADD): {
+      Value number1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(number1)) goto suspended;
+
+      Value number2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(number2)) goto suspended;
+
+      const Value result = Integer::Add(store_, number1, number2);
+      if (!result.IsDefined()) goto bad_operand;
+      OpSet(OPERAND(1), &registers, result);
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_INT_SUBTRACT): {
+      Value number1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(number1)) goto suspended;
+
+      Value number2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(number2)) goto suspended;
+
+      const Value result = Integer::Subtract(store_, number1, number2);
+      if (!result.IsDefined()) goto bad_operand;
+      OpSet(OPERAND(1), &registers, result);
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_INT_MULTIPLY): {
+      Value number1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(number1)) goto suspended;
+
+      Value number2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(number2)) goto suspended;
+
+      const Value result = Integer::Multiply(store_, number1, number2);
+      if (!result.IsDefined()) goto bad_operand;
+      OpSet(OPERAND(1), &registers, result);
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_INT_DIVIDE): {
+      Value number1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(number1)) goto suspended;
+
+      Value number2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(number2)) goto suspended;
+
+      const Value result = Integer::Divide(store_, number1, number2);
+      if (!result.IsDefined()) goto bad_operand;
+      OpSet(OPERAND(1), &registers, result);
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_FLOAT_INVERSE): {
+      Value number1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(number1)) goto suspended;
+      if (!HasType(number1, Value::FLOAT)) goto bad_operand;
+
+      OpSet(OPERAND(1), &registers, New::Float(store_, -FloatValue(number1)));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_FLOAT_ADD): {
+      Value number1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(number1)) goto suspended;
+      if (!HasType(number1, Value::FLOAT)) goto bad_operand;
+
+      Value number2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(number2)) goto suspended;
+      if (!HasType(number2, Value::FLOAT)) goto bad_operand;
+
+      OpSet(OPERAND(1), &registers,
+            New::Float(store_, FloatValue(number1) + FloatValue(number2)));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_FLOAT_SUBTRACT): {
+      Value number1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(number1)) goto suspended;
+      if (!HasType(number1, Value::FLOAT)) goto bad_operand;
+
+      Value number2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(number2)) goto suspended;
+      if (!HasType(number2, Value::FLOAT)) goto bad_operand;
+
+      OpSet(OPERAND(1), &registers,
+            New::Float(store_, FloatValue(number1) - FloatValue(number2)));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_FLOAT_MULTIPLY): {
+      Value number1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(number1)) goto suspended;
+      if (!HasType(number1, Value::FLOAT)) goto bad_operand;
+
+      Value number2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(number2)) goto suspended;
+      if (!HasType(number2, Value::FLOAT)) goto bad_operand;
+
+      OpSet(OPERAND(1), &registers,
+            New::Float(store_, FloatValue(number1) * FloatValue(number2)));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_FLOAT_DIVIDE): {
+      Value number1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(number1)) goto suspended;
+      if (!HasType(number1, Value::FLOAT)) goto bad_operand;
+
+      Value number2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(number2)) goto suspended;
+      if (!HasType(number2, Value::FLOAT)) goto bad_operand;
+
+      OpSet(OPERAND(1), &registers,
+            New::Float(store_, FloatValue(number1) / FloatValue(number2)));
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_BOOL_NEGATE): {
+      Value boolean = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(boolean)) goto suspended;
+
+      Value negated;
+      if (boolean == KAtomTrue()) {
+        negated = KAtomFalse();
+      } else if (boolean == KAtomFalse()) {
+        negated = KAtomTrue();
+      } else {
+        goto bad_operand;
       }
-
-      case Bytecode::TEST_LESS_OR_EQUAL: {
-        Value value1 = OpGet(inst.operand2).Deref();
-        if (WaitOn(value1)) goto suspended;
-        if (!(value1.caps() & Value::CAP_LITERAL)) goto bad_operand;
-        Value value2 = OpGet(inst.operand3).Deref();
-        if (WaitOn(value2)) goto suspended;
-        if (!(value2.caps() & Value::CAP_LITERAL)) goto bad_operand;
-        const bool less_or_equal =
-            value1.LiteralLessThan(value2) || value1.LiteralEquals(value2);
-        RSet(inst.operand1, Boolean::Get(less_or_equal));
-        break;
+      OpSet(OPERAND(1), &registers, negated);
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_BOOL_AND_THEN): {
+      Value bool1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(bool1)) goto suspended;
+
+      if (bool1 == KAtomTrue()) {
+        // Move on
+      } else if (bool1 == KAtomFalse()) {
+        OpSet(OPERAND(1), &registers, KAtomFalse());
+      } else {
+        goto bad_operand;
       }
 
-      case Bytecode::NUMBER_INT_INVERSE: {
-        Value number1 = OpGet(inst.operand2).Deref();
-        if (WaitOn(number1)) goto suspended;
+      Value bool2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(bool2)) goto suspended;
 
-        // TODO: handle big integers
-        RSet(inst.operand1, Value::Integer(-IntValue(number1)));
-        break;
+      if ((bool2 != KAtomTrue()) && (bool2 != KAtomFalse())) {
+        goto bad_operand;
       }
-
-      case Bytecode::NUMBER_INT_ADD: {
-        Value number1 = OpGet(inst.operand2).Deref();
-        if (WaitOn(number1)) goto suspended;
-
-        Value number2 = OpGet(inst.operand3).Deref();
-        if (WaitOn(number2)) goto suspended;
-
-        // TODO: handle big integers
-        RSet(inst.operand1,
-             Value::Integer(IntValue(number1) + IntValue(number2)));
-        break;
+      OpSet(OPERAND(1), &registers, bool2);
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(NUMBER_BOOL_OR_ELSE): {
+      Value bool1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(bool1)) goto suspended;
+
+      if (bool1 == KAtomTrue()) {
+        OpSet(OPERAND(1), &registers, KAtomTrue());
+      } else if (bool1 == KAtomFalse()) {
+        // Move on
+      } else {
+        goto bad_operand;
       }
 
-      case Bytecode::NUMBER_INT_SUBTRACT: {
-        Value number1 = OpGet(inst.operand2).Deref();
-        if (WaitOn(number1)) goto suspended;
-
-        Value number2 = OpGet(inst.operand3).Deref();
-        if (WaitOn(number2)) goto suspended;
+      Value bool2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(bool2)) goto suspended;
 
-        // TODO: handle big integers
-        RSet(inst.operand1,
-             Value::Integer(IntValue(number1) - IntValue(number2)));
-        break;
+      if ((bool2 != KAtomTrue()) && (bool2 != KAtomFalse())) {
+        goto bad_operand;
       }
+      OpSet(OPERAND(1), &registers, bool2);
+      NEXT_INSTRUCTION();
+    }
 
-      case Bytecode::NUMBER_INT_MULTIPLY: {
-        Value number1 = OpGet(inst.operand2).Deref();
-        if (WaitOn(number1)) goto suspended;
+    OPCODE(NUMBER_BOOL_XOR): {
+      Value bool1 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(bool1)) goto suspended;
 
-        Value number2 = OpGet(inst.operand3).Deref();
-        if (WaitOn(number2)) goto suspended;
-
-        // TODO: handle big integers
-        RSet(inst.operand1,
-             Value::Integer(IntValue(number1) * IntValue(number2)));
-        break;
+      if ((bool1 != KAtomTrue()) && (bool1 != KAtomFalse())) {
+        goto bad_operand;
       }
 
-      case Bytecode::NUMBER_INT_DIVIDE: {
-        Value number1 = OpGet(inst.operand2).Deref();
-        if (WaitOn(number1)) goto suspended;
-
-        Value number2 = OpGet(inst.operand3).Deref();
-        if (WaitOn(number2)) goto suspended;
+      Value bool2 = OpGet(OPERAND(3), registers).Deref();
+      if (WaitOn(bool2)) goto suspended;
 
-        // TODO: handle big integers
-        RSet(inst.operand1,
-             Value::Integer(IntValue(number1) / IntValue(number2)));
-        break;
-      }
-
-      case Bytecode::NUMBER_BOOL_NEGATE: {
-        Value boolean = OpGet(inst.operand2).Deref();
-        if (WaitOn(boolean)) goto suspended;
-
-        Value negated;
-        if (boolean == KAtomTrue()) {
-          negated = KAtomFalse();
-        } else if (boolean == KAtomFalse()) {
-          negated = KAtomTrue();
-        } else {
-          goto bad_operand;
-        }
-        RSet(inst.operand1, negated);
-        break;
+      if ((bool2 != KAtomTrue()) && (bool2 != KAtomFalse())) {
+        goto bad_operand;
       }
 
-      case Bytecode::NUMBER_BOOL_AND_THEN: {
-        Value bool1 = OpGet(inst.operand2).Deref();
-        if (WaitOn(bool1)) goto suspended;
+      Value xored = (bool1 == bool2) ? KAtomFalse() : KAtomTrue();
+      OpSet(OPERAND(1), &registers, xored);
+      NEXT_INSTRUCTION();
+    }
 
-        if (bool1 == KAtomTrue()) {
-          // Move on
-        } else if (bool1 == KAtomFalse()) {
-          RSet(inst.operand1, KAtomFalse());
-        } else {
-          goto bad_operand;
-        }
-
-        Value bool2 = OpGet(inst.operand3).Deref();
-        if (WaitOn(bool2)) goto suspended;
-
-        if ((bool2 != KAtomTrue()) && (bool2 != KAtomFalse())) {
-          goto bad_operand;
-        }
-        RSet(inst.operand1, bool2);
-        break;
-      }
+    // -------------------------------------------------------------------------
+    // Superinstructions
 
-      case Bytecode::NUMBER_BOOL_OR_ELSE: {
-        Value bool1 = OpGet(inst.operand2).Deref();
-        if (WaitOn(bool1)) goto suspended;
+    OPCODE(BRANCH_IF_LESS_THAN): {
+      Value value1 = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(value1)) goto suspended;
+      if (!(value1.caps() & Value::CAP_LITERAL)) goto bad_operand;
+      Value value2 = OpGet(OPERAND(2), registers).Deref();
+      if (WaitOn(value2)) goto suspended;
+      if (!(value2.caps() & Value::CAP_LITERAL)) goto bad_operand;
 
-        if (bool1 == KAtomTrue()) {
-          RSet(inst.operand1, KAtomTrue());
-        } else if (bool1 == KAtomFalse()) {
-          // Move on
-        } else {
-          goto bad_operand;
-        }
+      Value bc_pointer = OpGet(OPERAND(3), registers).Deref();
+      if (!HasType(bc_pointer, Value::SMALL_INTEGER)) goto bad_operand;
 
-        Value bool2 = OpGet(inst.operand3).Deref();
-        if (WaitOn(bool2)) goto suspended;
-
-        if ((bool2 != KAtomTrue()) && (bool2 != KAtomFalse())) {
-          goto bad_operand;
-        }
-        RSet(inst.operand1, bool2);
-        break;
+      if (value1.LiteralLessThan(value2)) {
+        next_code_pointer = SmallInteger(bc_pointer).value();
       }
+      NEXT_INSTRUCTION();
+    }
 
-      case Bytecode::NUMBER_BOOL_XOR: {
-        Value bool1 = OpGet(inst.operand2).Deref();
-        if (WaitOn(bool1)) goto suspended;
-
-        if ((bool1 != KAtomTrue()) && (bool1 != KAtomFalse())) {
-          goto bad_operand;
-        }
-
-        Value bool2 = OpGet(inst.operand3).Deref();
-        if (WaitOn(bool2)) goto suspended;
+    OPCODE(BRANCH_UNLESS_EQUAL): {
+      Value value1 = OpGet(OPERAND(1), registers).Deref();
+      Value value2 = OpGet(OPERAND(2), registers).Deref();
 
-        if ((bool2 != KAtomTrue()) && (bool2 != KAtomFalse())) {
-          goto bad_operand;
-        }
+      Value bc_pointer = OpGet(OPERAND(3), registers).Deref();
+      if (!HasType(bc_pointer, Value::SMALL_INTEGER)) goto bad_operand;
 
-        Value xored = (bool1 == bool2) ? KAtomFalse() : KAtomTrue();
-        RSet(inst.operand1, xored);
-        break;
+      if (!store::Equals(value1, value2)) {
+        next_code_pointer = SmallInteger(bc_pointer).value();
       }
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(CALL_ARGS): {
+      Value closure_val = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(closure_val)) goto suspended;
+      if (!HasType(closure_val, Value::CLOSURE)) goto bad_operand;
+      Closure* closure = closure_val.as<Closure>();
+
+      Value nargs_val = OpGet(OPERAND(2), registers);
+      if (!HasType(nargs_val, Value::SMALL_INTEGER)) goto bad_operand;
+      const uint64 nargs = SmallInteger(nargs_val).value();
+      const uint64 args_size = (nargs + 2) / 3;
+      if (next_code_pointer + args_size > code_size) goto bad_operand;
+      Array* params = NewArguments(nargs, code + next_code_pointer, registers);
+
+      cse->code_pointer_ = next_code_pointer + args_size;
+      call_stack_.push_back(CallStackEntry(store_, closure, params));
+      // Do not use cse after call_stack_ has been modified!
+      goto enter_frame;
+    }
+
+    OPCODE(CALL_NATIVE_ARGS): {
+      Value native_val = OpGet(OPERAND(1), registers).Deref();
+      if (WaitOn(native_val)) goto suspended;
+      if (!HasType(native_val, Value::ATOM)) goto bad_operand;
+      const string& native_name = native_val.as<Atom>()->value();
+
+      Value nargs_val = OpGet(OPERAND(2), registers);
+      if (!HasType(nargs_val, Value::SMALL_INTEGER)) goto bad_operand;
+      const uint64 nargs = SmallInteger(nargs_val).value();
+      const uint64 args_size = (nargs + 2) / 3;
+      if (next_code_pointer + args_size > code_size) goto bad_operand;
+      Array* params = NewArguments(nargs, code + next_code_pointer, registers);
+      next_code_pointer += args_size;
+
+      engine_->native_map_[native_name]->Execute(params);
+      NEXT_INSTRUCTION();
+    }
+
+    OPCODE(ARGUMENTS):
+      // Only read by the preceding call instruction.
+      goto bad_operand;
+
+    // -------------------------------------------------------------------------
+
+#ifndef GOOZ_THREADED_DISPATCH
+    default:
+      LOG(FATAL) << "Unknown opcode " << PackedCode::GetOpcode(inst);
+#endif
+  }  // Instruction handlers
 
-      // -----------------------------------------------------------------------
-
-      default:
-        LOG(FATAL) << "Unknown opcode " << inst.opcode;
-
-    }  // switch (inst.opcode)
-
-    // This is executed by all instructions that do not modify the call_stack_
-    // explicitly. After call_stack_ is modified (e.g. by push_back()), cse
-    // may be invalid.
-    cse->code_pointer_ = next_code_pointer;
-
-  }  // for loop
+  //----------------------------------------------------------------------------
 
+out_of_steps:  // The time slice of the thread is over.
+  cse->code_pointer_ = next_code_pointer;
+  engine_->nsteps_ += steps_count;
   return RUNNABLE;
 
-  //----------------------------------------------------------------------------
-
 suspended:  // The thread is suspended on a variable.
+  // The instruction is executed again when the thread is woken up.
+  cse->code_pointer_ = code_pointer;
+  engine_->nsteps_ += steps_count - steps_left;
   LOG(INFO) << "Thread " << id_ << " suspended";
   return WAITING;
 
 bad_operand:  // An operation encountered a bad operand.
+  cse->code_pointer_ = code_pointer;
+  engine_->nsteps_ += steps_count - steps_left;
   LOG(INFO) << "Thread " << id_ << " terminated: bad operand at CP="
-            << call_stack_.back().code_pointer_;
+            << code_pointer;
   return TERMINATED;
 
 terminated:  // The thread is terminated.
+  engine_->nsteps_ += steps_count - steps_left;
   LOG(INFO) << "Thread " << id_ << " terminated";
   return TERMINATED;
 }
 
+#undef OPERAND
+#undef NEXT_INSTRUCTION
+#undef OPCODE
+#undef FETCH_INSTRUCTION
+
 }  // namespace store
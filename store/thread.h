@@ -113,6 +113,8 @@ string DebugString(const Operand& op) {
 
 class Thread : public HeapValue {
  public:
+  static const Value::ValueType kType = Value::THREAD;
+
   static
   Thread* New(Store* store,
               Engine* engine,
@@ -129,17 +131,54 @@ class Thread : public HeapValue {
   };
 
   // Executes instructions for this thread.
+  // An allocation refused by the store quota raises the atom out_of_memory
+  // in this thread, whose handler runs in the next time slice.
   // @param steps_count How many instructions to execute, at most.
   // @param new_runnable Returns new runnable threads in this list.
   //     Do not include this thread in this list: its runnable state is
   //     determined by the returned ThreadState.
   // @returns The state of the thread.
-  ThreadState Run(uint64 steps_count, list<Thread*>* new_runnable);
+  ThreadState Run(uint64 steps_count, SuspensionList* new_runnable);
 
   inline Value RGet(const Register& reg);
   inline void RSet(const Register& reg, Value value);
-  inline void RSet(const Operand& op, Value value);
-  inline Value OpGet(const Operand& operand);
+
+  // Base pointers of the indexed registers of the current frame, and of the
+  // constant pool of its bytecode, by operand kind (see PackedCode).
+  // Entries of the other operand kinds are NULL, as are the entries of the
+  // register arrays too small for the register indexes of the bytecode:
+  // their operands are accessed through the bound-checked RGet() and RSet().
+  typedef Value* RegisterFile[Register::REGISTER_TYPE_COUNT + 1];
+
+  // Operand kinds read directly through a RegisterFile.
+  static const uint32 kIndexedOperandKinds =
+      (1 << Register::LOCAL)
+      | (1 << Register::PARAM)
+      | (1 << Register::ENVMT)
+      | (1 << Register::ARRAY)
+      | (1 << Register::REGISTER_TYPE_COUNT);  // PackedCode::CONSTANT
+
+  // Operand kinds written directly through a RegisterFile.
+  static const uint32 kWritableOperandKinds =
+      (1 << Register::LOCAL)
+      | (1 << Register::PARAM)
+      | (1 << Register::ARRAY);
+
+  // Resolves the register file of the current frame.
+  // Must be called again whenever the frame or its register arrays change,
+  // and after the store is collected.
+  // @param registers Receives the base pointers.
+  void ResolveRegisters(RegisterFile* registers);
+
+  // Reads a packed operand.
+  // @param operand The operand descriptor, see PackedCode.
+  // @param registers The register file of the current frame.
+  inline Value OpGet(uint32 operand, const RegisterFile& registers);
+
+  // Writes a packed register operand.
+  // @param registers The register file of the current frame, resolved again
+  //     if the write replaces one of the register arrays.
+  inline void OpSet(uint32 operand, RegisterFile* registers, Value value);
 
   bool WaitOn(Value value);
 
@@ -200,11 +239,42 @@ class Thread : public HeapValue {
 
   uint64 id() const { return id_; }
 
+  virtual uint64 HeapSize() const { return sizeof(Thread); }
+
+  virtual void ExploreValue(ReferenceMap* ref_map);
+
+  // ---------------------------------------------------------------------------
+  // Support for Stop&Copy collection
+
+  virtual HeapValue* MoveInternal(Store* store);
+  virtual void MoveReferences(MoveContext* context);
+
  private:   // -----------------------------------------------------------------
 
   Thread(Engine* engine, Closure* closure, Array* parameters, Store* store);
+
+  // Takes the state of the given thread over. Used by MoveInternal().
+  explicit Thread(Thread* thread);
+
   virtual ~Thread();
 
+  // Executes instructions for this thread. See Run().
+  ThreadState Execute(uint64 steps_count, SuspensionList* new_runnable);
+
+  // Creates the parameter array of a call with inline arguments.
+  // @param nargs The number of arguments.
+  // @param arguments The packed ARGUMENTS instructions following the call.
+  // @param registers The register file of the current frame.
+  // @returns The new parameter array.
+  Array* NewArguments(uint64 nargs,
+                      const uint64* arguments,
+                      const RegisterFile& registers);
+
+  // Raises an exception: branches to the first reachable exception handler.
+  // @param exception The exception value.
+  // @returns False if there is no handler: the thread is then terminated.
+  bool Raise(Value exception);
+
   // The next thread ID to allocate
   static uint64 next_id_;
 
@@ -228,6 +298,15 @@ class Thread : public HeapValue {
 
   // Per-thread exception register.
   Value exception_;
+
+  // Next thread in the suspension list or the runnable list this thread
+  // belongs to. NULL for the last thread of a list.
+  Thread* next_suspended_;
+
+  // Whether this thread belongs to a suspension list or the runnable list.
+  bool linked_;
+
+  friend class SuspensionList;
 };
 
 // -----------------------------------------------------------------------------
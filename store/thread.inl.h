@@ -10,8 +10,10 @@ Thread* Thread::New(Store* store,
                     Closure* closure,
                     Array* parameters,
                     Store* thread_store) {
-  return new(CHECK_NOTNULL(store->Alloc<Thread>()))
+  Thread* const thread = new(CHECK_NOTNULL(store->Alloc<Thread>()))
       Thread(engine, closure, parameters, thread_store);
+  store->AddFinalizable(thread);  // Owns the call stack.
+  return thread;
 }
 
 inline
@@ -19,10 +21,13 @@ Thread::Thread(Engine* engine,
                Closure* closure,
                Array* parameters,
                Store* store)
-    : id_(GetNextThreadID()),
+    : HeapValue(kType),
+      id_(GetNextThreadID()),
       engine_(engine),
       store_(CHECK_NOTNULL(store)),
-      exception_(New::Free(store)) {
+      exception_(New::Free(store)),
+      next_suspended_(NULL),
+      linked_(false) {
   CHECK_NOTNULL(closure);
   CHECK_NOTNULL(parameters);
   engine_->AddThread(this);
@@ -104,19 +109,82 @@ void Thread::RSet(const Register& reg, Value value) {
 }
 
 inline
-void Thread::RSet(const Operand& op, Value value) {
-  CHECK_EQ(op.type, Operand::REGISTER);
-  RSet(op.reg, value);
+Value Thread::OpGet(uint32 operand, const RegisterFile& registers) {
+  const uint32 kind = PackedCode::GetOperandKind(operand);
+  const uint32 index = PackedCode::GetOperandIndex(operand);
+  if (kIndexedOperandKinds & (1 << kind)) {
+    Value* const base = registers[kind];
+    if (base != NULL) return base[index];
+  }
+  return RGet(Register(Register::RegisterType(kind), index));
 }
 
 inline
-Value Thread::OpGet(const Operand& operand) {
-  switch (operand.type) {
-    case Operand::REGISTER: return RGet(operand.reg);
-    case Operand::IMMEDIATE: return operand.value;
-    case Operand::INVALID: LOG(FATAL) << "Invalid operand";
-    default: LOG(FATAL) << "Unknown operand type " << operand.type;
+void Thread::OpSet(uint32 operand, RegisterFile* registers, Value value) {
+  const uint32 kind = PackedCode::GetOperandKind(operand);
+  const uint32 index = PackedCode::GetOperandIndex(operand);
+  if (kWritableOperandKinds & (1 << kind)) {
+    Value* const base = (*registers)[kind];
+    if (base != NULL) {
+      base[index] = value;
+      return;
+    }
   }
+  CHECK_LT(kind, uint32(Register::REGISTER_TYPE_COUNT));
+  RSet(Register(Register::RegisterType(kind), index), value);
+  ResolveRegisters(registers);
+}
+
+// -----------------------------------------------------------------------------
+// Suspension lists
+
+inline
+bool SuspensionList::push_back(Thread* thread) {
+  if (thread->linked_) return false;
+  DCHECK(thread->next_suspended_ == NULL);
+  thread->linked_ = true;
+  if (tail_ == NULL)
+    head_ = thread;
+  else
+    tail_->next_suspended_ = thread;
+  tail_ = thread;
+  return true;
+}
+
+inline
+Thread* SuspensionList::pop_front() {
+  Thread* const thread = CHECK_NOTNULL(head_);
+  head_ = thread->next_suspended_;
+  if (head_ == NULL) tail_ = NULL;
+  thread->next_suspended_ = NULL;
+  thread->linked_ = false;
+  return thread;
+}
+
+inline
+void SuspensionList::splice(SuspensionList* other) {
+  if (other->empty()) return;
+  if (tail_ == NULL)
+    head_ = other->head_;
+  else
+    tail_->next_suspended_ = other->head_;
+  tail_ = other->tail_;
+  other->head_ = NULL;
+  other->tail_ = NULL;
+}
+
+inline
+void SuspensionList::Restore(const SuspensionList& snapshot) {
+  head_ = snapshot.head_;
+  tail_ = snapshot.tail_;
+  // Drops the threads appended since the snapshot.
+  if (tail_ != NULL) tail_->next_suspended_ = NULL;
+}
+
+inline
+void SuspensionList::MoveReferences(MoveContext* context) {
+  head_ = context->MoveRef(head_);
+  tail_ = context->MoveRef(tail_);
 }
 
 // -----------------------------------------------------------------------------
@@ -32,7 +32,7 @@ bool Tuple::UnifyWith(UnificationContext* context, Value ovalue) {
   if (size_ != otuple->size_) return false;
   if (!Value::Unify(context, label_, otuple->label_)) return false;
   for (uint64 i = 0; i < size_; ++i)
-    if (!Value::Unify(context, values_[i], otuple->TupleGet(i))) return false;
+    if (!Value::Unify(context, values_[i], otuple->values_[i])) return false;
   return true;
 }
 
@@ -48,12 +48,15 @@ bool Tuple::Equals(EqualityContext* context, Value value) {
 
 // virtual
 HeapValue* Tuple::MoveInternal(Store* store) {
+  return New(store, label_, size(), values_);
+}
+
+// virtual
+void Tuple::MoveReferences(MoveContext* context) {
+  label_ = context->Move(label_);
   const uint64 nvalues = size();
-  // TODO: We could avoid copying the array.
-  Value moved_values[nvalues];
   for (uint64 i = 0; i < nvalues; ++i)
-    moved_values[i] = values_[i].Move(store);
-  return New(store, label_.Move(store), nvalues, moved_values);
+    values_[i] = context->Move(values_[i]);
 }
 
 // virtual
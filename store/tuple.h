@@ -57,14 +57,16 @@ class Tuple : public HeapValue {
 
   // ---------------------------------------------------------------------------
   // Value API
-  virtual ValueType type() const noexcept { return kType; }
-  virtual uint64 caps() const { return Value::CAP_RECORD | Value::CAP_TUPLE; }
+  virtual uint64 HeapSize() const {
+    return SizeOfWithNestedArray<Tuple, Value>(size_);
+  }
 
   virtual void ExploreValue(ReferenceMap* ref_map);
   virtual Value Optimize(OptimizeContext* context);
   virtual bool UnifyWith(UnificationContext* context, Value ovalue);
   virtual bool Equals(EqualityContext* context, Value value);
   virtual HeapValue* MoveInternal(Store* store);
+  virtual void MoveReferences(MoveContext* context);
   virtual bool IsStateless(StatelessnessContext* context);
 
   // ---------------------------------------------------------------------------
@@ -73,6 +75,8 @@ class Tuple : public HeapValue {
   // virtual void ToProtoBuf(oz_pb::Value* pb);
 
  private: // -------------------------------------------------------------------
+  // Fixes references up when reading snapshots.
+  friend class SnapshotDecoder;
 
   Tuple(Value label, uint64 size);
   Tuple(Value label, uint64 size, Value* values);
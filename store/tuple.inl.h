@@ -26,7 +26,8 @@ Tuple* Tuple::New(Store* store, Value label, uint64 size, Value* values) {
 
 inline
 Tuple::Tuple(Value label, uint64 size)
-    : label_(label),
+    : HeapValue(kType, Value::CAP_RECORD | Value::CAP_TUPLE),
+      label_(label),
       size_(size) {
   CHECK_GT(size, 0UL);
   CHECK(!((size == 2) && (label == KAtomList())));
@@ -34,7 +35,8 @@ Tuple::Tuple(Value label, uint64 size)
 
 inline
 Tuple::Tuple(Value label, uint64 size, Value* values)
-    : label_(label),
+    : HeapValue(kType, Value::CAP_RECORD | Value::CAP_TUPLE),
+      label_(label),
       size_(size) {
   CHECK_GT(size, 0UL);
   CHECK(!((size == 2) && (label == KAtomList())));
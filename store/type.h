@@ -18,7 +18,7 @@ namespace store {
 // A type value.
 class Type : public HeapValue {
  public:
-  virtual ValueType type() const { return TYPE; }
+  Type() : HeapValue(TYPE) {}
 
   Value* desc() const { return desc_; }
 
@@ -31,7 +31,7 @@ class Type : public HeapValue {
 // A type variable has sub-typing and super-typing constraints.
 class TypeVariable : public HeapValue {
  public:
-  virtual ValueType type() const { return TYPE_VARIABLE; }
+  TypeVariable() : HeapValue(TYPE_VARIABLE) {}
 
  private:
   // Values being sub-types of this type variable.
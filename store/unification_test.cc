@@ -3,10 +3,13 @@
 #include "store/value.h"
 #include "store/values.h"
 
+#include <thread>
+
 #include <gtest/gtest.h>
 
 #include "base/stl-util.h"
 #include "combinators/oznode_eval_visitor.h"
+#include "store/engine.h"
 
 using combinators::oz::ParseEval;
 
@@ -220,6 +223,23 @@ TEST_F(UnifyTest, OpenRecord) {
     EXPECT_TRUE(Unify(or1, or2));
     EXPECT_TRUE(Deref(or1) == Deref(or2));
   }
+  {
+    // The values of the common features are unified.
+    OpenRecord* orec = OpenRecord::New(&store_, Atom::Get("r"));
+    Variable* var = Variable::New(&store_);
+    EXPECT_TRUE(orec->Set("a", var));
+    Record* rec = ParseEval("r(a:b c:d)", &store_).as<Record>();
+
+    EXPECT_TRUE(Unify(orec, rec));
+    EXPECT_TRUE(Deref(orec) == rec);
+    EXPECT_TRUE(Deref(var) == Atom::Get("b"));
+  }
+  {
+    OpenRecord* orec = ParseEval("r(a:b ...)", &store_).as<OpenRecord>();
+    Record* rec = ParseEval("r(a:c)", &store_).as<Record>();
+
+    EXPECT_FALSE(Unify(orec, rec));
+  }
   {
     OpenRecord* orec = OpenRecord::New(&store_, Atom::Get("r"));
     Tuple* tuple = Tuple::New(&store_, Atom::Get("r"), 10);
@@ -236,4 +256,96 @@ TEST_F(UnifyTest, OpenRecord) {
   }
 }
 
+TEST_F(UnifyTest, VariableChain) {
+  // X1 = X2, ..., X4 = X5: a chain of bound variables.
+  Variable* vars[5];
+  for (int i = 0; i < 5; ++i)
+    vars[i] = Variable::New(&store_);
+  for (int i = 0; i < 4; ++i)
+    EXPECT_FALSE(vars[i]->BindTo(vars[i + 1]));
+  EXPECT_FALSE(Value(vars[0]).IsDetermined());
+  EXPECT_TRUE(Value(vars[0]).Deref() == vars[4]);
+  for (int i = 0; i < 4; ++i)
+    EXPECT_TRUE(vars[i]->ref() == vars[4]);
+
+  // Only the dereferenced variables are pointed at the bound value.
+  EXPECT_TRUE(vars[4]->BindTo(Value::Integer(42)));
+  EXPECT_TRUE(Value(vars[1]).IsDetermined());
+  EXPECT_TRUE(Value(vars[0]).Deref() == Value::Integer(42));
+  EXPECT_TRUE(vars[0]->ref() == Value::Integer(42));
+  EXPECT_TRUE(vars[1]->ref() == Value::Integer(42));
+  EXPECT_TRUE(vars[2]->ref() == vars[4]);
+}
+
+TEST_F(UnifyTest, Suspensions) {
+  // A thread suspended on X, computing X + 1.
+  const Operand l0(Register(Register::LOCAL, 0));
+  const Operand p0(Register(Register::PARAM, 0));
+  shared_ptr<vector<Bytecode> > code(new vector<Bytecode>);
+  code->push_back(Bytecode(Bytecode::NUMBER_INT_ADD,
+                           l0, p0, Operand(Value::Integer(1))));
+  code->push_back(Bytecode(Bytecode::RETURN));
+  Closure* const closure = Closure::New(&store_, code, 1, 1, 0);
+  const Value x = New::Free(&store_);
+  Array* const params = Array::New(&store_, 1, x);
+  Engine engine;
+  Thread* const thread = Thread::New(&store_, &engine, closure, params, &store_);
+  engine.Run();
+  ASSERT_EQ(thread, x.as<Variable>()->suspensions()->front());
+
+  // An aborted unification restores the suspensions.
+  const Value y = New::Free(&store_);
+  Value values1[] = { x, Value::Integer(1) };
+  Value values2[] = { y, Value::Integer(2) };
+  EXPECT_FALSE(Unify(Tuple::New(&store_, Atom::Get("f"), 2, values1),
+                     Tuple::New(&store_, Atom::Get("f"), 2, values2)));
+  EXPECT_TRUE(x.as<Variable>()->IsFree());
+  EXPECT_TRUE(y.as<Variable>()->IsFree());
+  EXPECT_EQ(thread, x.as<Variable>()->suspensions()->front());
+  EXPECT_TRUE(y.as<Variable>()->suspensions()->empty());
+
+  // Binding X to Y moves the suspension to Y, binding Y wakes it up.
+  SuspensionList runnable;
+  EXPECT_TRUE(Unify(x, y, &runnable));
+  EXPECT_TRUE(runnable.empty());
+  EXPECT_TRUE(x.as<Variable>()->suspensions()->empty());
+  EXPECT_EQ(thread, y.as<Variable>()->suspensions()->front());
+  EXPECT_TRUE(Unify(y, Value::Integer(5), &runnable));
+  EXPECT_TRUE(y.as<Variable>()->suspensions()->empty());
+
+  // The thread is enqueued at most once.
+  EXPECT_FALSE(runnable.push_back(thread));
+  EXPECT_EQ(thread, runnable.pop_front());
+  EXPECT_TRUE(runnable.empty());
+  EXPECT_TRUE(runnable.push_back(thread));
+  EXPECT_EQ(thread, runnable.pop_front());
+}
+
+TEST_F(UnifyTest, VariableChainCompressionPerThread) {
+  // X1 = X2 = X3, dereferenced while a unification is in progress.
+  Variable* vars[3];
+  for (int i = 0; i < 3; ++i)
+    vars[i] = Variable::New(&store_);
+  for (int i = 0; i < 2; ++i)
+    EXPECT_FALSE(vars[i]->BindTo(vars[i + 1]));
+
+  {
+    UnificationContext context;
+    EXPECT_TRUE(Value(vars[0]).Deref() == vars[2]);
+    EXPECT_TRUE(vars[0]->ref() == vars[1]);
+
+    // A unification in progress on this thread does not disable the path
+    // compression on other threads.
+    bool in_progress = true;
+    std::thread other([&vars, &in_progress]() {
+      in_progress = UnificationContext::InProgress();
+      Value(vars[0]).Deref();
+    });
+    other.join();
+    EXPECT_FALSE(in_progress);
+    EXPECT_TRUE(vars[0]->ref() == vars[2]);
+  }
+  EXPECT_FALSE(UnificationContext::InProgress());
+}
+
 }  // namespace store
@@ -11,16 +11,51 @@ namespace store {
 
 void Value::Explore(ReferenceMap* ref_map) const {
   CHECK_NOTNULL(ref_map);
+  if ((ref_map->edges != NULL) && IsHeapValue())
+    ref_map->edges->push_back(ValuePair(ref_map->parent, *this));
   ReferenceMap::iterator it = ref_map->find(*this);
   if (it == ref_map->end()) {
     (*ref_map)[*this] = false;
-    if (IsHeapValue())
+    if (IsHeapValue()) {
+      const Value parent = ref_map->parent;
+      ref_map->parent = *this;
       heap_value_->ExploreValue(ref_map);
+      ref_map->parent = parent;
+    }
   } else {
     it->second = true;
   }
 }
 
+const char* ValueTypeName(Value::ValueType type) {
+  switch (type) {
+    case Value::MOVED_VALUE: return "moved";
+    case Value::INVALID: return "invalid";
+    case Value::INTEGER: return "integer";
+    case Value::NAME: return "name";
+    case Value::ATOM: return "atom";
+    case Value::STRING: return "string";
+    case Value::FLOAT: return "float";
+    case Value::BOOLEAN: return "boolean";
+    case Value::ARITY: return "arity";
+    case Value::ARITY_MAP: return "arity_map";
+    case Value::LIST: return "list";
+    case Value::TUPLE: return "tuple";
+    case Value::RECORD: return "record";
+    case Value::OPEN_RECORD: return "open_record";
+    case Value::CELL: return "cell";
+    case Value::ARRAY: return "array";
+    case Value::VARIABLE: return "variable";
+    case Value::PORT: return "port";
+    case Value::CLOSURE: return "closure";
+    case Value::TYPE: return "type";
+    case Value::TYPE_VARIABLE: return "type_variable";
+    case Value::SMALL_INTEGER: return "small_integer";
+    case Value::THREAD: return "thread";
+    default: return "unknown";
+  }
+}
+
 FeatureNotFound::FeatureNotFound(const Value& feature, Arity* arity)
     : message_("Feature " + feature.ToString()
                + " not found in arity " + CHECK_NOTNULL(arity)->ToString()) {
@@ -65,6 +100,8 @@ void Value::ToASCII(ToASCIIContext* context, string* repr) const {
   switch (tag()) {
     case kHeapValueTag: heap_value_->ToASCII(context, repr); return;
     case kSmallIntTag: SmallInteger(*this).ToASCII(repr); return;
+    case kAtomTag: Atom::FromValue(*this)->ToASCII(context, repr); return;
+    case kFloatTag: SmallFloat(*this).ToASCII(repr); return;
   }
   LOG(FATAL) << "Unexpected value type: tag=" << tag();
 }
@@ -76,14 +113,11 @@ void Value::ToProtoBuf(oz_pb::Value* value) const {
 // -----------------------------------------------------------------------------
 // Value unification
 
+thread_local int UnificationContext::nactive_ = 0;
+
 void UnificationContext::AddMutation(Variable* var) {
-  shared_ptr<SuspensionList>& initial_suspensions = mutations[var];
-  if (initial_suspensions == NULL) {
-    initial_suspensions.reset(
-        new SuspensionList(*CHECK_NOTNULL(var->suspensions())));
-  } else {
-    // The variable initial state is already saved in the mutation pool.
-  }
+  // No-op if the variable initial state is already saved in the mutation pool.
+  mutations.insert(std::make_pair(var, *CHECK_NOTNULL(var->suspensions())));
 }
 
 // static
@@ -106,6 +140,10 @@ bool Value::UnifyWith(UnificationContext* context, Value ovalue) {
   switch (tag()) {
     case kHeapValueTag: return heap_value_->UnifyWith(context, ovalue);
     case kSmallIntTag: return false;  // bits equality
+    case kAtomTag: return false;  // bits equality
+    case kFloatTag:  // +0.0 and -0.0 are encoded differently.
+      return (ovalue.tag() == kFloatTag)
+          && (SmallFloat(*this).value() == SmallFloat(ovalue).value());
   }
   LOG(FATAL) << "Unexpected value type: tag=" << tag();
 }
@@ -120,21 +158,21 @@ bool Unify(Value value1, Value value2, SuspensionList* suspensions) {
   if (value1.type() == Value::VARIABLE) {
     Variable* var1 = value1.as<Variable>();
     if (var1->BindTo(value2)) {
-      suspensions->splice(suspensions->end(), *var1->suspensions());
+      suspensions->splice(var1->suspensions());
     }
     return true;
 
   } else if (value2.type() == Value::VARIABLE) {
     Variable* var2 = value2.as<Variable>();
     if (var2->BindTo(value1)) {
-      suspensions->splice(suspensions->end(), *var2->suspensions());
+      suspensions->splice(var2->suspensions());
     }
     return true;
 
   } else {
     UnificationContext context;
     if (Value::Unify(&context, value1, value2)) {
-      suspensions->splice(suspensions->end(), context.new_runnable);
+      suspensions->splice(&context.new_runnable);
       return true;
 
     } else {
@@ -142,7 +180,7 @@ bool Unify(Value value1, Value value2, SuspensionList* suspensions) {
       for (auto it = context.mutations.begin();
 	   it != context.mutations.end();
 	   ++it)
-        it->first->RevertToFree(it->second.get());
+        it->first->RevertToFree(it->second);
       return false;
     }
   }
@@ -158,6 +196,8 @@ bool EqualityContext::Equals(Value value1, Value value2) {
   if (!Add(value1, value2)) return true;
   if (value1 == value2) return true;
   if (value1.type() != value2.type()) return false;
+  // Distinct canonical values are structurally different.
+  if (InterningStore::AreCanonical(value1, value2)) return false;
   return value1.Equals(this, value2);
 }
 
@@ -166,6 +206,9 @@ bool Value::Equals(EqualityContext* context, Value value) const {
   switch (tag()) {
     case kHeapValueTag: return heap_value_->Equals(context, value);
     case kSmallIntTag: return false;
+    case kAtomTag: return false;
+    case kFloatTag:  // +0.0 and -0.0 are encoded differently.
+      return SmallFloat(*this).value() == SmallFloat(value).value();
   }
   LOG(FATAL) << "Unexpected value type: tag=" << tag();
 }
@@ -184,7 +227,7 @@ bool StatelessnessContext::IsStateless(Value value) {
 }
 
 bool Value::IsStateless(StatelessnessContext* context) const {
-  CHECK(IsHeapValue());
+  if (!IsHeapValue()) return true;
   return heap_value_->IsStateless(context);
 }
 
@@ -206,6 +249,8 @@ Value OptimizeContext::Optimize(Value value) {
 Value Value::Optimize(OptimizeContext* context) {
   switch (tag()) {
     case kSmallIntTag: return *this;
+    case kAtomTag: return *this;
+    case kFloatTag: return *this;
     case kHeapValueTag: return heap_value_->Optimize(context);
   }
   LOG(FATAL) << "Unexpected value type: tag=" << tag();
@@ -218,9 +263,29 @@ Value Optimize(Value value) {
 
 // -----------------------------------------------------------------------------
 
-Value Value::Move(Store* store) {
+Value Value::Move(MoveContext* context) {
   CHECK(IsHeapValue());
-  return heap_value_->Move(store);
+  return heap_value_->Move(context);
+}
+
+bool MoveContext::InFromSpace(Value value) const {
+  if (!value.IsDefined() || !value.IsHeapValue()) return false;
+  for (auto it = from_spaces_.begin(); it != from_spaces_.end(); ++it)
+    if ((*it)->Contains(value.heap_value())) return true;
+  return false;
+}
+
+Value MoveContext::Move(Value value) {
+  if (!InFromSpace(value)) return value;
+  return value.Move(this);
+}
+
+void MoveContext::MoveReferences() {
+  // moved_ grows while references are being updated.
+  while (nscanned_ < moved_.size()) {
+    moved_[nscanned_]->MoveReferences(this);
+    nscanned_++;
+  }
 }
 
 int64 IntValue(Value value) {
@@ -228,6 +293,17 @@ int64 IntValue(Value value) {
   switch (value.tag()) {
     case kSmallIntTag: return SmallInteger(value).value();
     case kHeapValueTag: return value.as<Integer>()->value();
+    default: break;
+  }
+  LOG(FATAL) << "Unexpected value type: tag=" << value.tag();
+}
+
+double FloatValue(Value value) {
+  value = value.Deref();
+  switch (value.tag()) {
+    case kFloatTag: return SmallFloat(value).value();
+    case kHeapValueTag: return value.as<Float>()->value();
+    default: break;
   }
   LOG(FATAL) << "Unexpected value type: tag=" << value.tag();
 }
@@ -5,6 +5,7 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 using std::list;
 using std::shared_ptr;
@@ -47,6 +48,7 @@ class OpenRecord;
 class Record;
 class Tuple;
 class List;
+class RecordSpan;
 
 class Variable;
 class Cell;
@@ -69,7 +71,51 @@ class NotImplemented : public std::exception {
 class IteratorAtEnd : public std::exception {
 };
 
-typedef list<Thread*> SuspensionList;
+class MoveContext;
+
+// List of threads: the threads suspended on a variable, or the runnable
+// threads of an engine.
+//
+// The list is intrusive: threads are linked through Thread::next_suspended_,
+// hence a thread belongs to at most one list at a time, and is woken up at
+// most once per suspension. Adding a thread does not allocate, and lists are
+// spliced in constant time: the threads woken up by a unification are
+// enqueued as a single batch.
+//
+// Copies of a list are snapshots: Restore() reverts a list to a snapshot,
+// as long as threads have only been appended to the list since.
+class SuspensionList {
+ public:
+  SuspensionList() : head_(NULL), tail_(NULL) {}
+
+  bool empty() const { return head_ == NULL; }
+
+  // @returns The first thread of the list, or NULL if the list is empty.
+  Thread* front() const { return head_; }
+
+  // Appends a thread, unless it already belongs to a list.
+  // @returns Whether the thread was appended.
+  inline bool push_back(Thread* thread);
+
+  // Removes the first thread from the list.
+  // @returns The removed thread. The list must not be empty.
+  inline Thread* pop_front();
+
+  // Moves all the threads of another list at the end of this list.
+  // @param other The list to empty into this list.
+  inline void splice(SuspensionList* other);
+
+  // Reverts this list to a snapshot taken earlier.
+  inline void Restore(const SuspensionList& snapshot);
+
+  // Updates the references to the threads moved by a collection.
+  // The links between threads are updated by Thread::MoveReferences().
+  inline void MoveReferences(MoveContext* context);
+
+ private:
+  Thread* head_;
+  Thread* tail_;
+};
 
 // Raised when an operation results in suspensing the current thread.
 class SuspendThread : public std::exception {
@@ -127,6 +173,12 @@ const uint64 kTagBitMask = (1 << kTagBits) - 1;
 enum ValueTag {
   kHeapValueTag = 0x00,
   kSmallIntTag = 0x01,
+
+  // Immediate atoms: the bits above the tag hold an index in the atom table.
+  kAtomTag = 0x02,
+
+  // Immediate floats: see SmallFloat.
+  kFloatTag = 0x03,
 };
 
 const int kSignedIntBits = kWordSize - 1;
@@ -143,6 +195,7 @@ class UnificationContext;
 class EqualityContext;
 class StatelessnessContext;
 class OptimizeContext;
+class MoveContext;
 
 class Value {
  public:
@@ -177,6 +230,10 @@ class Value {
     TYPE_VARIABLE = 18,
 
     SMALL_INTEGER = 19,  // Not a heap value
+
+    THREAD      = 21,
+
+    VALUE_TYPE_COUNT,
   };
 
   struct ValueHash {
@@ -219,6 +276,11 @@ class Value {
   Value(HeapValue* heap_value) : heap_value_(heap_value) {
     CHECK_EQ(kHeapValueTag, tag());
   }
+  // Atoms are referenced as immediate values.
+  // Templated for NULL to keep converting to a heap value reference.
+  template <typename T, typename = typename std::enable_if<
+                            std::is_same<T, store::Atom>::value>::type>
+  Value(T* atom) : bits_(AtomBits(atom)) {}
 
   inline
   Value& operator=(const Value& other) {
@@ -233,6 +295,13 @@ class Value {
     return *this;
   }
 
+  template <typename T, typename = typename std::enable_if<
+                            std::is_same<T, store::Atom>::value>::type>
+  Value& operator=(T* atom) {
+    bits_ = AtomBits(atom);
+    return *this;
+  }
+
   // ---------------------------------------------------------------------------
 
   inline
@@ -265,6 +334,8 @@ class Value {
 
   inline bool IsHeapValue() const { return tag() == kHeapValueTag; }
   inline bool IsSmallInt() const { return tag() == kSmallIntTag; }
+  inline bool IsAtom() const { return tag() == kAtomTag; }
+  inline bool IsSmallFloat() const { return tag() == kFloatTag; }
 
   // Dereferences this value.
   // @returns The dereferenced value.
@@ -376,17 +447,16 @@ class Value {
   // ---------------------------------------------------------------------------
   // Support for Stop&Copy collection
 
-  // Moves this value into another store, as well as all referenced values.
+  // Moves this value into another store.
   // Prefer the term move over copy: for stateful values, there should be only
   // one instance, the previous instance will be destroyed!
   //
-  // The default behavior is to overwrite this value with a MovedValue
-  // after creating a copy of this value in the new store and "finalizing"
-  // this value.
+  // This method should only be invoked through:
+  //   Value MoveContext::Move(value);
   //
-  // @param store The store to move this value into.
+  // @param context The collection context.
   // @return The new value location.
-  Value Move(Store* store);
+  Value Move(MoveContext* context);
 
   // ---------------------------------------------------------------------------
   // Capacities
@@ -460,6 +530,12 @@ class Value {
   //     Blocks for an open-record until it is closed.
   Value RecordGet(Value feature);
 
+  // @returns A view on the record items, in order.
+  //     Does not allocate, and does not dispatch for records, tuples, lists
+  //     and atoms.
+  //     Blocks for an open-record until it is closed.
+  inline RecordSpan RecordItems();
+
   // @returns A new iterator on the record items, in order.
   // Caller must take ownership.
   ItemIterator* RecordIterItems();
@@ -490,6 +566,13 @@ class Value {
   LiteralClass LiteralGetClass();
 
  private:
+  // @returns The heap value this value references, or the atom object of an
+  //     immediate atom.
+  inline HeapValue* heap_object() const;
+
+  // @returns The immediate encoding of an atom.
+  static inline uint64 AtomBits(const store::Atom* atom);
+
   // Memory layout
   // This object must be lightweight and fit in a native word of the target
   // execution environment.
@@ -530,7 +613,20 @@ typedef Value::ValuePair ValuePair;
 // A value in the map is associated to true when it appears multiple times in
 // the transitive closure; it is associated to false when it appears exactly
 // once.
-class ReferenceMap : public UnorderedMap<Value, bool> {};
+//
+// When edges is set, the exploration also records the references between
+// heap values, as (referencing value, referenced value) pairs. The references
+// from the explored roots have an undefined referencing value.
+class ReferenceMap : public UnorderedMap<Value, bool> {
+ public:
+  ReferenceMap() : edges(NULL) {}
+
+  // Records the references, when not NULL. Not owned.
+  vector<ValuePair>* edges;
+
+  // The value whose references are being explored, when recording edges.
+  Value parent;
+};
 
 typedef SymmetricPair<Value, Value> SymmetricValuePair;
 typedef UnorderedSet<SymmetricValuePair, SymmetricPairHash<Value> >
@@ -552,7 +648,12 @@ class ToASCIIContext {
 
 class UnificationContext {
  public:
-  UnificationContext() {}
+  UnificationContext() { ++nactive_; }
+  ~UnificationContext() { --nactive_; }
+
+  // @returns Whether a unification transaction is in progress on the current
+  //     OS thread, in which case variable bindings may still be reverted.
+  static bool InProgress() { return nactive_ > 0; }
 
   // Adds a value pair in the unification context.
   // All value pairs already registered in the context are assumed
@@ -573,14 +674,19 @@ class UnificationContext {
   SymmetricValuePairSet done;
 
   // Set of variables modified as part of the unification transaction.
-  // Modified variable are mapped to their initial suspensions list.
-  typedef UnorderedMap<Variable*, shared_ptr<SuspensionList> > MutationMap;
+  // Modified variable are mapped to a snapshot of their initial suspensions.
+  typedef UnorderedMap<Variable*, SuspensionList> MutationMap;
   MutationMap mutations;
 
   // Threads to wake up if the unification succeeds.
   SuspensionList new_runnable;
 
  private:
+  // Number of live unification contexts on the current OS thread.
+  // Engines may run on separate OS threads: a unification in progress on
+  // one thread does not disable path compression on the others.
+  static thread_local int nactive_;
+
   DISALLOW_COPY_AND_ASSIGN(UnificationContext);
 };
 
@@ -630,6 +736,68 @@ class OptimizeContext {
   DISALLOW_COPY_AND_ASSIGN(OptimizeContext);
 };
 
+// Context of a Stop&Copy collection.
+//
+// Values living in the registered from-spaces are copied into the target store,
+// and the former locations are overwritten with MovedValue forwarders.
+// References are updated breadth-first (Cheney scan): moving a value does not
+// recurse into its references, which keeps the native stack flat and supports
+// cyclic value graphs.
+class MoveContext {
+ public:
+  // @param store The store to move values into.
+  explicit MoveContext(Store* store)
+      : store_(CHECK_NOTNULL(store)),
+        nscanned_(0) {
+  }
+
+  // Registers a store whose values have to be moved.
+  void AddFromSpace(const Store* space) {
+    from_spaces_.push_back(CHECK_NOTNULL(space));
+  }
+
+  // @returns Whether the given value lives in one of the from-spaces.
+  bool InFromSpace(Value value) const;
+
+  // Moves a value into the target store, if it lives in a from-space.
+  // The references of the moved value are updated by MoveReferences().
+  // @returns The new location of the value.
+  Value Move(Value value);
+
+  // Shortcut to move a typed reference to a heap value. NULL is preserved.
+  template <typename T>
+  T* MoveRef(T* value) {
+    return static_cast<T*>(Move(Value(value)).heap_value());
+  }
+
+  // Updates the references of all the values moved so far, moving the
+  // referenced values in turn, until the transitive closure has moved.
+  void MoveReferences();
+
+  // Registers a value just moved, to update its references later on.
+  // Invoked by HeapValue::Move().
+  void AddMoved(HeapValue* value) { moved_.push_back(value); }
+
+  // @returns The store values are moved into.
+  Store* store() const { return store_; }
+
+  // @returns All the values moved so far, at their new locations.
+  const vector<HeapValue*>& moved() const { return moved_; }
+
+ private:
+  Store* const store_;
+
+  vector<const Store*> from_spaces_;
+
+  // Values moved so far, in order.
+  vector<HeapValue*> moved_;
+
+  // Number of moved values whose references are up to date.
+  uint64 nscanned_;
+
+  DISALLOW_COPY_AND_ASSIGN(MoveContext);
+};
+
 // -----------------------------------------------------------------------------
 
 // Iterator for an empty set of items.
@@ -687,12 +855,12 @@ void Initialize();
 // @param value2 Another value (maybe unbound).
 // @param suspensions Fills this list with the suspensions to wake up.
 // @returns True if successful.
-bool Unify(Value value1, Value value2, list<Thread*>* suspensions);
+bool Unify(Value value1, Value value2, SuspensionList* suspensions);
 
 // Simplified Unify() when threads are not involved.
 inline
 bool Unify(Value value1, Value value2) {
-  list<Thread*> suspensions;
+  SuspensionList suspensions;
   const bool unified = Unify(value1, value2, &suspensions);
   CHECK(suspensions.empty());
   return unified;
@@ -709,6 +877,9 @@ bool Unify(Value value1, Value value2) {
 inline
 Value Deref(Value value) { return value.Deref(); }
 
+// @returns A short name for the given value type, eg. "list".
+const char* ValueTypeName(Value::ValueType type);
+
 // @returns True if the given value has the specified type.
 inline
 bool HasType(Value value, Value::ValueType type) {
@@ -740,14 +911,17 @@ bool Equals(Value value1, Value value2);
 // @returns The value of an Oz integer.
 int64 IntValue(Value value);
 
+// @returns The value of an Oz float.
+double FloatValue(Value value);
+
 // -----------------------------------------------------------------------------
 
-Atom* KAtomEmpty();
-Atom* KAtomTrue();
-Atom* KAtomFalse();
-Atom* KAtomNil();
-Atom* KAtomList();
-Atom* KAtomTuple();
+Value KAtomEmpty();
+Value KAtomTrue();
+Value KAtomFalse();
+Value KAtomNil();
+Value KAtomList();
+Value KAtomTuple();
 
 Arity* KArityEmpty();
 Arity* KAritySingleton();
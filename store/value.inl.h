@@ -39,12 +39,12 @@ extern Arity* const kArityPair;
 
 #if 1
 
-inline Atom* KAtomEmpty() { return Atom::Get(""); }
-inline Atom* KAtomTrue() { return Atom::Get("true"); }
-inline Atom* KAtomFalse() { return Atom::Get("false"); }
-inline Atom* KAtomNil() { return Atom::Get("nil"); }
-inline Atom* KAtomList() { return Atom::Get("|"); }
-inline Atom* KAtomTuple() { return Atom::Get("#"); }
+inline Value KAtomEmpty() { return Atom::Immediate(Atom::kEmptyIndex); }
+inline Value KAtomTrue() { return Atom::Immediate(Atom::kTrueIndex); }
+inline Value KAtomFalse() { return Atom::Immediate(Atom::kFalseIndex); }
+inline Value KAtomNil() { return Atom::Immediate(Atom::kNilIndex); }
+inline Value KAtomList() { return Atom::Immediate(Atom::kListIndex); }
+inline Value KAtomTuple() { return Atom::Immediate(Atom::kTupleIndex); }
 
 inline Arity* KArityEmpty() { return Arity::GetTuple(0); }
 inline Arity* KAritySingleton() { return Arity::GetTuple(1); }
@@ -52,12 +52,12 @@ inline Arity* KArityPair() { return Arity::GetTuple(2); }
 
 #else
 
-inline Atom* KAtomEmpty() { return kAtomEmpty; }
-inline Atom* KAtomTrue() { return kAtomTrue; }
-inline Atom* KAtomFalse() { return kAtomFalse; }
-inline Atom* KAtomNil() { return kAtomNil; }
-inline Atom* KAtomList() { return kAtomList; }
-inline Atom* KAtomTuple() { return kAtomTuple; }
+inline Value KAtomEmpty() { return kAtomEmpty; }
+inline Value KAtomTrue() { return kAtomTrue; }
+inline Value KAtomFalse() { return kAtomFalse; }
+inline Value KAtomNil() { return kAtomNil; }
+inline Value KAtomList() { return kAtomList; }
+inline Value KAtomTuple() { return kAtomTuple; }
 
 inline Arity* KArityEmpty() { return kArityEmpty; }
 inline Arity* KAritySingleton() { return kAritySingleton; }
@@ -129,6 +129,19 @@ Value Value::List(Store* store, Value head, Value tail) {
 
 // -----------------------------------------------------------------------------
 
+// static
+inline
+uint64 Value::AtomBits(const store::Atom* atom) {
+  return (CHECK_NOTNULL(atom)->index() << kTagBits) | kAtomTag;
+}
+
+inline
+HeapValue* Value::heap_object() const {
+  if (IsAtom()) return store::Atom::FromValue(*this);
+  CHECK(IsHeapValue());
+  return heap_value_;
+}
+
 template <class T>
 inline
 bool Value::IsA() const {
@@ -138,7 +151,7 @@ bool Value::IsA() const {
 template <class T>
 inline
 T* Value::as() const {
-  HeapValue* const value = heap_value();
+  HeapValue* const value = heap_object();
   CHECK_EQ(T::kType, value->type());
   return static_cast<T*>(value);
 }
@@ -148,6 +161,8 @@ Value::ValueType Value::type() const {
   switch (tag()) {
     case kHeapValueTag: return heap_value_->type();
     case kSmallIntTag: return SmallInteger::kType;
+    case kAtomTag: return store::Atom::kType;
+    case kFloatTag: return SmallFloat::kType;
   }
   LOG(FATAL) << "Unexpected value type: tag=" << tag();
 }
@@ -155,8 +170,14 @@ Value::ValueType Value::type() const {
 inline
 Value Value::Deref() const {
   switch (tag()) {
-    case kHeapValueTag: return heap_value_->Deref();
+    case kHeapValueTag:
+      if (!heap_value_->indirect()) return *this;
+      if (heap_value_->type() == VARIABLE)
+        return static_cast<store::Variable*>(heap_value_)->Resolve();
+      return heap_value_->Deref();
     case kSmallIntTag: return *this;
+    case kAtomTag: return *this;
+    case kFloatTag: return *this;
   }
   LOG(FATAL) << "Unexpected value type: tag=" << tag();
 }
@@ -164,8 +185,11 @@ Value Value::Deref() const {
 inline
 bool Value::IsDetermined() {
   switch (tag()) {
-    case kHeapValueTag: return heap_value_->IsDetermined();
+    case kHeapValueTag:
+      return !heap_value_->indirect() || heap_value_->IsDetermined();
     case kSmallIntTag: return true;
+    case kAtomTag: return true;
+    case kFloatTag: return true;
   }
   LOG(FATAL) << "Unexpected value type: tag=" << tag();
 }
@@ -175,6 +199,8 @@ uint64 Value::caps() const {
   switch (tag()) {
     case kHeapValueTag: return heap_value_->caps();
     case kSmallIntTag: return SmallInteger(*this).caps();
+    case kAtomTag: return store::Atom::kCaps;
+    case kFloatTag: return SmallFloat(*this).caps();
   }
   LOG(FATAL) << "Unexpected value type: tag=" << tag();
 }
@@ -184,32 +210,27 @@ uint64 Value::caps() const {
 
 inline
 Arity* Value::OpenRecordArity(Store* store) {
-  CHECK(IsHeapValue());
-  return heap_value_->OpenRecordArity(store);
+  return heap_object()->OpenRecordArity(store);
 }
 
 inline
 uint64 Value::OpenRecordWidth() {
-  CHECK(IsHeapValue());
-  return heap_value_->OpenRecordWidth();
+  return heap_object()->OpenRecordWidth();
 }
 
 inline
 bool Value::OpenRecordHas(Value feature) {
-  CHECK(IsHeapValue());
-  return heap_value_->OpenRecordHas(feature);
+  return heap_object()->OpenRecordHas(feature);
 }
 
 inline
 Value Value::OpenRecordGet(Value feature) {
-  CHECK(IsHeapValue());
-  return heap_value_->OpenRecordGet(feature);
+  return heap_object()->OpenRecordGet(feature);
 }
 
 inline
 Value Value::OpenRecordClose(Store* store) {
-  CHECK(IsHeapValue());
-  return heap_value_->OpenRecordClose(store);
+  return heap_object()->OpenRecordClose(store);
 }
 
 // -----------------------------------------------------------------------------
@@ -217,44 +238,58 @@ Value Value::OpenRecordClose(Store* store) {
 
 inline
 Value Value::RecordLabel() {
-  CHECK(IsHeapValue());
-  return heap_value_->RecordLabel();
+  return heap_object()->RecordLabel();
 }
 
 inline
 Arity* Value::RecordArity() {
-  CHECK(IsHeapValue());
-  return heap_value_->RecordArity();
+  return heap_object()->RecordArity();
 }
 
 inline
 uint64 Value::RecordWidth() {
-  CHECK(IsHeapValue());
-  return heap_value_->RecordWidth();
+  return heap_object()->RecordWidth();
 }
 
 inline
 bool Value::RecordHas(Value feature) {
-  CHECK(IsHeapValue());
-  return heap_value_->RecordHas(feature);
+  return heap_object()->RecordHas(feature);
 }
 
 inline
 Value Value::RecordGet(Value feature) {
-  CHECK(IsHeapValue());
-  return heap_value_->RecordGet(feature);
+  return heap_object()->RecordGet(feature);
+}
+
+inline
+RecordSpan Value::RecordItems() {
+  switch (type()) {
+    case RECORD: {
+      const store::Record* const record = as<store::Record>();
+      return RecordSpan(record->arity()->features().data(),
+                        record->values(), record->size());
+    }
+    case TUPLE: {
+      const store::Tuple* const tuple = as<store::Tuple>();
+      return RecordSpan(NULL, tuple->values(), tuple->size());
+    }
+    case LIST:
+      return RecordSpan(NULL, as<store::List>()->values(), 2);
+    case ATOM:
+      return RecordSpan();
+    default:
+      return heap_object()->RecordItems();
+  }
 }
 
 inline
 Value::ItemIterator* Value::RecordIterItems() {
-  CHECK(IsHeapValue());
-  return heap_value_->RecordIterItems();
+  return heap_object()->RecordIterItems();
 }
 
 inline
 Value::ValueIterator* Value::RecordIterValues() {
-  CHECK(IsHeapValue());
-  return heap_value_->RecordIterValues();
+  return heap_object()->RecordIterValues();
 }
 
 // -----------------------------------------------------------------------------
@@ -262,8 +297,7 @@ Value::ValueIterator* Value::RecordIterValues() {
 
 inline
 Value Value::TupleGet(uint64 index) {
-  CHECK(IsHeapValue());
-  return heap_value_->TupleGet(index);
+  return heap_object()->TupleGet(index);
 }
 
 // -----------------------------------------------------------------------------
@@ -274,6 +308,8 @@ uint64 Value::LiteralHashCode() {
   switch (tag()) {
     case kHeapValueTag: return heap_value_->LiteralHashCode();
     case kSmallIntTag: return SmallInteger(*this).LiteralHashCode();
+    case kAtomTag: return bits_ >> kTagBits;  // See Atom::LiteralHashCode().
+    default: break;
   }
   throw NotImplemented();
 }
@@ -285,6 +321,8 @@ bool Value::LiteralEquals(Value other) {
   switch (tag()) {
     case kHeapValueTag: return heap_value_->LiteralEquals(other.heap_value_);
     case kSmallIntTag: return false;
+    case kAtomTag: return false;  // atoms are interned.
+    default: break;
   }
   LOG(FATAL) << "Unexpected value type: tag=" << tag();
 }
@@ -297,6 +335,12 @@ bool Value::LiteralLessThan(Value other) {
     switch (tag()) {
       case kHeapValueTag: return heap_value_->LiteralLessThan(other);
       case kSmallIntTag: return SmallInteger(*this).LiteralLessThan(other);
+      case kAtomTag:
+        // Only atoms with different texts need to be compared.
+        return (bits_ != other.bits_)
+            && (store::Atom::FromValue(*this)->value()
+                < store::Atom::FromValue(other)->value());
+      default: break;
     }
     throw NotImplemented();
   } else {
@@ -309,6 +353,8 @@ Value::LiteralClass Value::LiteralGetClass() {
   switch (tag()) {
     case kHeapValueTag: return heap_value_->LiteralGetClass();
     case kSmallIntTag: return LITERAL_CLASS_INTEGER;
+    case kAtomTag: return LITERAL_CLASS_ATOM;
+    default: break;
   }
   throw NotImplemented();
 }
@@ -347,6 +393,14 @@ class New {
     return Integer(store, mpz_class(integer, base));
   }
 
+  // @returns A small float when possible, a Float allocated in store otherwise.
+  static inline
+  Value Float(Store* store, double value) {
+    if (SmallFloat::IsSmallFloat(value))
+      return SmallFloat(value).Encode();
+    return store::Float::New(store, value);
+  }
+
   static inline
   Value Atom(Store* store, const string& atom) {
     return store::Atom::Get(atom);
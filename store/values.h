@@ -2,6 +2,7 @@
 #define STORE_VALUES_H_
 
 #include "store/value.h"
+#include "store/record_span.h"
 #include "store/heap_value.h"
 #include "store/moved_value.h"
 #include "store/store.h"
@@ -16,6 +17,7 @@
 #include "store/float.h"
 #include "store/integer.h"
 #include "store/name.h"
+#include "store/small_float.h"
 #include "store/small_integer.h"
 #include "store/string.h"
 
@@ -44,6 +46,7 @@
 #include "store/open_record.inl.h"
 #include "store/tuple.inl.h"
 #include "store/record.inl.h"
+#include "store/variable.inl.h"
 
 #include "store/thread.inl.h"
 
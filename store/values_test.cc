@@ -52,6 +52,27 @@ TEST_F(ExploreTest, PrimitiveValue) {
   }
 }
 
+// -----------------------------------------------------------------------------
+// Heap value header
+
+TEST_F(ExploreTest, Header) {
+  Value list = List::New(&store_, Value::Integer(1), KAtomNil());
+  EXPECT_EQ(Value::LIST, list.type());
+  EXPECT_EQ(Value::CAP_RECORD | Value::CAP_TUPLE, list.caps());
+  EXPECT_FALSE(list.heap_value()->indirect());
+  EXPECT_TRUE(list.Deref() == list);
+  EXPECT_EQ(Value::CAP_LITERAL,
+            Integer::New(&store_, mpz_class(1) << 64)->caps());
+
+  Value variable = Variable::New(&store_);
+  EXPECT_TRUE(variable.heap_value()->indirect());
+  EXPECT_FALSE(variable.IsDetermined());
+  EXPECT_TRUE(Unify(variable, list));
+  EXPECT_TRUE(variable.IsDetermined());
+  EXPECT_TRUE(variable.Deref() == list);
+  EXPECT_EQ(Value::VARIABLE, variable.type());
+}
+
 // -----------------------------------------------------------------------------
 // String representation
 
@@ -91,4 +112,41 @@ TEST_F(ToStringTest, Lists) {
             ParseEval("[1 {NewName} 3]", &store_).ToString());
 }
 
+// -----------------------------------------------------------------------------
+// Record spans
+
+class RecordSpanTest : public testing::Test {
+ protected:
+  RecordSpanTest()
+      : store_(kStoreSize) {
+  }
+
+  StaticStore store_;
+};
+
+TEST_F(RecordSpanTest, Items) {
+  const RecordSpan record = ParseEval("f(a:1 b:2)", &store_).RecordItems();
+  ASSERT_EQ(2UL, record.size());
+  EXPECT_TRUE(record.feature(0) == Atom::Get("a"));
+  EXPECT_TRUE(record.value(0) == Value::Integer(1));
+  EXPECT_TRUE(record.feature(1) == Atom::Get("b"));
+  EXPECT_TRUE(record.value(1) == Value::Integer(2));
+
+  const RecordSpan tuple = ParseEval("f(x y z)", &store_).RecordItems();
+  ASSERT_EQ(3UL, tuple.size());
+  EXPECT_TRUE(tuple.item(2) == ValuePair(Value::Integer(3), Atom::Get("z")));
+
+  const RecordSpan list = ParseEval("1|2", &store_).RecordItems();
+  ASSERT_EQ(2UL, list.size());
+  EXPECT_TRUE(list.item(0) == ValuePair(Value::Integer(1), Value::Integer(1)));
+  EXPECT_TRUE(list.item(1) == ValuePair(Value::Integer(2), Value::Integer(2)));
+
+  EXPECT_TRUE(Value(Atom::Get("atom")).RecordItems().empty());
+  EXPECT_TRUE(Value(Name::New(&store_)).RecordItems().empty());
+  EXPECT_THROW(Value(Cell::New(&store_, KAtomNil())).RecordItems(),
+               NotImplemented);
+  EXPECT_THROW(Value(OpenRecord::New(&store_, Atom::Get("f"))).RecordItems(),
+               SuspendThread);
+}
+
 }  // namespace store
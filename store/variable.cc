@@ -1,8 +1,6 @@
 #include "store/values.h"
 
-#include <list>
 #include <string>
-using std::list;
 using std::string;
 
 #include "base/stl-util.h"
@@ -16,7 +14,35 @@ const Value::ValueType Variable::kType;
 
 // virtual
 Value Variable::Deref() {
-  return ref_.IsDefined() ? ref_ : this;
+  return Resolve();
+}
+
+// virtual
+bool Variable::IsDetermined() {
+  Value value = Resolve();
+  return (value != this) && value.IsDetermined();
+}
+
+Value Variable::ResolveChain() {
+  // The end of the chain is the first value that is not a bound variable.
+  Value end = ref_;
+  while (end.type() == Value::VARIABLE) {
+    const Variable* const var = static_cast<Variable*>(end.heap_value());
+    if (var->IsFree()) break;
+    end = var->ref_;
+  }
+
+  if (!UnificationContext::InProgress()) {
+    Variable* var = this;
+    while (var->ref_ != end) {
+      Variable* const next = static_cast<Variable*>(var->ref_.heap_value());
+      var->ref_ = end;
+      var = next;
+    }
+  }
+
+  // Open-records dereference to their record once closed.
+  return (end.type() == Value::VARIABLE) ? end : end.Deref();
 }
 
 // virtual
@@ -38,6 +64,21 @@ bool Variable::IsStateless(StatelessnessContext* context) {
   return ref_.IsDefined() && context->IsStateless(ref_);
 }
 
+// virtual
+HeapValue* Variable::MoveInternal(Store* store) {
+  Variable* const moved = New(store);
+  moved->ref_ = ref_;
+  // This variable is destroyed right after being moved.
+  moved->suspensions_.splice(&suspensions_);
+  return moved;
+}
+
+// virtual
+void Variable::MoveReferences(MoveContext* context) {
+  ref_ = context->Move(ref_);
+  suspensions_.MoveReferences(context);
+}
+
 // virtual
 void Variable::ToASCII(ToASCIIContext* context, string* repr) {
   CHECK_NOTNULL(context);
@@ -71,11 +112,11 @@ bool Variable::UnifyWith(UnificationContext* context, Value ovalue) {
     context->AddMutation(ovar);
 
     // Transfer suspensions to the other free variable.
-    ovar->suspensions()->splice(ovar->suspensions()->end(), suspensions_);
+    ovar->suspensions()->splice(&suspensions_);
 
   } else {
     // Wake up suspensions if the unification succeeds.
-    context->new_runnable.splice(context->new_runnable.end(), suspensions_);
+    context->new_runnable.splice(&suspensions_);
   }
   return true;
 }
@@ -89,7 +130,7 @@ bool Variable::BindTo(Value value) {
     CHECK(!ovar->ref_.IsDefined());
     // Merge this free variable into the other free variable:
     // transfer its suspensions into the other variable.
-    ovar->suspensions_.splice(ovar->suspensions_.end(), suspensions_);
+    ovar->suspensions_.splice(&suspensions_);
     return false;
 
   } else {
@@ -98,9 +139,9 @@ bool Variable::BindTo(Value value) {
   }
 }
 
-void Variable::RevertToFree(SuspensionList* suspensions) {
+void Variable::RevertToFree(const SuspensionList& suspensions) {
   ref_ = NULL;
-  suspensions_.swap(*suspensions);
+  suspensions_.Restore(suspensions);
 }
 
 }  // namespace store
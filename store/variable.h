@@ -1,10 +1,8 @@
 #ifndef STORE_VARIABLE_H_
 #define STORE_VARIABLE_H_
 
-#include <list>
 #include <string>
 
-using std::list;
 using std::string;
 
 namespace store {
@@ -48,12 +46,20 @@ class Variable : public HeapValue {
   // Reverts the changes from an aborted unification.
   // The variable becomes free again if it was bound during the unification.
   // The suspensions list is reverted.
-  // @param suspensions The initial suspensions list to revert to.
-  void RevertToFree(list<Thread*>* suspensions);
+  // @param suspensions The snapshot of the initial suspensions to revert to.
+  void RevertToFree(const SuspensionList& suspensions);
 
-  bool IsFree() const { return ref_ == NULL; }
+  bool IsFree() const { return !ref_.IsDefined(); }
   Value ref() const { return ref_; }
 
+  // Follows the chain of bound variables starting at this variable.
+  //
+  // The variables of the chain are pointed directly at the end of the chain,
+  // unless a unification is in progress, as it might revert their bindings.
+  //
+  // @returns The dereferenced value: a free variable or a determined value.
+  inline Value Resolve();
+
   SuspensionList* suspensions() { return &suspensions_; }
   void AddSuspension(Thread* thread) {
     suspensions_.push_back(thread);
@@ -61,14 +67,16 @@ class Variable : public HeapValue {
 
   // ---------------------------------------------------------------------------
   // Value API
-  virtual Value::ValueType type() const noexcept { return kType; }
+  virtual uint64 HeapSize() const { return sizeof(Variable); }
 
   virtual Value Deref();
   virtual Value Optimize(OptimizeContext* context);
   virtual void ExploreValue(ReferenceMap* ref_map);
   virtual bool UnifyWith(UnificationContext* context, Value value);
-  virtual bool IsDetermined() { return !IsFree(); }
+  virtual bool IsDetermined();
   virtual bool IsStateless(StatelessnessContext* context);
+  virtual HeapValue* MoveInternal(Store* store);
+  virtual void MoveReferences(MoveContext* context);
 
   // ---------------------------------------------------------------------------
   // Serialization
@@ -76,11 +84,19 @@ class Variable : public HeapValue {
   virtual void ToProtoBuf(oz_pb::Value* pb);
 
  private:  // ------------------------------------------------------------------
+  // Fixes references up when reading snapshots.
+  friend class SnapshotDecoder;
 
   // Initializes a new free variable.
-  Variable() : ref_((HeapValue*) NULL) {}
+  Variable()
+      : HeapValue(kType, Value::CAP_NONE, true),
+        ref_((HeapValue*) NULL) {
+  }
   virtual ~Variable() {}
 
+  // Slow path of Resolve(), for chains of bound variables.
+  Value ResolveChain();
+
   // ---------------------------------------------------------------------------
   // Memory layout
 
@@ -0,0 +1,21 @@
+#ifndef STORE_VARIABLE_INL_H_
+#define STORE_VARIABLE_INL_H_
+
+namespace store {
+
+inline
+Value Variable::Resolve() {
+  if (!ref_.IsDefined()) return this;
+  // Bound to a direct value or to a free variable: no chain to follow.
+  if (!ref_.IsHeapValue()) return ref_;
+  HeapValue* const next = ref_.heap_value();
+  if (!next->indirect()) return ref_;
+  if ((next->type() == Value::VARIABLE)
+      && static_cast<Variable*>(next)->IsFree())
+    return ref_;
+  return ResolveChain();
+}
+
+}  // namespace store
+
+#endif  // STORE_VARIABLE_INL_H_